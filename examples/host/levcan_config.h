@@ -0,0 +1,116 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, host configuration for hal/Virtual
+ * levcan_config.h
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#pragma once
+
+//user functions for critical sections
+//host build: every LEVCAN copy is driven by single thread, bus calls "interrupts" synchronously
+static inline void lc_enable_irq(void) {
+}
+static inline void lc_disable_irq(void) {
+}
+//FEATURES
+//file client and server need user file and delay functions, not used on host
+//#define LEVCAN_FILECLIENT
+//#define LEVCAN_FILESERVER
+#define LEVCAN_PARAMETERS
+#define LEVCAN_EVENTS
+
+//File client waits for server answer, ms
+//#define LEVCAN_FILE_TIMEOUT 500
+
+//Build exact hardware filters from object dictionary (levcan_filter.c)
+//Use LC_FilterSubscribe for TCP messages sent with indices not in dictionary
+//#define LEVCAN_FILTER_PLANNER
+//Host-side filter bank model for planner evaluation
+//#define LEVCAN_FILTER_MODEL
+//Drop unwanted frames in LC_ReceiveHandler using dictionary bitmap, saves rx buffer
+//Call LC_SoftFilterUpdate after dictionary change
+//#define LEVCAN_SOFTWARE_FILTER
+
+//Estimate bus load from received and sent frames (levcan_busload.c), call LC_BusLoadManager periodically
+//#define LEVCAN_BUSLOAD
+//#define LEVCAN_BUSLOAD_BITRATE 1000000
+
+//Skip discovery after reset: claim saved id and restore node table (levcan.c)
+//Implement lc_warmStartLoad and lc_warmStartSave for your storage
+//#define LEVCAN_WARM_START
+//#define LEVCAN_WARM_START_CLAIM_TIME 50
+
+//Many nodes powered at once: claim in random slots, probe ids by serial, remember every claimed id
+//Pays off only above ~100 nodes, smaller networks come online 15..20 ms later (tools/lc_claimsim.c)
+//#define LEVCAN_CLAIM_SPREAD
+//#define LEVCAN_CLAIM_SLOT 1
+//#define LEVCAN_CLAIM_SLOTS 16
+
+//Liveness by heartbeat frames instead of periodic claims and discovery requests (levcan.c)
+//Set LC_NodeInit_t.HeartbeatPeriod per node class, late nodes are asked by roll call bitmap
+//#define LEVCAN_HEARTBEAT
+//#define LEVCAN_HEARTBEAT_PERIOD 1000
+//#define LEVCAN_HEARTBEAT_MISSES 3
+
+//Print debug messages using trace_printf
+//#define LEVCAN_TRACE
+//You can re-define trace_printf function
+//#define trace_printf printf
+//Record protocol events in binary ring instead (levcan_trace.c), fast enough for production
+//Read with LC_TraceRead or dump lc_trace memory and decode on host
+//#define LEVCAN_TRACE_RING
+//#define LEVCAN_TRACE_RING_SIZE 64
+//Timestamp source for trace ring, default - LC_NetworkManager time
+//#define LEVCAN_TRACE_TIME() HAL_GetTick()
+//Float-point support
+//#define LEVCAN_USE_FLOAT
+//Memory packing, compiler specific, used to decrease the data type alignment to 1-byte
+#if defined (__CC_ARM)         /* ARM Compiler */
+  #define LEVCAN_PACKED    __packed
+#elif defined (__ICCARM__)     /* IAR Compiler */
+  #define LEVCAN_PACKED    __packed
+#elif defined   ( __GNUC__ )   /* GNU Compiler */                        
+  #define LEVCAN_PACKED    __attribute__((__packed__))
+#endif /* __CC_ARM */
+//Max device created nodes
+#define LEVCAN_MAX_OWN_NODES 2
+//Network node table
+#define LEVCAN_MAX_TABLE_NODES 32
+//Above-driver buffer size. Used to store CAN messages before calling network manager
+//Make shure that you cannot receive more messages before LC_NetworkManager update
+//Use LC_GetRxStats high-water marks to size buffers
+#define LEVCAN_TX_SIZE 20
+#define LEVCAN_RX_SIZE 30
+//Second level rx buffer, LC_ReceiveDrain moves messages here from small LEVCAN_RX_SIZE buffer
+//Call LC_ReceiveDrain from low-priority interrupt to survive long manager delays
+//#define LEVCAN_RX_DEFERRED_SIZE 100
+//enable parameters and setup receive buffer size
+#define LEVCAN_PARAM_QUEUE_SIZE 32
+//parameter requests in flight per node (LEVCAN_PARAM_WINDOW, default 4, older nodes get 1), LC_NetworkManager repeats lost ones
+//values in one LC_ParameterSetBatch, default 128 or what fits LEVCAN_OBJECT_DATASIZE for static memory
+//#define LEVCAN_PARAM_BATCH_SIZE 128
+//Client descriptor cache keyed by node serial (levcan_paramcache.c), received strings are pooled. Needs dynamic memory
+//#define LEVCAN_PARAM_CACHE
+//Value change notifications: LC_ParameterSubscribe, server sends changed values every LEVCAN_PARAM_NOTIFY_INTERVAL
+//#define LEVCAN_PARAM_SUBSCRIBE
+//#define LEVCAN_PARAM_SUBSCRIPTIONS 4
+//Config parser (LEVCAN_PARAMETERS_PARSING) finds names by hash built once per node
+//#define LEVCAN_PARAM_NAME_INDEX
+//LC_ParameterImport streams config from file server (LEVCAN_FILECLIENT) through this buffer, longer lines are skipped
+//#define LEVCAN_PARAM_IMPORT_SIZE 256
+//LC_ParameterExport writes config to file server through this buffer
+//#define LEVCAN_PARAM_EXPORT_SIZE 128
+//Default size for malloc, maximum size for static mem. Minimum - 8byte
+#define LEVCAN_OBJECT_DATASIZE 48
+//Enable this to use only static memory
+//#define LEVCAN_MEM_STATIC
+
+#ifdef LEVCAN_MEM_STATIC
+//Maximum TX/RX objects. Excl. UDP data <=8byte, this receives in fast mode
+#define LEVCAN_OBJECT_SIZE 10
+#else
+//external malloc functions
+#define lcmalloc lc_host_malloc
+#define lcfree lc_host_free
+#endif
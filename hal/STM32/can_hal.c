@@ -312,6 +312,58 @@ void CAN_FilterEditOff() {
 	CAN1->FMR &= ~CAN_FMR_FINIT;
 }
 
+/// Setup one filter bank in mask mode without stopping others.
+/// Filter init mode is entered only if bank scale, mode or FIFO should be changed
+/// @param bank Filter bank number
+/// @param reg Message index to pass
+/// @param mask Mask filtration for index, 1 - care, 0 - don't care
+/// @param fifo Receive FIFO
+/// @return Returns CANH_Fail if bank out of range
+CAN_Status CAN_FilterSetMask(uint16_t bank, CAN_IR reg, CAN_IR mask, uint8_t fifo) {
+#ifdef CAN_ForceEXID
+	reg.ExtensionID = 1;
+	mask.ExtensionID = 1;
+#endif
+#ifdef CAN_ForceSTID
+	reg.ExtensionID=0;
+	mask.ExtensionID=1;
+#endif
+	if (bank >= CAN_FilterSize)
+		return CANH_Fail;
+	uint32_t bit = 1 << bank;
+	//bank configuration can be changed only in filter init mode
+	uint16_t init = ((CAN1->FS1R & bit) != (reg.ExtensionID << bank)) || ((CAN1->FFA1R & bit) != (fifo << bank)) || ((CAN1->FM1R & bit) != 0);
+	if (init) {
+		CAN1->FMR |= CAN_FMR_FINIT;
+		CAN1->FS1R = (reg.ExtensionID << bank) | (CAN1->FS1R & ~bit);
+		CAN1->FFA1R = (fifo << bank) | (CAN1->FFA1R & ~bit);
+		CAN1->FM1R &= ~bit;
+	}
+	//registers of deactivated bank can be written any time
+	CAN1->FA1R &= ~bit;
+	if (reg.ExtensionID) {
+		CAN1->sFilterRegister[bank].FR1 = reg.ToUint32 & ~1;
+		CAN1->sFilterRegister[bank].FR2 = mask.ToUint32 & ~1;
+	} else {
+		CAN1->sFilterRegister[bank].FR1 = ((reg.STID << 5) | (reg.Request << 4)) | (((mask.STID << 5) | (mask.Request << 4)) << 16);
+		CAN1->sFilterRegister[bank].FR2 = 0xFFFFFFFF; //must match impossible
+	}
+	FilterActivation |= bit;
+	CAN1->FA1R = FilterActivation;
+	if (init)
+		CAN1->FMR &= ~CAN_FMR_FINIT;
+	return CANH_Ok;
+}
+
+/// Deactivate one filter bank without stopping others
+/// @param bank Filter bank number
+void CAN_FilterDisable(uint16_t bank) {
+	if (bank >= CAN_FilterSize)
+		return;
+	FilterActivation &= ~(1 << bank);
+	CAN1->FA1R = FilterActivation;
+}
+
 CAN_Status CAN_Send(uint32_t index32, uint32_t* data, uint16_t length) {
 	CAN_IR index = { .ToUint32 = index32 };
 	uint8_t txBox;
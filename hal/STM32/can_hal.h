@@ -69,6 +69,9 @@ void CAN_FilterEditOn(void);
 CAN_Status CAN_CreateFilterIndex(CAN_IR reg, uint16_t fifo);
 CAN_Status CAN_CreateFilterMask(CAN_IR reg, CAN_IR mask, uint8_t fifo);
 void CAN_FilterEditOff(void);
+//single bank editing, other banks keep receiving
+CAN_Status CAN_FilterSetMask(uint16_t bank, CAN_IR reg, CAN_IR mask, uint8_t fifo);
+void CAN_FilterDisable(uint16_t bank);
 
 CAN_Status CAN_Send(uint32_t index32, uint32_t* data, uint16_t length);
 CAN_Status CAN_Receive(uint32_t* index32, uint32_t* data, uint16_t* length);
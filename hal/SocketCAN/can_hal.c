@@ -0,0 +1,356 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, Linux SocketCAN driver
+ * can_hal.c
+ *
+ * Frames are moved in batches: CAN_SocketPoll reads up to CAN_SOCKET_BATCH frames with one
+ * recvmmsg and passes them to LC_ReceiveHandler, CAN_Send collects frames that are written
+ * with one sendmmsg. Filter banks are converted to CAN_RAW_FILTER list, so kernel drops
+ * unwanted frames before they reach user space.
+ * Driver is not thread safe, call LEVCAN and CAN_SocketPoll from one thread:
+ *
+ * CAN_SocketOpen("vcan0");
+ * while (1) {
+ *   CAN_SocketPoll(1);
+ *   LC_NetworkManager(elapsed_ms);
+ * }
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#define _GNU_SOURCE
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+
+#include "can_hal.h"
+
+//private functions
+canid_t socketId(uint32_t index32);
+canid_t socketMask(uint32_t mask32);
+uint32_t socketIndex(canid_t id);
+void socketApplyFilters(void);
+void socketTimestamp(struct msghdr* msg, uint64_t* time);
+//private variables
+int can_socket = -1;
+uint8_t can_hw_time = 0;
+//receive batch
+struct can_frame rx_frames[CAN_SOCKET_BATCH];
+uint64_t rx_time[CAN_SOCKET_BATCH];
+uint16_t rx_count, rx_pos;
+uint64_t rx_last_time;
+//transmit batch
+struct can_frame tx_frames[CAN_SOCKET_BATCH];
+uint16_t tx_count;
+//filter banks
+struct {
+	uint32_t Reg;
+	uint32_t Mask;
+	uint8_t Active;
+} can_filters[CAN_FilterSize];
+uint8_t can_filter_edit;
+extern void LC_ReceiveHandler(void);
+extern void LC_TransmitHandler(void);
+
+/// Opens CAN_RAW socket on interface, bit rate is set by system (ip link)
+/// @param interface Interface name, "can0" or "vcan0"
+/// @return 0 on success
+int CAN_SocketOpen(const char* interface) {
+	struct sockaddr_can addr = { 0 };
+	struct ifreq ifr = { 0 };
+	CAN_SocketClose();
+	can_socket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+	if (can_socket < 0)
+		return -1;
+	strncpy(ifr.ifr_name, interface, IFNAMSIZ - 1);
+	if (ioctl(can_socket, SIOCGIFINDEX, &ifr) < 0) {
+		CAN_SocketClose();
+		return -1;
+	}
+	addr.can_family = AF_CAN;
+	addr.can_ifindex = ifr.ifr_ifindex;
+	if (bind(can_socket, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+		CAN_SocketClose();
+		return -1;
+	}
+	fcntl(can_socket, F_SETFL, fcntl(can_socket, F_GETFL) | O_NONBLOCK);
+	//hardware timestamps if adapter supports them, software otherwise
+	int flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE | SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+	if (setsockopt(can_socket, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+		int on = 1;
+		setsockopt(can_socket, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+	}
+	rx_count = rx_pos = tx_count = 0;
+	socketApplyFilters();
+	return 0;
+}
+
+void CAN_SocketClose(void) {
+	if (can_socket >= 0)
+		close(can_socket);
+	can_socket = -1;
+}
+
+/// Waits for frames, receives them in batch and sends queued ones
+/// @param timeout_ms Maximum wait time, 0 - no wait
+/// @return Frames received, -1 on socket error
+int CAN_SocketPoll(int timeout_ms) {
+	struct mmsghdr msgs[CAN_SOCKET_BATCH];
+	struct iovec iovs[CAN_SOCKET_BATCH];
+	char control[CAN_SOCKET_BATCH][CMSG_SPACE(sizeof(struct timespec) * 3)];
+	int received = 0;
+	if (can_socket < 0)
+		return -1;
+	//queued frames first
+	LC_TransmitHandler();
+	CAN_SocketFlush();
+
+	struct pollfd pfd = { .fd = can_socket, .events = POLLIN | (tx_count ? POLLOUT : 0) };
+	if (poll(&pfd, 1, timeout_ms) < 0)
+		return -1;
+	if (pfd.revents & POLLIN) {
+		memset(msgs, 0, sizeof(msgs));
+		for (int i = 0; i < CAN_SOCKET_BATCH; i++) {
+			iovs[i].iov_base = &rx_frames[i];
+			iovs[i].iov_len = sizeof(struct can_frame);
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_control = control[i];
+			msgs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+		}
+		int count = recvmmsg(can_socket, msgs, CAN_SOCKET_BATCH, MSG_DONTWAIT, 0);
+		if (count > 0) {
+			for (int i = 0; i < count; i++)
+				socketTimestamp(&msgs[i].msg_hdr, &rx_time[i]);
+			rx_count = count;
+			rx_pos = 0;
+			//same as receive interrupt
+			LC_ReceiveHandler();
+			received = count;
+		}
+	}
+	//receive may produce answers
+	LC_TransmitHandler();
+	CAN_SocketFlush();
+	return received;
+}
+
+/// Writes collected frames with single system call
+/// @return Frames still waiting
+int CAN_SocketFlush(void) {
+	struct mmsghdr msgs[CAN_SOCKET_BATCH];
+	struct iovec iovs[CAN_SOCKET_BATCH];
+	if (tx_count == 0 || can_socket < 0)
+		return tx_count;
+	memset(msgs, 0, sizeof(struct mmsghdr) * tx_count);
+	for (int i = 0; i < tx_count; i++) {
+		iovs[i].iov_base = &tx_frames[i];
+		iovs[i].iov_len = sizeof(struct can_frame);
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	int sent = sendmmsg(can_socket, msgs, tx_count, MSG_DONTWAIT);
+	if (sent > 0) {
+		//kernel queue may be full, keep the rest in order
+		memmove(tx_frames, &tx_frames[sent], sizeof(struct can_frame) * (tx_count - sent));
+		tx_count -= sent;
+	}
+	return tx_count;
+}
+
+/// Receive time of last frame returned by CAN_Receive, ns
+uint64_t CAN_SocketTimestamp(void) {
+	return rx_last_time;
+}
+
+/// Returns 1 if adapter provided hardware timestamps
+uint8_t CAN_SocketHardwareTime(void) {
+	return can_hw_time;
+}
+
+/// Bit timing is configured by system: ip link set can0 type can bitrate 1000000
+void CAN_InitFromClock(uint32_t PCLK, uint32_t bitrate_khz, uint16_t sjw, uint16_t sample_point) {
+}
+
+void CAN_Init(uint32_t BTR) {
+}
+
+void CAN_Start(void) {
+}
+
+void CAN_FiltersClear(void) {
+	for (int i = 0; i < CAN_FilterSize; i++)
+		can_filters[i].Active = 0;
+	can_filter_edit = 0;
+	socketApplyFilters();
+}
+
+void CAN_FilterEditOn(void) {
+	can_filter_edit = 1;
+}
+
+CAN_Status CAN_CreateFilterIndex(CAN_IR reg, uint16_t fifo) {
+	return CAN_CreateFilterMask(reg, (CAN_IR ) { .ToUint32 = 0xFFFFFFFF }, fifo);
+}
+
+CAN_Status CAN_CreateFilterMask(CAN_IR reg, CAN_IR mask, uint8_t fifo) {
+	for (int bank = 0; bank < CAN_FilterSize; bank++)
+		if (can_filters[bank].Active == 0)
+			return CAN_FilterSetMask(bank, reg, mask, fifo);
+	return CANH_QueueFull;
+}
+
+void CAN_FilterEditOff(void) {
+	can_filter_edit = 0;
+	socketApplyFilters();
+}
+
+CAN_Status CAN_FilterSetMask(uint16_t bank, CAN_IR reg, CAN_IR mask, uint8_t fifo) {
+#ifdef CAN_ForceEXID
+	reg.ExtensionID = 1;
+	mask.ExtensionID = 1;
+#endif
+	if (bank >= CAN_FilterSize)
+		return CANH_Fail;
+	can_filters[bank].Reg = reg.ToUint32;
+	can_filters[bank].Mask = mask.ToUint32;
+	can_filters[bank].Active = 1;
+	socketApplyFilters();
+	return CANH_Ok;
+}
+
+void CAN_FilterDisable(uint16_t bank) {
+	if (bank >= CAN_FilterSize)
+		return;
+	can_filters[bank].Active = 0;
+	socketApplyFilters();
+}
+
+CAN_Status CAN_Send(uint32_t index32, uint32_t* data, uint16_t length) {
+	CAN_IR index = { .ToUint32 = index32 };
+#ifdef CAN_ForceEXID
+	index.ExtensionID = 1;
+#endif
+	if (length > 8)
+		return CANH_Fail;
+	if (tx_count == CAN_SOCKET_BATCH && CAN_SocketFlush() == CAN_SOCKET_BATCH)
+		return CANH_QueueFull;
+	struct can_frame* frame = &tx_frames[tx_count];
+	memset(frame, 0, sizeof(struct can_frame));
+	frame->can_id = socketId(index.ToUint32);
+	frame->can_dlc = length;
+	if (data)
+		memcpy(frame->data, data, length);
+	tx_count++;
+	return CANH_Ok;
+}
+
+CAN_Status CAN_Receive(uint32_t* index32, uint32_t* data, uint16_t* length) {
+	while (rx_pos < rx_count) {
+		struct can_frame* frame = &rx_frames[rx_pos];
+		rx_last_time = rx_time[rx_pos];
+		rx_pos++;
+		if (frame->can_id & CAN_ERR_FLAG)
+			continue;
+		*index32 = socketIndex(frame->can_id);
+		*length = frame->can_dlc > 8 ? 8 : frame->can_dlc;
+		if (data) {
+			data[0] = data[1] = 0;
+			memcpy(data, frame->data, *length);
+		}
+		return CANH_Ok;
+	}
+	return CANH_QueueEmpty;
+}
+
+canid_t socketId(uint32_t index32) {
+	canid_t id;
+	if (index32 & 4)
+		id = ((index32 >> 3) & CAN_EFF_MASK) | CAN_EFF_FLAG;
+	else
+		id = (index32 >> 21) & CAN_SFF_MASK;
+	if (index32 & 2)
+		id |= CAN_RTR_FLAG;
+	return id;
+}
+
+canid_t socketMask(uint32_t mask32) {
+	canid_t mask = (mask32 >> 3) & CAN_EFF_MASK;
+	if (mask32 & 4)
+		mask |= CAN_EFF_FLAG;
+	if (mask32 & 2)
+		mask |= CAN_RTR_FLAG;
+	return mask;
+}
+
+uint32_t socketIndex(canid_t id) {
+	uint32_t index32;
+	if (id & CAN_EFF_FLAG)
+		index32 = ((id & CAN_EFF_MASK) << 3) | 4;
+	else
+		index32 = (id & CAN_SFF_MASK) << 21;
+	if (id & CAN_RTR_FLAG)
+		index32 |= 2;
+	return index32;
+}
+
+void socketApplyFilters(void) {
+	struct can_filter filters[CAN_FilterSize];
+	int count = 0;
+	if (can_socket < 0 || can_filter_edit)
+		return;
+	for (int i = 0; i < CAN_FilterSize; i++) {
+		if (can_filters[i].Active == 0)
+			continue;
+		filters[count].can_id = socketId(can_filters[i].Reg);
+		filters[count].can_mask = socketMask(can_filters[i].Mask);
+		count++;
+	}
+	//empty list - nothing received, same as hardware without active banks
+	setsockopt(can_socket, SOL_CAN_RAW, CAN_RAW_FILTER, count ? filters : 0, sizeof(struct can_filter) * count);
+}
+
+void socketTimestamp(struct msghdr* msg, uint64_t* time) {
+	*time = 0;
+	for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET)
+			continue;
+		if (cmsg->cmsg_type == SO_TIMESTAMPING) {
+			struct timespec ts[3];
+			memcpy(ts, CMSG_DATA(cmsg), sizeof(ts));
+			//ts[2] - raw hardware, ts[0] - software
+			if (ts[2].tv_sec || ts[2].tv_nsec) {
+				*time = ts[2].tv_sec * 1000000000ull + ts[2].tv_nsec;
+				can_hw_time = 1;
+			} else
+				*time = ts[0].tv_sec * 1000000000ull + ts[0].tv_nsec;
+		} else if (cmsg->cmsg_type == SO_TIMESTAMPNS) {
+			struct timespec ts;
+			memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+			*time = ts.tv_sec * 1000000000ull + ts.tv_nsec;
+		}
+	}
+	if (*time == 0) {
+		struct timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		*time = now.tv_sec * 1000000000ull + now.tv_nsec;
+	}
+}
+
+//host memory for LEVCAN objects, see examples/host/levcan_config.h
+void* lc_host_malloc(uint32_t size) {
+	return malloc(size);
+}
+
+void lc_host_free(void* pointer) {
+	free(pointer);
+}
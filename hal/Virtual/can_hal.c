@@ -0,0 +1,141 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, host CAN driver on virtual bus
+ * can_hal.c
+ *
+ * One LEVCAN copy owns one port. To run many nodes in one process build LEVCAN with
+ * this driver as shared library and load it several times, see can_instance.c
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "can_hal.h"
+
+//private functions
+void rxInterrupt(void* context);
+void txInterrupt(void* context);
+//private variables
+CAN_VirtualPort_t can_port;
+extern void LC_ReceiveHandler(void);
+extern void LC_TransmitHandler(void);
+
+/// Bit timing is defined by bus, nothing to calculate here
+void CAN_InitFromClock(uint32_t PCLK, uint32_t bitrate_khz, uint16_t sjw, uint16_t sample_point) {
+	CAN_Init(0);
+}
+
+void CAN_Init(uint32_t BTR) {
+	memset(&can_port, 0, sizeof(can_port));
+	can_port.RxInterrupt = rxInterrupt;
+	can_port.TxInterrupt = txInterrupt;
+}
+
+void CAN_Start(void) {
+	for (int i = 0; i < CAN_VBUS_MAILBOXES; i++)
+		can_port.Mailbox[i].Full = 0;
+	can_port.RxCount = 0;
+}
+
+CAN_VirtualPort_t* CAN_VirtualPort(void) {
+	return &can_port;
+}
+
+void CAN_FiltersClear(void) {
+	for (int i = 0; i < CAN_FilterSize; i++)
+		can_port.Filter[i].Active = 0;
+	can_port.FilterInit = 0;
+}
+
+void CAN_FilterEditOn(void) {
+	can_port.FilterInit = 1;
+}
+
+CAN_Status CAN_CreateFilterIndex(CAN_IR reg, uint16_t fifo) {
+	//exact match is mask with all bits, except transmit
+	return CAN_CreateFilterMask(reg, (CAN_IR ) { .ToUint32 = 0xFFFFFFFF }, fifo);
+}
+
+CAN_Status CAN_CreateFilterMask(CAN_IR reg, CAN_IR mask, uint8_t fifo) {
+	for (int bank = 0; bank < CAN_FilterSize; bank++)
+		if (can_port.Filter[bank].Active == 0)
+			return CAN_FilterSetMask(bank, reg, mask, fifo);
+	return CANH_QueueFull;
+}
+
+void CAN_FilterEditOff(void) {
+	can_port.FilterInit = 0;
+}
+
+CAN_Status CAN_FilterSetMask(uint16_t bank, CAN_IR reg, CAN_IR mask, uint8_t fifo) {
+#ifdef CAN_ForceEXID
+	reg.ExtensionID = 1;
+	mask.ExtensionID = 1;
+#endif
+	if (bank >= CAN_FilterSize)
+		return CANH_Fail;
+	can_port.Filter[bank].Reg = reg.ToUint32 & ~1;
+	can_port.Filter[bank].Mask = mask.ToUint32 & ~1;
+	can_port.Filter[bank].Active = 1;
+	return CANH_Ok;
+}
+
+void CAN_FilterDisable(uint16_t bank) {
+	if (bank >= CAN_FilterSize)
+		return;
+	can_port.Filter[bank].Active = 0;
+}
+
+CAN_Status CAN_Send(uint32_t index32, uint32_t* data, uint16_t length) {
+	CAN_IR index = { .ToUint32 = index32 };
+#ifdef CAN_ForceEXID
+	index.ExtensionID = 1;
+#endif
+	if (length > 8)
+		return CANH_Fail;
+	for (int box = 0; box < CAN_VBUS_MAILBOXES; box++) {
+		if (can_port.Mailbox[box].Full)
+			continue;
+		can_port.Mailbox[box].Frame.Index = index.ToUint32 & ~1;
+		can_port.Mailbox[box].Frame.Length = length;
+		can_port.Mailbox[box].Frame.Data[0] = data ? data[0] : 0;
+		can_port.Mailbox[box].Frame.Data[1] = data ? data[1] : 0;
+		can_port.Mailbox[box].Queued = can_port.Time;
+		can_port.Mailbox[box].Order = can_port.TxOrder++;
+		can_port.Mailbox[box].Full = 1;
+		return CANH_Ok;
+	}
+	return CANH_QueueFull;
+}
+
+CAN_Status CAN_Receive(uint32_t* index32, uint32_t* data, uint16_t* length) {
+	if (can_port.RxCount == 0)
+		return CANH_QueueEmpty;
+	uint16_t out = (can_port.RxIn + CAN_VBUS_RX_DEPTH - can_port.RxCount) % CAN_VBUS_RX_DEPTH;
+	*index32 = can_port.Rx[out].Index;
+	*length = can_port.Rx[out].Length;
+	if (data) {
+		data[0] = can_port.Rx[out].Data[0];
+		data[1] = can_port.Rx[out].Data[1];
+	}
+	can_port.RxCount--;
+	return CANH_Ok;
+}
+
+void rxInterrupt(void* context) {
+	LC_ReceiveHandler();
+}
+
+void txInterrupt(void* context) {
+	LC_TransmitHandler();
+}
+
+//host memory for LEVCAN objects, see examples/host/levcan_config.h
+void* lc_host_malloc(uint32_t size) {
+	return malloc(size);
+}
+
+void lc_host_free(void* pointer) {
+	free(pointer);
+}
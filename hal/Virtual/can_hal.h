@@ -0,0 +1,77 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, host CAN driver on virtual bus
+ * can_hal.h
+ *
+ * Same interface as hal/STM32, hardware registers replaced by CAN_VirtualPort_t
+ *
+ *  Created on: 18 oct 2026
+ */
+#include "stdint.h"
+#include "can_vbus.h"
+
+#pragma once
+
+#define CAN_FilterSize CAN_VBUS_FILTERS
+
+#define CAN_ForceEXID
+//#define CAN_ForceSTID
+
+#define CAN_FIFO_0		0
+#define CAN_FIFO_1		1
+
+enum {
+	CAN_Request, CAN_Data
+};
+
+typedef enum {
+	CANH_Ok, CANH_QueueFull, CANH_QueueEmpty, CANH_Fail
+} CAN_Status;
+
+enum {
+	CANH_EC_No_Error,
+	CANH_EC_Stuff_Error,
+	CANH_EC_Form_Error,
+	CANH_EC_Acknowledgment_Error,
+	CANH_EC_Bit_recessive_Error,
+	CANH_EC_Bit_dominant_Error,
+	CANH_EC_CRC_Error,
+	CANH_EC_Set_by_software
+};
+//hardware level struct
+typedef union {
+	//union
+	uint32_t ToUint32;
+	//11 bit
+	struct {
+		unsigned Transmit11b :1;
+		unsigned Request11b :1;
+		unsigned ExtensionID11b :1;
+		unsigned reserved :18; //just skip those, use next one
+		unsigned STID :11;
+	}__attribute__((packed));
+	//29 bit
+	struct {
+		unsigned Transmit :1;
+		unsigned Request :1;
+		unsigned ExtensionID :1;
+		unsigned EXID :29;
+	}__attribute__((packed));
+} CAN_IR; //identifier register
+
+void CAN_InitFromClock(uint32_t PCLK, uint32_t bitrate_khz, uint16_t sjw, uint16_t sample_point);
+void CAN_Init(uint32_t BTR);
+void CAN_Start(void);
+
+void CAN_FiltersClear(void);
+void CAN_FilterEditOn(void);
+CAN_Status CAN_CreateFilterIndex(CAN_IR reg, uint16_t fifo);
+CAN_Status CAN_CreateFilterMask(CAN_IR reg, CAN_IR mask, uint8_t fifo);
+void CAN_FilterEditOff(void);
+//single bank editing, other banks keep receiving
+CAN_Status CAN_FilterSetMask(uint16_t bank, CAN_IR reg, CAN_IR mask, uint8_t fifo);
+void CAN_FilterDisable(uint16_t bank);
+
+CAN_Status CAN_Send(uint32_t index32, uint32_t* data, uint16_t length);
+CAN_Status CAN_Receive(uint32_t* index32, uint32_t* data, uint16_t* length);
+//port of this node, attach it to bus with CAN_VBusAttach
+CAN_VirtualPort_t* CAN_VirtualPort(void);
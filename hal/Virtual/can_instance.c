@@ -0,0 +1,89 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, multiple LEVCAN copies in one process
+ * can_instance.c
+ *
+ * Library file is copied before every load, dynamic loader treats copies as different
+ * libraries and gives each one own globals. Number of copies is not limited by
+ * dlmopen namespaces.
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "can_instance.h"
+
+//private functions
+int instanceCopy(const char* from, char* to);
+
+/// Loads new independent LEVCAN copy with virtual driver
+/// @param instance Output, entry points
+/// @param library Path to LEVCAN shared library
+/// @return 0 on success
+int CAN_InstanceLoad(CAN_Instance_t* instance, const char* library) {
+	char path[] = "/tmp/levcan_instance_XXXXXX.so";
+	memset(instance, 0, sizeof(CAN_Instance_t));
+	if (instanceCopy(library, path))
+		return -1;
+	instance->Handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	//mapped already, file is not needed
+	unlink(path);
+	if (instance->Handle == 0) {
+		fprintf(stderr, "%s\n", dlerror());
+		return -1;
+	}
+	instance->CreateNode = CAN_InstanceSymbol(instance, "LC_CreateNode");
+	instance->NetworkManager = CAN_InstanceSymbol(instance, "LC_NetworkManager");
+	instance->ReceiveHandler = CAN_InstanceSymbol(instance, "LC_ReceiveHandler");
+	instance->TransmitHandler = CAN_InstanceSymbol(instance, "LC_TransmitHandler");
+	instance->SendMessage = CAN_InstanceSymbol(instance, "LC_SendMessage");
+	instance->SendRequest = CAN_InstanceSymbol(instance, "LC_SendRequest");
+	instance->GetNode = CAN_InstanceSymbol(instance, "LC_GetNode");
+	instance->GetMetrics = CAN_InstanceSymbol(instance, "LC_GetMetrics");
+	void (*init)(uint32_t) = CAN_InstanceSymbol(instance, "CAN_Init");
+	CAN_VirtualPort_t* (*port)(void) = CAN_InstanceSymbol(instance, "CAN_VirtualPort");
+	if (init == 0 || port == 0 || instance->CreateNode == 0 || instance->NetworkManager == 0) {
+		CAN_InstanceUnload(instance);
+		return -1;
+	}
+	init(0);
+	instance->Port = port();
+	return 0;
+}
+
+/// Looks for any symbol in this copy
+void* CAN_InstanceSymbol(CAN_Instance_t* instance, const char* name) {
+	if (instance->Handle == 0)
+		return 0;
+	return dlsym(instance->Handle, name);
+}
+
+void CAN_InstanceUnload(CAN_Instance_t* instance) {
+	if (instance->Handle)
+		dlclose(instance->Handle);
+	memset(instance, 0, sizeof(CAN_Instance_t));
+}
+
+int instanceCopy(const char* from, char* to) {
+	FILE* in = fopen(from, "rb");
+	if (in == 0)
+		return -1;
+	int fd = mkstemps(to, 3);
+	if (fd < 0) {
+		fclose(in);
+		return -1;
+	}
+	FILE* out = fdopen(fd, "wb");
+	char buffer[4096];
+	size_t size;
+	while ((size = fread(buffer, 1, sizeof(buffer), in)) > 0)
+		fwrite(buffer, 1, size, out);
+	fclose(in);
+	fclose(out);
+	return 0;
+}
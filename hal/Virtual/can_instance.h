@@ -0,0 +1,37 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, multiple LEVCAN copies in one process
+ * can_instance.h
+ *
+ * LEVCAN keeps its state in globals, so every simulated device needs own copy of library.
+ * Build LEVCAN with virtual driver as shared library:
+ * gcc -shared -fPIC -O2 -Wl,-Bsymbolic -Iexamples/host -Isource -Ihal/Virtual source/levcan.c source/levcan_param.c
+ *   source/levcan_events.c source/levcan_publish.c source/levcan_filter.c source/levcan_trace.c source/levcan_busload.c
+ *   source/levcan_paramcache.c hal/Virtual/can_hal.c -o liblevcan_vnode.so
+ * and link host program with hal/Virtual/can_vbus.c hal/Virtual/can_instance.c -ldl
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "stdint.h"
+#include "levcan.h"
+#include "can_vbus.h"
+
+#pragma once
+
+typedef struct {
+	void* Handle;
+	CAN_VirtualPort_t* Port;
+	//entry points of this copy
+	uintptr_t* (*CreateNode)(LC_NodeInit_t node);
+	void (*NetworkManager)(uint32_t time);
+	void (*ReceiveHandler)(void);
+	void (*TransmitHandler)(void);
+	LC_Return_t (*SendMessage)(void* sender, LC_ObjectRecord_t* object, uint16_t index);
+	LC_Return_t (*SendRequest)(void* sender, uint16_t target, uint16_t index);
+	LC_NodeShortName_t (*GetNode)(uint16_t nodeID);
+	void (*GetMetrics)(LC_Metrics_t* metrics);
+} CAN_Instance_t;
+
+int CAN_InstanceLoad(CAN_Instance_t* instance, const char* library);
+void* CAN_InstanceSymbol(CAN_Instance_t* instance, const char* name);
+void CAN_InstanceUnload(CAN_Instance_t* instance);
@@ -0,0 +1,243 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, in-process virtual CAN bus
+ * can_vbus.c
+ *
+ * Frames are transmitted one by one in bus time. Every step each port offers its
+ * oldest mailbox to arbitration, lowest identifier wins like on real bus. Frame length
+ * is calculated bit-exact, including CRC and stuff bits.
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include <string.h>
+
+#include "can_vbus.h"
+
+//private functions
+uint32_t vbusRandom(CAN_VirtualBus_t* bus);
+void vbusSetTime(CAN_VirtualBus_t* bus, uint64_t time);
+uint64_t vbusBitsTime(CAN_VirtualBus_t* bus, uint32_t bits);
+
+/// Prepares empty bus
+/// @param bus Bus instance
+/// @param bitrate Bus speed, bit/s
+/// @param seed Random generator seed for loss injection
+void CAN_VBusInit(CAN_VirtualBus_t* bus, uint32_t bitrate, uint32_t seed) {
+	memset(bus, 0, sizeof(CAN_VirtualBus_t));
+	bus->Bitrate = bitrate;
+	bus->Seed = seed ? seed : 1;
+}
+
+/// Connects port to bus
+/// @param bus Bus instance
+/// @param port Node port, see CAN_VirtualPort()
+/// @return Port number or -1 if bus is full
+int CAN_VBusAttach(CAN_VirtualBus_t* bus, CAN_VirtualPort_t* port) {
+	if (bus->PortsCount >= CAN_VBUS_MAX_PORTS || port == 0)
+		return -1;
+	port->Time = bus->Time;
+	bus->Ports[bus->PortsCount] = port;
+	return bus->PortsCount++;
+}
+
+/// Exact extended frame length on wire
+/// @param frame Frame
+/// @return Bits including stuffing, ACK, EOF and interframe space
+uint16_t CAN_VBusFrameBits(const CAN_VirtualFrame_t* frame) {
+	uint8_t bits[160];
+	uint16_t count = 0;
+	uint32_t id = frame->Index >> 3;
+	uint8_t rtr = (frame->Index >> 1) & 1;
+	uint16_t length = frame->Length > 8 ? 8 : frame->Length;
+	const uint8_t* data = (const uint8_t*) frame->Data;
+
+	bits[count++] = 0; //SOF
+	for (int i = 28; i >= 18; i--)
+		bits[count++] = (id >> i) & 1;
+	bits[count++] = 1; //SRR
+	bits[count++] = 1; //IDE
+	for (int i = 17; i >= 0; i--)
+		bits[count++] = (id >> i) & 1;
+	bits[count++] = rtr;
+	bits[count++] = 0; //r1
+	bits[count++] = 0; //r0
+	for (int i = 3; i >= 0; i--)
+		bits[count++] = (length >> i) & 1;
+	if (rtr == 0)
+		for (int b = 0; b < length; b++)
+			for (int i = 7; i >= 0; i--)
+				bits[count++] = (data[b] >> i) & 1;
+	//CRC-15
+	uint16_t crc = 0;
+	for (int i = 0; i < count; i++) {
+		uint8_t next = bits[i] ^ ((crc >> 14) & 1);
+		crc = (crc << 1) & 0x7FFF;
+		if (next)
+			crc ^= 0x4599;
+	}
+	for (int i = 14; i >= 0; i--)
+		bits[count++] = (crc >> i) & 1;
+	//stuff bit after 5 equal bits, stuff bit starts new run
+	uint16_t stuffed = 0;
+	uint8_t last = bits[0], run = 1;
+	for (int i = 1; i < count; i++) {
+		if (bits[i] == last) {
+			run++;
+			if (run == 5) {
+				stuffed++;
+				last = !last;
+				run = 1;
+			}
+		} else {
+			last = bits[i];
+			run = 1;
+		}
+	}
+	//CRC delimiter, ACK slot and delimiter, EOF, intermission
+	return count + stuffed + 1 + 2 + 7 + 3;
+}
+
+/// Checks port acceptance filters
+/// @param port Node port
+/// @param index Frame identifier, CAN_IR format
+/// @return 1 if frame is accepted
+int CAN_VBusPortAccept(const CAN_VirtualPort_t* port, uint32_t index) {
+	if (port->FilterInit)
+		return 0;
+	for (int i = 0; i < CAN_VBUS_FILTERS; i++)
+		if (port->Filter[i].Active && ((index ^ port->Filter[i].Reg) & port->Filter[i].Mask) == 0)
+			return 1;
+	return 0;
+}
+
+/// Transmits one frame, winner of arbitration
+/// @param bus Bus instance
+/// @return 1 if bus was busy (frame or error frame), 0 if nothing to send
+int CAN_VBusStep(CAN_VirtualBus_t* bus) {
+	uint8_t received[CAN_VBUS_MAX_PORTS] = { 0 };
+	if (bus->Lock)
+		bus->Lock(bus->LockContext);
+	//arbitration: lowest 29-bit ID wins, data frame wins over remote
+	int win_port = -1, win_box = 0;
+	uint32_t win_key = 0;
+	for (int p = 0; p < bus->PortsCount; p++) {
+		CAN_VirtualPort_t* port = bus->Ports[p];
+		//node offers oldest mailbox, like bxCAN with TXFP (see hal/STM32)
+		int box = -1;
+		for (int m = 0; m < CAN_VBUS_MAILBOXES; m++) {
+			if (port->Mailbox[m].Full == 0)
+				continue;
+			if (box < 0)
+				box = m;
+			else if (port->IdOrder ? (port->Mailbox[m].Frame.Index >> 1) < (port->Mailbox[box].Frame.Index >> 1)
+					: (int32_t) (port->Mailbox[m].Order - port->Mailbox[box].Order) < 0)
+				box = m;
+		}
+		if (box < 0)
+			continue;
+		uint32_t index = port->Mailbox[box].Frame.Index;
+		uint32_t key = ((index >> 3) << 1) | ((index >> 1) & 1);
+		//same ID from two ports would be bit error on real bus, first port wins here
+		if (win_port < 0 || key < win_key) {
+			win_port = p;
+			win_box = box;
+			win_key = key;
+		}
+	}
+	if (win_port < 0) {
+		if (bus->Unlock)
+			bus->Unlock(bus->LockContext);
+		return 0;
+	}
+	CAN_VirtualPort_t* sender = bus->Ports[win_port];
+	CAN_VirtualFrame_t frame = sender->Mailbox[win_box].Frame;
+	uint16_t bits = CAN_VBusFrameBits(&frame);
+	uint64_t start = bus->Time;
+
+	if (bus->ErrorRate && (vbusRandom(bus) & 0xFFFF) < bus->ErrorRate) {
+		//error somewhere in frame, error flag + delimiter + intermission, mailbox retransmits
+		uint32_t error_bits = 1 + vbusRandom(bus) % bits + 6 + 8 + 3;
+		bus->ErrorFrames++;
+		bus->BusyTime += vbusBitsTime(bus, error_bits);
+		vbusSetTime(bus, start + vbusBitsTime(bus, error_bits));
+		if (bus->Unlock)
+			bus->Unlock(bus->LockContext);
+		return 1;
+	}
+	uint64_t end = start + vbusBitsTime(bus, bits);
+	sender->Mailbox[win_box].Full = 0;
+	sender->TxFrames++;
+	bus->Frames++;
+	bus->BusyTime += end - start;
+	vbusSetTime(bus, end);
+	//deliver to all other nodes, controller does not receive own frames
+	for (int p = 0; p < bus->PortsCount; p++) {
+		CAN_VirtualPort_t* port = bus->Ports[p];
+		if (p == win_port)
+			continue;
+		if (!CAN_VBusPortAccept(port, frame.Index)) {
+			port->Rejected++;
+			continue;
+		}
+		if (bus->DropRate && (vbusRandom(bus) & 0xFFFF) < bus->DropRate) {
+			port->Dropped++;
+			continue;
+		}
+		if (port->RxCount >= CAN_VBUS_RX_DEPTH) {
+			port->Overruns++;
+			continue;
+		}
+		port->Rx[port->RxIn] = frame;
+		port->RxTime[port->RxIn] = end;
+		port->RxIn = (port->RxIn + 1) % CAN_VBUS_RX_DEPTH;
+		port->RxCount++;
+		port->RxFrames++;
+		received[p] = 1;
+	}
+	if (bus->Monitor)
+		bus->Monitor(bus->MonitorContext, &frame, start, end, win_port);
+	if (bus->Unlock)
+		bus->Unlock(bus->LockContext);
+	//interrupts
+	for (int p = 0; p < bus->PortsCount; p++)
+		if (received[p] && bus->Ports[p]->RxInterrupt)
+			bus->Ports[p]->RxInterrupt(bus->Ports[p]->Context);
+	if (sender->TxInterrupt)
+		sender->TxInterrupt(sender->Context);
+	return 1;
+}
+
+/// Transmits frames until bus time reaches given value. Idle bus jumps forward
+/// @param bus Bus instance
+/// @param until Bus time, ns
+/// @return Frames transmitted
+uint32_t CAN_VBusRun(CAN_VirtualBus_t* bus, uint64_t until) {
+	uint32_t frames = bus->Frames;
+	while (bus->Time < until) {
+		if (CAN_VBusStep(bus) == 0) {
+			vbusSetTime(bus, until);
+			break;
+		}
+	}
+	return bus->Frames - frames;
+}
+
+uint32_t vbusRandom(CAN_VirtualBus_t* bus) {
+	//xorshift32
+	uint32_t x = bus->Seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	bus->Seed = x;
+	return x;
+}
+
+void vbusSetTime(CAN_VirtualBus_t* bus, uint64_t time) {
+	bus->Time = time;
+	for (int p = 0; p < bus->PortsCount; p++)
+		bus->Ports[p]->Time = time;
+}
+
+uint64_t vbusBitsTime(CAN_VirtualBus_t* bus, uint32_t bits) {
+	return (uint64_t) bits * 1000000000ull / bus->Bitrate;
+}
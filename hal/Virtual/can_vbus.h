@@ -0,0 +1,95 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, in-process virtual CAN bus
+ * can_vbus.h
+ *
+ * Bus model has no global state: ports are plain structures owned by node instances
+ * (see can_hal.c in this folder), bus keeps pointers to them. Bus and ports can live in
+ * different shared objects, so any number of LEVCAN copies can share one bus.
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "stdint.h"
+
+#pragma once
+
+#define CAN_VBUS_MAILBOXES 3
+#ifndef CAN_VBUS_RX_DEPTH
+#define CAN_VBUS_RX_DEPTH 3 //bxCAN FIFO depth
+#endif
+#ifndef CAN_VBUS_FILTERS
+#define CAN_VBUS_FILTERS 28
+#endif
+#ifndef CAN_VBUS_MAX_PORTS
+#define CAN_VBUS_MAX_PORTS 64
+#endif
+
+typedef struct {
+	uint32_t Index; //CAN_IR format
+	uint32_t Data[2];
+	uint16_t Length;
+} CAN_VirtualFrame_t;
+
+typedef struct {
+	//transmit mailboxes, filled by CAN_Send
+	struct {
+		CAN_VirtualFrame_t Frame;
+		uint8_t Full;
+		uint64_t Queued; //bus time when frame was queued, ns
+		uint32_t Order; //queue order, node transmits oldest frame first
+	} Mailbox[CAN_VBUS_MAILBOXES];
+	uint32_t TxOrder;
+	uint8_t IdOrder; //1 - lowest identifier mailbox goes first (bxCAN without TXFP)
+	//receive fifo
+	CAN_VirtualFrame_t Rx[CAN_VBUS_RX_DEPTH];
+	uint64_t RxTime[CAN_VBUS_RX_DEPTH]; //end of frame time, ns
+	uint16_t RxIn, RxCount;
+	//acceptance filters, mask mode only
+	struct {
+		uint32_t Reg;
+		uint32_t Mask;
+		uint8_t Active;
+	} Filter[CAN_VBUS_FILTERS];
+	uint8_t FilterInit; //all frames rejected while filters are edited
+	//interrupt callbacks, called by bus
+	void (*RxInterrupt)(void* context);
+	void (*TxInterrupt)(void* context);
+	void* Context;
+	//statistics
+	uint32_t TxFrames;
+	uint32_t RxFrames;
+	uint32_t Overruns; //fifo full, frame lost
+	uint32_t Dropped; //injected receive loss
+	uint32_t Rejected; //filtered out
+	//bus time, updated by bus before callbacks
+	volatile uint64_t Time;
+} CAN_VirtualPort_t;
+
+typedef struct {
+	CAN_VirtualPort_t* Ports[CAN_VBUS_MAX_PORTS];
+	uint16_t PortsCount;
+	uint32_t Bitrate; //bit/s
+	uint64_t Time; //ns
+	//loss injection, 1/65536 units
+	uint16_t ErrorRate; //frame destroyed by error frame, sender retransmits
+	uint16_t DropRate; //frame silently lost by single receiver
+	uint32_t Seed; //PRNG state, same seed - same run
+	//optional locking when nodes run in own threads
+	void (*Lock)(void* context);
+	void (*Unlock)(void* context);
+	void* LockContext;
+	//optional observer, called after every transmitted frame
+	void (*Monitor)(void* context, const CAN_VirtualFrame_t* frame, uint64_t start, uint64_t end, uint16_t sender);
+	void* MonitorContext;
+	//statistics
+	uint32_t Frames;
+	uint32_t ErrorFrames;
+	uint64_t BusyTime; //ns
+} CAN_VirtualBus_t;
+
+void CAN_VBusInit(CAN_VirtualBus_t* bus, uint32_t bitrate, uint32_t seed);
+int CAN_VBusAttach(CAN_VirtualBus_t* bus, CAN_VirtualPort_t* port);
+uint16_t CAN_VBusFrameBits(const CAN_VirtualFrame_t* frame);
+int CAN_VBusStep(CAN_VirtualBus_t* bus);
+uint32_t CAN_VBusRun(CAN_VirtualBus_t* bus, uint64_t until);
+int CAN_VBusPortAccept(const CAN_VirtualPort_t* port, uint32_t index);
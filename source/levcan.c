@@ -7,10 +7,17 @@
  */
 
 #include "levcan.h"
+#include "levcan_internal.h"
 #include "levcan_param.h"
+#include "levcan_filter.h"
+#include "levcan_trace.h"
+#ifdef LEVCAN_BUSLOAD
+#include "levcan_busload.h"
+#endif
 
 #include "string.h"
 #include "stdlib.h"
+#include "stddef.h"
 #include "can_hal.h"
 
 #if	defined(lcmalloc) && defined(lcfree)
@@ -28,23 +35,6 @@ extern void lcfree(void *pointer);
 #if LEVCAN_OBJECT_DATASIZE < 8
 #error "LEVCAN_OBJECT_DATASIZE should be more than one 8 byte for static memory"
 #endif
-typedef union {
-	uint32_t ToUint32;
-	struct {
-		//can specific:
-		unsigned reserved1 :1;
-		unsigned Request :1;
-		unsigned IDE :1;    //29b=1
-		//index 29bit:
-		unsigned Source :7;
-		unsigned Target :7;
-		unsigned MsgID :10;
-		unsigned EoM :1;
-		unsigned Parity :1;
-		unsigned RTS_CTS :1;
-		unsigned Priority :2;
-	}LEVCAN_PACKED;
-} headerPacked_t;
 
 typedef struct {
 	headerPacked_t header;
@@ -78,9 +68,6 @@ enum {
 	Read, Write
 };
 
-#ifdef LEVCAN_TRACE
-extern int trace_printf(const char* format, ...);
-#endif
 
 //#### PRIVATE VARIABLES ####
 #ifdef LEVCAN_STATIC_MEM
@@ -97,17 +84,60 @@ msgBuffered txFIFO[LEVCAN_TX_SIZE];
 volatile uint16_t txFIFO_in, txFIFO_out;
 msgBuffered rxFIFO[LEVCAN_RX_SIZE];
 volatile uint16_t rxFIFO_in, rxFIFO_out;
+#ifdef LEVCAN_RX_DEFERRED_SIZE
+msgBuffered rxDeferred[LEVCAN_RX_DEFERRED_SIZE];
+volatile uint16_t rxDeferred_in, rxDeferred_out;
+#endif
+volatile LC_RxStats_t rx_stats;
+volatile LC_Metrics_t lc_metrics;
 volatile uint16_t own_node_count;
-#ifdef DEBUG
-volatile uint32_t lc_collision_cntr = 0;
-volatile uint32_t lc_receive_ovfl_cntr = 0;
+//hardware filter banks content
+struct {
+	LC_FilterRule_t Rule;
+	uint8_t Used;
+} filter_banks[CAN_FilterSize];
+//indices received without dictionary entry, LC_FilterSubscribe
+const uint16_t* filter_subscriptions = 0;
+uint16_t filter_subscriptions_size = 0;
+#ifdef LEVCAN_SOFTWARE_FILTER
+//bit per message index, system messages always pass
+volatile uint32_t soft_filter_data[LC_SYS_AddressClaimed / 32];
+volatile uint32_t soft_filter_request[LC_SYS_AddressClaimed / 32];
+//bit per target address
+volatile uint32_t soft_filter_target[4];
+#endif
+#ifdef LEVCAN_WARM_START
+uint8_t warm_table_changed;
+uint32_t warm_save_timer;
+#endif
+#ifdef LEVCAN_CLAIM_SPREAD
+uint32_t claim_seed = 1;
+uint32_t claim_seen[2]; //every claimed free range id, node table may be too small to hold them
+#endif
+#ifdef LEVCAN_HEARTBEAT
+uint32_t heartbeat_rollcall[4]; //nodes already asked by others in this aging period
 #endif
 //#### PRIVATE FUNCTIONS ####
 void initialize(void);
 void configureFilters(void);
-void addAddressFilter(uint16_t address);
+LC_FilterRule_t addressFilter(uint16_t address);
+void applyFilters(const LC_FilterRule_t* rules, int16_t count);
 void proceedAddressClaim(LC_NodeDescription_t* node, LC_Header_t header, void* data, int32_t size);
 void claimFreeID(LC_NodeDescription_t* node);
+uint16_t findFreeID(LC_NodeDescription_t* node, uint16_t freeid);
+uint16_t nextFreeID(LC_NodeDescription_t* node, uint16_t freeid);
+#ifdef LEVCAN_CLAIM_SPREAD
+void claimBackoff(LC_NodeDescription_t* node);
+uint8_t claimSeen(uint16_t nodeID, uint8_t set);
+uint32_t claimHash(uint32_t value);
+uint32_t claimRandom(void);
+uint16_t claimGcd(uint16_t a, uint16_t b);
+#endif
+#ifdef LEVCAN_HEARTBEAT
+void proceedHeartbeat(LC_NodeDescription_t* node, LC_Header_t header, void* data, int32_t size);
+void heartbeatSend(LC_NodeDescription_t* node, uint8_t base, const uint8_t* rollcall);
+void heartbeatRollCall(uint32_t* rollcall);
+#endif
 
 int16_t compareNode(LC_NodeShortName_t a, LC_NodeShortName_t b);
 LC_NodeDescription_t* findNode(uint16_t nodeID);
@@ -118,6 +148,9 @@ LC_Header_t headerUnpack(headerPacked_t header);
 
 LC_Return_t sendDataToQueue(headerPacked_t hdr, uint32_t data[], uint8_t length);
 uint16_t objectRXproceed(objBuffered* object, msgBuffered* msg);
+uint8_t receivePop(msgBuffered* msg);
+void countFrame(headerPacked_t hdr, uint16_t mode);
+void countPeer(uint16_t nodeID, uint16_t length, uint16_t mode);
 uint16_t objectTXproceed(objBuffered* object, headerPacked_t* request);
 LC_Return_t objectRXfinish(headerPacked_t header, char* data, int32_t size, uint8_t memfree);
 void deleteObject(objBuffered* obj, objBuffered** start, objBuffered** end);
@@ -131,13 +164,28 @@ uint16_t searchIndexCollision(uint16_t nodeID, LC_NodeDescription_t* ownNode);
 objBuffered* findObject(objBuffered* array, uint16_t msgID, uint8_t target, uint8_t source);
 
 void lc_default_handler(LC_NodeDescription_t* node, LC_Header_t header, void* data, int32_t size);
+void lc_default_manager(uint32_t time);
+#ifdef LEVCAN_WARM_START
+uint8_t warmStartRestore(LC_NodeDescription_t* node);
+void warmStartFail(LC_NodeDescription_t* node);
+uint32_t warmStartChecksum(const LC_WarmStart_t* state);
+LC_Return_t lc_default_warm_load(uint32_t serial, LC_WarmStart_t* state);
+void lc_default_warm_save(const LC_WarmStart_t* state);
+#endif
 //#### EXTERNAL MODULES #### todo: other compiler support
 #ifdef LEVCAN_EVENTS
 extern volatile uint8_t lc_eventButtonPressed;
 #endif
+#ifdef LEVCAN_BUSLOAD
+extern LC_BusLoad_t lc_busload;
+#endif
 #ifdef LEVCAN_PARAMETERS
 extern void __attribute__((weak, alias("lc_default_handler")))
 lc_proceedParam(LC_NodeDescription_t* node, LC_Header_t header, void* data, int32_t size);
+extern void __attribute__((weak, alias("lc_default_handler")))
+lc_proceedParamEx(LC_NodeDescription_t* node, LC_Header_t header, void* data, int32_t size);
+extern void __attribute__((weak, alias("lc_default_manager")))
+lc_paramManager(uint32_t time);
 #endif
 #ifdef LEVCAN_FILESERVER
 extern void __attribute__((weak, alias("lc_default_handler")))
@@ -147,6 +195,13 @@ proceedFileServer(LC_NodeDescription_t* node, LC_Header_t header, void* data, in
 extern void __attribute__((weak, alias("lc_default_handler")))
 proceedFileClient(LC_NodeDescription_t* node, LC_Header_t header, void* data, int32_t size);
 #endif
+#ifdef LEVCAN_WARM_START
+//user storage, for example backup registers or flash
+extern LC_Return_t __attribute__((weak, alias("lc_default_warm_load")))
+lc_warmStartLoad(uint32_t serial, LC_WarmStart_t* state);
+extern void __attribute__((weak, alias("lc_default_warm_save")))
+lc_warmStartSave(const LC_WarmStart_t* state);
+#endif
 //#### FUNCTIONS
 const LC_Object_t prclaim = {
 		.Address = proceedAddressClaim, .Attributes.Readable = 1, .Attributes.Writable = 1, .Attributes.Function = 1, .Index = LC_SYS_AddressClaimed, .Size = 8 };
@@ -154,13 +209,23 @@ uintptr_t* LC_CreateNode(LC_NodeInit_t node) {
 	initialize();
 
 	if (node.NodeID < 0 || node.NodeID > 125) {
+#ifdef LEVCAN_CLAIM_SPREAD
+		//whole free range, serials with same low bits get different ids
+		node.NodeID = LC_NodeFreeIDmin + claimHash(node.Serial) % (LC_NodeFreeIDmax - LC_NodeFreeIDmin + 1);
+#else
 		uint16_t id = node.Serial % 64;
 		id |= 64;
 		if (id > 125) {
 			id &= ~3;
 		}
 		node.NodeID = id;
+#endif
 	}
+#ifdef LEVCAN_CLAIM_SPREAD
+	claim_seed ^= claimHash(node.Serial ^ 0x5A5A5A5A);
+	if (claim_seed == 0)
+		claim_seed = 1;
+#endif
 	if (node.NodeName != 0 && strnlen(node.NodeName, 128) == 128)
 		node.NodeName = 0;    //too long name
 	if (node.DeviceName != 0 && strnlen(node.DeviceName, 128) == 128)
@@ -250,6 +315,25 @@ uintptr_t* LC_CreateNode(LC_NodeInit_t node) {
 	objparam->Index = LC_SYS_Events;
 	objparam->Size = sizeof(lc_eventButtonPressed);
 #endif
+#ifdef LEVCAN_BUSLOAD
+//bus load estimation
+	objparam = &newnode->SystemObjects[sysinx++];
+	objparam->Address = &lc_busload;
+	objparam->Attributes.Readable = 1;
+	objparam->Index = LC_SYS_BusLoad;
+	objparam->Size = sizeof(lc_busload);
+#endif
+#ifdef LEVCAN_HEARTBEAT
+//liveness of other nodes
+	newnode->HeartbeatPeriod = node.HeartbeatPeriod ? node.HeartbeatPeriod : LEVCAN_HEARTBEAT_PERIOD;
+	newnode->HeartbeatTime = 0;
+	objparam = &newnode->SystemObjects[sysinx++];
+	objparam->Address = proceedHeartbeat;
+	objparam->Attributes.Writable = 1;
+	objparam->Attributes.Function = 1;
+	objparam->Index = LC_SYS_Heartbeat;
+	objparam->Size = sizeof(LC_Heartbeat_t);
+#endif
 //todo add server also?!
 #ifdef LEVCAN_PARAMETERS
 	if (newnode->ShortName.Configurable && lc_proceedParam != lc_default_handler) {
@@ -262,6 +346,16 @@ uintptr_t* LC_CreateNode(LC_NodeInit_t node) {
 		objparam->Index = LC_SYS_Parameters;
 		objparam->Size = -1;
 	}
+	if (newnode->ShortName.Configurable && lc_proceedParamEx != lc_default_handler) {
+		//parameter editor, extended requests with opcode
+		objparam = &newnode->SystemObjects[sysinx++];
+		objparam->Address = lc_proceedParamEx;
+		objparam->Attributes.Writable = 1;
+		objparam->Attributes.Function = 1;
+		objparam->Attributes.TCP = 1;
+		objparam->Index = LC_SYS_ParametersEx;
+		objparam->Size = -1;
+	}
 #endif
 #ifdef LEVCAN_FILESERVER
 	if (node.FileServer && proceedFileServer != lc_default_handler) {
@@ -287,6 +381,15 @@ uintptr_t* LC_CreateNode(LC_NodeInit_t node) {
 		objparam->Size = -1;      //anysize
 	}
 #endif
+#ifdef LEVCAN_WARM_START
+	//claim last id, no discovery
+	if (warmStartRestore(newnode))
+		return (uintptr_t*) &own_nodes[i];
+#endif
+#ifdef LEVCAN_CLAIM_SPREAD
+	newnode->ClaimAttempts = 0;
+	newnode->ClaimBackoff = (claimRandom() % LEVCAN_CLAIM_SLOTS) * LEVCAN_CLAIM_SLOT;
+#endif
 //begin network discovery for start
 	newnode->LastTXtime = 0;
 	LC_SendDiscoveryRequest(LC_Broadcast_Address);
@@ -298,6 +401,20 @@ void lc_default_handler(LC_NodeDescription_t* node, LC_Header_t header, void* da
 
 }
 
+void lc_default_manager(uint32_t time) {
+
+}
+
+#ifdef LEVCAN_WARM_START
+LC_Return_t lc_default_warm_load(uint32_t serial, LC_WarmStart_t* state) {
+	return LC_DataError;
+}
+
+void lc_default_warm_save(const LC_WarmStart_t* state) {
+
+}
+#endif
+
 void initialize(void) {
 	static uint16_t startup = 0;
 	if (startup)
@@ -308,6 +425,12 @@ void initialize(void) {
 	rxFIFO_in = 0;
 	rxFIFO_out = 0;
 	memset(rxFIFO, 0, sizeof(rxFIFO));
+#ifdef LEVCAN_RX_DEFERRED_SIZE
+	rxDeferred_in = 0;
+	rxDeferred_out = 0;
+#endif
+	memset((void*) &rx_stats, 0, sizeof(rx_stats));
+	memset((void*) &lc_metrics, 0, sizeof(lc_metrics));
 
 	txFIFO_in = 0;
 	txFIFO_out = 0;
@@ -327,6 +450,9 @@ void initialize(void) {
 		objectBuffer[i].Previous = 0;
 	}
 #endif
+	//start from empty banks, later only deltas applied
+	memset(filter_banks, 0, sizeof(filter_banks));
+	CAN_FiltersClear();
 	configureFilters();
 }
 
@@ -386,10 +512,14 @@ void LC_AddressClaimHandler(LC_NodeShortName_t node, uint16_t mode) {
 		 * or add it to table if there is none, or update existing if possible
 		 * */
 		if (node.NodeID < LC_Null_Address) {
+#ifdef LEVCAN_CLAIM_SPREAD
+			claimSeen(node.NodeID, 1);
+#endif
 			for (int i = 0; i < LEVCAN_MAX_OWN_NODES; i++) {
 				if (own_nodes[i].ShortName.NodeID == node.NodeID && own_nodes[i].State >= LCNodeState_WaitingClaim) {
 					//same address
 					ownfound = 1;
+					lc_metrics.AddressCollisions++;
 					if (compareNode(own_nodes[i].ShortName, node) != -1) {
 						idlost = 1;    //if we loose this id, we should try to add new node to table
 						//less value - more priority. our not less, reset address
@@ -400,18 +530,21 @@ void LC_AddressClaimHandler(LC_NodeShortName_t node, uint16_t mode) {
 						//later we will find new id
 						own_nodes[i].ShortName.NodeID = LC_Null_Address;
 						own_nodes[i].State = LCNodeState_WaitingClaim;
-						configureFilters();
-#ifdef LEVCAN_TRACE
-						trace_printf("We lost ID:%d\n", node.NodeID);
+#ifdef LEVCAN_CLAIM_SPREAD
+						claimBackoff(&own_nodes[i]);
 #endif
+#ifdef LEVCAN_WARM_START
+						if (own_nodes[i].WarmStart)
+							warmStartFail(&own_nodes[i]);
+#endif
+						configureFilters();
+						LC_TRACE(LC_TE_IdLost, node.NodeID, 0, 0);
 					} else {
 						//send own data to break other node id
 						header.Source = own_nodes[i].ShortName.NodeID;
 						data[0] = own_nodes[i].ShortName.ToUint32[0];
 						data[1] = own_nodes[i].ShortName.ToUint32[1];
-#ifdef LEVCAN_TRACE
-						trace_printf("Collision found ID:%d\n", node.NodeID);
-#endif
+						LC_TRACE(LC_TE_IdCollision, node.NodeID, 0, 0);
 					}
 					break;
 				}
@@ -421,10 +554,11 @@ void LC_AddressClaimHandler(LC_NodeShortName_t node, uint16_t mode) {
 			for (int i = 0; i < LEVCAN_MAX_TABLE_NODES; i++)
 				if (compareNode(node_table[i].ShortName, node) == 0) {
 					//compare by short name, if found - delete this instance
-#ifdef LEVCAN_TRACE
-					trace_printf("Lost S/N:%08X ID:%d\n", node.SerialNumber, node_table[i].ShortName.NodeID);
-#endif
+					LC_TRACE(LC_TE_NodeLostId, node_table[i].ShortName.NodeID, node.SerialNumber, 0);
 					node_table[i].ShortName.NodeID = LC_Broadcast_Address;
+#ifdef LEVCAN_WARM_START
+					warm_table_changed = 1;
+#endif
 					return;
 				}
 			return;
@@ -444,11 +578,14 @@ void LC_AddressClaimHandler(LC_NodeShortName_t node, uint16_t mode) {
 						//less value - more priority. our table not less, setup new short name
 						node_table[i].ShortName = node;
 						node_table[i].LastRXtime = 0;
-#ifdef LEVCAN_TRACE
-						trace_printf("Replaced ID: %d from S/N: 0x%04X to S/N: 0x%04X\n",
-								node_table[i].ShortName.NodeID,
-								node_table[i].ShortName.SerialNumber,
-								node.SerialNumber);
+						node_table[i].RxBytes = 0;
+						node_table[i].TxBytes = 0;
+#ifdef LEVCAN_HEARTBEAT
+						node_table[i].HeartbeatPeriod = 0;
+#endif
+						LC_TRACE(LC_TE_NodeReplaced, node_table[i].ShortName.NodeID, node_table[i].ShortName.SerialNumber, node.SerialNumber);
+#ifdef LEVCAN_WARM_START
+						warm_table_changed = 1;
 #endif
 					} else if (eql == 0) {
 						//	trace_printf("Claim Update ID: %d\n", node_table[i].ShortName.NodeID);
@@ -460,8 +597,14 @@ void LC_AddressClaimHandler(LC_NodeShortName_t node, uint16_t mode) {
 			if (empty != 255) {
 				node_table[empty].ShortName = node;
 				node_table[empty].LastRXtime = 0;
-#ifdef LEVCAN_TRACE
-				trace_printf("New node detected ID:%d\n", node.NodeID);
+				node_table[empty].RxBytes = 0;
+				node_table[empty].TxBytes = 0;
+#ifdef LEVCAN_HEARTBEAT
+				node_table[empty].HeartbeatPeriod = 0;
+#endif
+				LC_TRACE(LC_TE_NodeNew, node.NodeID, 0, 0);
+#ifdef LEVCAN_WARM_START
+				warm_table_changed = 1;
 #endif
 			}
 			if (!idlost)
@@ -479,37 +622,59 @@ void LC_AddressClaimHandler(LC_NodeShortName_t node, uint16_t mode) {
 	sendDataToQueue(header, data, 8);
 }
 
-void configureFilters(void) {
-
-	CAN_FiltersClear();
-	CAN_FilterEditOn();
-//global filter
-	headerPacked_t reg = { 0 }, mask = { 0 };
-	reg.MsgID = LC_SYS_AddressClaimed;
-//reg.RTS_CTS = 0;    //no matter
-//reg.Parity = 0;    // no matter
-//reg.Priority = 0;    //no matter
-//reg.Source = 0;    //any source
-	reg.Target = LC_Broadcast_Address;    //we are target- Broadcast, this should match
-//reg.Request = 0;
-//fill can mask match
-	mask = reg;
-	if (own_nodes[0].ShortName.NodeID < LC_Null_Address) {
-		mask.MsgID = 0;    //match any brdcast
-	} else
-		mask.MsgID = 0x3F0;    //match for first 16 system messages
-//mask.Request = 0;    //any request or data
-//type cast
-	CAN_CreateFilterMask((CAN_IR ) { .ToUint32 = reg.ToUint32 }, (CAN_IR ) { .ToUint32 = mask.ToUint32 }, 0);
+/// Sets additional message indices to be received, that are not in object dictionary.
+/// For example TCP messages sent by LC_SendMessage with custom index need clear-to-send requests.
+/// Used by filter planner and software filter
+/// @param indices Array of MsgID, should be static
+/// @param size Array size
+void LC_FilterSubscribe(const uint16_t* indices, uint16_t size) {
+	filter_subscriptions = indices;
+	filter_subscriptions_size = size;
+	configureFilters();
+}
 
-	for (int i = 0; i < LEVCAN_MAX_OWN_NODES; i++) {
-		if (own_nodes[i].ShortName.NodeID < LC_Null_Address)
-			addAddressFilter(own_nodes[i].ShortName.NodeID);
+void configureFilters(void) {
+	LC_FilterRule_t rules[CAN_FilterSize];
+	int16_t count = -1;
+#ifdef LEVCAN_FILTER_PLANNER
+	//exact filters for dictionary indices, keep one bank spare for make-before-break updates
+	count = LC_FilterPlan(own_nodes, LEVCAN_MAX_OWN_NODES, rules, CAN_FilterSize - 1);
+	//planner failed? use wide filters
+#endif
+	if (count <= 0) {
+		count = 0;
+		//global filter
+		headerPacked_t reg = { 0 }, mask = { 0 };
+		reg.MsgID = LC_SYS_AddressClaimed;
+		//reg.RTS_CTS = 0;    //no matter
+		//reg.Parity = 0;    // no matter
+		//reg.Priority = 0;    //no matter
+		//reg.Source = 0;    //any source
+		reg.Target = LC_Broadcast_Address;    //we are target- Broadcast, this should match
+		//reg.Request = 0;
+		//fill can mask match
+		mask = reg;
+		if (own_nodes[0].ShortName.NodeID < LC_Null_Address) {
+			mask.MsgID = 0;    //match any brdcast
+		} else
+			mask.MsgID = 0x3F0;    //match for first 16 system messages
+		//mask.Request = 0;    //any request or data
+		rules[count].Reg = reg.ToUint32;
+		rules[count].Mask = mask.ToUint32;
+		count++;
+
+		for (int i = 0; i < LEVCAN_MAX_OWN_NODES && count < CAN_FilterSize; i++) {
+			if (own_nodes[i].ShortName.NodeID < LC_Null_Address)
+				rules[count++] = addressFilter(own_nodes[i].ShortName.NodeID);
+		}
 	}
-	CAN_FilterEditOff();
+	applyFilters(rules, count);
+#ifdef LEVCAN_SOFTWARE_FILTER
+	LC_SoftFilterUpdate();
+#endif
 }
 
-void addAddressFilter(uint16_t address) {
+LC_FilterRule_t addressFilter(uint16_t address) {
 //global filter
 	headerPacked_t reg = { 0 }, mask = { 0 };
 //reg.MsgID = 0;    //no matter
@@ -524,10 +689,106 @@ void addAddressFilter(uint16_t address) {
 //mask.MsgID = 0;    //match any
 	mask.Target = LC_Broadcast_Address;    // should match
 //mask.Request = 0;    //any request or data
-//type cast
-	CAN_CreateFilterMask((CAN_IR ) { .ToUint32 = reg.ToUint32 }, (CAN_IR ) { .ToUint32 = mask.ToUint32 }, 0);
+	return (LC_FilterRule_t ) { .Reg = reg.ToUint32, .Mask = mask.ToUint32 };
+}
+
+void applyFilters(const LC_FilterRule_t* rules, int16_t count) {
+	//bank already holds wanted rule?
+	uint8_t keep[CAN_FilterSize] = { 0 };
+	uint8_t present[CAN_FilterSize] = { 0 };
+	for (int r = 0; r < count; r++)
+		for (int b = 0; b < CAN_FilterSize; b++)
+			if (filter_banks[b].Used && filter_banks[b].Rule.Reg == rules[r].Reg && filter_banks[b].Rule.Mask == rules[r].Mask) {
+				keep[b] = 1;
+				present[r] = 1;
+				break;
+			}
+	//add new rules first, so there is no window where frame rejected by both
+	for (int r = 0; r < count; r++) {
+		if (present[r])
+			continue;
+		int bank = 0;
+		for (; bank < CAN_FilterSize && filter_banks[bank].Used; bank++)
+			;
+		if (bank == CAN_FilterSize) {
+			//no spare banks, drop one outdated rule now
+			for (bank = 0; bank < CAN_FilterSize && (keep[bank] || !filter_banks[bank].Used); bank++)
+				;
+			if (bank == CAN_FilterSize)
+				break; //should not happen
+			CAN_FilterDisable(bank);
+		}
+		CAN_FilterSetMask(bank, (CAN_IR ) { .ToUint32 = rules[r].Reg }, (CAN_IR ) { .ToUint32 = rules[r].Mask }, 0);
+		filter_banks[bank].Rule = rules[r];
+		filter_banks[bank].Used = 1;
+		keep[bank] = 1;
+	}
+	//remove outdated rules
+	for (int b = 0; b < CAN_FilterSize; b++)
+		if (filter_banks[b].Used && keep[b] == 0) {
+			CAN_FilterDisable(b);
+			filter_banks[b].Used = 0;
+		}
 }
 
+#ifdef LEVCAN_SOFTWARE_FILTER
+/// Rebuilds receive pre-filter from own nodes dictionary and active transfers.
+/// Called on every address change, call it manually after dictionary modification
+void LC_SoftFilterUpdate(void) {
+	uint32_t data[LC_SYS_AddressClaimed / 32] = { 0 };
+	uint32_t request[LC_SYS_AddressClaimed / 32] = { 0 };
+	uint32_t target[4] = { 0 };
+
+	target[LC_Broadcast_Address / 32] |= 1UL << (LC_Broadcast_Address % 32);
+	for (int i = 0; i < LEVCAN_MAX_OWN_NODES; i++) {
+		if (own_nodes[i].State == LCNodeState_Disabled)
+			continue;
+		if (own_nodes[i].ShortName.NodeID < LC_Null_Address)
+			target[own_nodes[i].ShortName.NodeID / 32] |= 1UL << (own_nodes[i].ShortName.NodeID % 32);
+		for (int obj = 0; obj < own_nodes[i].ObjectsSize; obj++) {
+			const LC_Object_t* object = &own_nodes[i].Objects[obj];
+			if (object->Index >= LC_SYS_AddressClaimed)
+				continue;
+			LC_ObjectAttributes_t attr = object->Attributes;
+			if (attr.Record && object->Address) {
+				//any record may be picked by size
+				attr.Attributes = 0;
+				for (int r = 0; r < object->Size; r++)
+					attr.Attributes |= ((LC_ObjectRecord_t*) object->Address)[r].Attributes.Attributes;
+			}
+			//data written to us, requests read from us
+			if (attr.Writable)
+				data[object->Index / 32] |= 1UL << (object->Index % 32);
+			if (attr.Readable)
+				request[object->Index / 32] |= 1UL << (object->Index % 32);
+		}
+	}
+	for (int i = 0; i < filter_subscriptions_size; i++) {
+		uint16_t index = filter_subscriptions[i];
+		if (index < LC_SYS_AddressClaimed) {
+			data[index / 32] |= 1UL << (index % 32);
+			request[index / 32] |= 1UL << (index % 32);
+		}
+	}
+
+	lc_disable_irq();
+	//transfers in progress
+	for (objBuffered* obj = (objBuffered*) objTXbuf_start; obj; obj = (objBuffered*) obj->Next)
+		if (obj->Header.MsgID < LC_SYS_AddressClaimed)
+			request[obj->Header.MsgID / 32] |= 1UL << (obj->Header.MsgID % 32);
+	for (objBuffered* obj = (objBuffered*) objRXbuf_start; obj; obj = (objBuffered*) obj->Next)
+		if (obj->Header.MsgID < LC_SYS_AddressClaimed)
+			data[obj->Header.MsgID / 32] |= 1UL << (obj->Header.MsgID % 32);
+	for (int i = 0; i < LC_SYS_AddressClaimed / 32; i++) {
+		soft_filter_data[i] = data[i];
+		soft_filter_request[i] = request[i];
+	}
+	for (int i = 0; i < 4; i++)
+		soft_filter_target[i] = target[i];
+	lc_enable_irq();
+}
+#endif
+
 int16_t compareNode(LC_NodeShortName_t a, LC_NodeShortName_t b) {
 	int16_t i = 0;
 	for (; (i < 2) && (a.ToUint32[i] == b.ToUint32[i]); i++)
@@ -559,11 +820,22 @@ void LC_ReceiveHandler(void) {
 	static uint16_t length;
 	//fast receive to clear input buffer, handle later in manager
 	while (CAN_Receive(&header.ToUint32, data, &length) == CANH_Ok) {
+#ifdef LEVCAN_BUSLOAD
+		LC_BusLoadFrame(header.ToUint32, length);
+#endif
+#ifdef LEVCAN_SOFTWARE_FILTER
+		//drop frames nobody waits for before they take fifo slot
+		uint16_t msgid = header.MsgID;
+		if ((soft_filter_target[header.Target / 32] & (1UL << (header.Target % 32))) == 0
+				|| (msgid < LC_SYS_AddressClaimed
+						&& ((header.Request ? soft_filter_request : soft_filter_data)[msgid / 32] & (1UL << (msgid % 32))) == 0)) {
+			rx_stats.Filtered++;
+			continue;
+		}
+#endif
 		//buffer not full?
 		if (rxFIFO_in == ((rxFIFO_out - 1 + LEVCAN_RX_SIZE) % LEVCAN_RX_SIZE)) {
-#ifdef DEBUG
-			lc_receive_ovfl_cntr++;
-#endif
+			rx_stats.IsrFull++;
 			continue;
 		}
 		//store in rx buffer
@@ -573,10 +845,103 @@ void LC_ReceiveHandler(void) {
 		msgRX->length = length;
 		msgRX->header = header;
 		rxFIFO_in = (rxFIFO_in + 1) % LEVCAN_RX_SIZE;
+		uint16_t fill = (rxFIFO_in - rxFIFO_out + LEVCAN_RX_SIZE) % LEVCAN_RX_SIZE;
+		if (fill > rx_stats.IsrHighWater)
+			rx_stats.IsrHighWater = fill;
+	}
+}
+
+#ifdef LEVCAN_RX_DEFERRED_SIZE
+/// Moves received messages from small interrupt buffer to deferred buffer.
+/// Call it from low-priority interrupt or fast task, LC_NetworkManager calls it too
+void LC_ReceiveDrain(void) {
+	while (1) {
+		lc_disable_irq();
+		if (rxFIFO_in == rxFIFO_out) {
+			lc_enable_irq();
+			break;
+		}
+		if (rxDeferred_in == ((rxDeferred_out - 1 + LEVCAN_RX_DEFERRED_SIZE) % LEVCAN_RX_DEFERRED_SIZE)) {
+			//no place, message lost
+			rx_stats.DeferredFull++;
+		} else {
+			rxDeferred[rxDeferred_in] = rxFIFO[rxFIFO_out];
+			rxDeferred_in = (rxDeferred_in + 1) % LEVCAN_RX_DEFERRED_SIZE;
+			uint16_t fill = (rxDeferred_in - rxDeferred_out + LEVCAN_RX_DEFERRED_SIZE) % LEVCAN_RX_DEFERRED_SIZE;
+			if (fill > rx_stats.DeferredHighWater)
+				rx_stats.DeferredHighWater = fill;
+		}
+		rxFIFO_out = (rxFIFO_out + 1) % LEVCAN_RX_SIZE;
+		lc_enable_irq();
+	}
+}
+#endif
+
+/// Returns receive buffers statistics, counters are never reset
+LC_RxStats_t LC_GetRxStats(void) {
+	lc_disable_irq();
+	LC_RxStats_t stats = rx_stats;
+	lc_enable_irq();
+	return stats;
+}
+
+uint8_t receivePop(msgBuffered* msg) {
+#ifdef LEVCAN_RX_DEFERRED_SIZE
+	LC_ReceiveDrain();
+	if (rxDeferred_in == rxDeferred_out)
+		return 0;
+	*msg = rxDeferred[rxDeferred_out];
+	rxDeferred_out = (rxDeferred_out + 1) % LEVCAN_RX_DEFERRED_SIZE;
+#else
+	if (rxFIFO_in == rxFIFO_out)
+		return 0;
+	*msg = rxFIFO[rxFIFO_out];
+	rxFIFO_out = (rxFIFO_out + 1) % LEVCAN_RX_SIZE;
+#endif
+	countFrame(msg->header, LC_RX);
+	countPeer(msg->header.Source, msg->length, LC_RX);
+	return 1;
+}
+
+/// Frames per priority, cheap enough for transmit interrupt
+void countFrame(headerPacked_t hdr, uint16_t mode) {
+	//header priority is inverted
+	uint8_t priority = (~hdr.Priority) & 0x3;
+	if (mode == LC_RX)
+		lc_metrics.RxFrames[priority]++;
+	else
+		lc_metrics.TxFrames[priority]++;
+}
+
+/// Bytes per node table entry, searches table so only for manager context
+void countPeer(uint16_t nodeID, uint16_t length, uint16_t mode) {
+	int16_t peer = LC_GetNodeIndex(nodeID);
+	if (peer < 0)
+		return;
+	if (mode == LC_RX)
+		node_table[peer].RxBytes += length;
+	else
+		node_table[peer].TxBytes += length;
+}
+
+/// Returns protocol counters in one structure, counters are never reset
+/// @param metrics Output
+void LC_GetMetrics(LC_Metrics_t* metrics) {
+	lc_disable_irq();
+	*metrics = lc_metrics;
+	metrics->Rx = rx_stats;
+	lc_enable_irq();
+	for (int i = 0; i < LEVCAN_MAX_TABLE_NODES; i++) {
+		metrics->Peers[i].NodeID = node_table[i].ShortName.NodeID;
+		metrics->Peers[i].RxBytes = node_table[i].RxBytes;
+		metrics->Peers[i].TxBytes = node_table[i].TxBytes;
 	}
 }
 
 void LC_NetworkManager(uint32_t time) {
+#ifdef LEVCAN_TRACE_RING
+	lc_trace_ticks += time;
+#endif
 
 	for (int i = 0; i < LEVCAN_MAX_OWN_NODES; i++) {
 		if (own_nodes[i].State == LCNodeState_Disabled)
@@ -585,70 +950,109 @@ void LC_NetworkManager(uint32_t time) {
 		if (own_nodes[i].State == LCNodeState_NetworkDiscovery) {
 			//check network discovery timeout
 			own_nodes[i].LastTXtime += time;
+#ifdef LEVCAN_CLAIM_SPREAD
+			//claims of power-up batch are spread in slots, later ones see earlier claims
+			if (own_nodes[i].LastTXtime > 100u + own_nodes[i].ClaimBackoff) {
+#else
 			if (own_nodes[i].LastTXtime > 100) {
+#endif
 				//we ready to begin address claim
-				//todo move to claimFreeID
-				uint16_t freeid = own_nodes[i].LastID;
-				while (searchIndexCollision(freeid, &own_nodes[i])) {
-					freeid++;
-					if (freeid > LC_NodeFreeIDmax || freeid < LC_NodeFreeIDmin)
-						freeid = LC_NodeFreeIDmin;
-				}
+				uint16_t freeid = findFreeID(&own_nodes[i], own_nodes[i].LastID);
 				own_nodes[i].State = LCNodeState_WaitingClaim;
 				own_nodes[i].LastTXtime = 0;
 				own_nodes[i].ShortName.NodeID = freeid;
-				CAN_FilterEditOn();
-				addAddressFilter(freeid);
-				CAN_FilterEditOff();
-				LC_AddressClaimHandler(own_nodes[i].ShortName, LC_TX);
-#ifdef LEVCAN_TRACE
-				trace_printf("Discovery finish id:%d\n", own_nodes[i].ShortName.NodeID);
-#endif
+				configureFilters();
+				//no free id - null address, try again later
+				if (freeid != LC_Null_Address)
+					LC_AddressClaimHandler(own_nodes[i].ShortName, LC_TX);
+				LC_TRACE(LC_TE_DiscoveryFinish, own_nodes[i].ShortName.NodeID, 0, 0);
 			}
 		} else if (own_nodes[i].ShortName.NodeID == LC_Null_Address) {
 			//we've lost id, get new one
+#ifdef LEVCAN_CLAIM_SPREAD
+			//wait random slot, claims of other losers get into claimed map meanwhile
+			own_nodes[i].LastTXtime += time;
+			if (own_nodes[i].LastTXtime >= own_nodes[i].ClaimBackoff) {
+				own_nodes[i].LastTXtime = 0;
+				claimFreeID(&own_nodes[i]);
+			}
+#else
 			//look for free id
 			own_nodes[i].LastTXtime = 0;
 			claimFreeID(&own_nodes[i]);
+#endif
 		} else if (own_nodes[i].ShortName.NodeID < LC_Broadcast_Address) {
 
 			if (own_nodes[i].State == LCNodeState_WaitingClaim) {
 				own_nodes[i].LastTXtime += time;
-				if (own_nodes[i].LastTXtime > 250) {
+				uint32_t claim_time = 250;
+#ifdef LEVCAN_WARM_START
+				//restored id was verified by single claim
+				if (own_nodes[i].WarmStart)
+					claim_time = LEVCAN_WARM_START_CLAIM_TIME;
+#endif
+				if (own_nodes[i].LastTXtime > claim_time) {
 					own_nodes[i].State = LCNodeState_Online;
-					configureFilters();    //todo make it faster?
+					configureFilters();
 					own_nodes[i].LastTXtime = 0;
-#ifdef LEVCAN_TRACE
-					trace_printf("We are online ID:%d\n", own_nodes[i].ShortName.NodeID);
+					LC_TRACE(LC_TE_Online, own_nodes[i].ShortName.NodeID, 0, 0);
+#ifdef LEVCAN_WARM_START
+					own_nodes[i].WarmStart = 0;
+					LC_WarmStartSave(&own_nodes[i]);
+#endif
+#ifdef LEVCAN_CLAIM_SPREAD
+					own_nodes[i].ClaimAttempts = 0;
+#endif
+#ifdef LEVCAN_HEARTBEAT
+					//first heartbeat right away, others learn our period
+					own_nodes[i].HeartbeatTime = own_nodes[i].HeartbeatPeriod;
 #endif
 				}
 			} else if (own_nodes[i].State == LCNodeState_Online) {
+#ifdef LEVCAN_HEARTBEAT
+				//heartbeat replaces periodic address claim
+				own_nodes[i].HeartbeatTime += time;
+				if (own_nodes[i].HeartbeatTime >= own_nodes[i].HeartbeatPeriod) {
+					own_nodes[i].HeartbeatTime = 0;
+					heartbeatSend(&own_nodes[i], 0, 0);
+				}
+#else
 				static int alone = 0;
 				//we are online! why nobody asking for it?
 				own_nodes[i].LastTXtime += time;
 				if (own_nodes[i].LastTXtime > 2500) {
 					own_nodes[i].LastTXtime = 0;
 					LC_AddressClaimHandler(own_nodes[i].ShortName, LC_TX);
-#ifdef LEVCAN_TRACE
 					if (alone == 0) {
-						trace_printf("Are we alone?:%d\n", own_nodes[i].ShortName.NodeID);
+						LC_TRACE(LC_TE_Alone, own_nodes[i].ShortName.NodeID, 0, 0);
 					}
 					alone = 3000;
-#endif
 				} else if (alone)
 					alone -= time;
+#endif
 			}
 		}
 	}
+#ifdef LEVCAN_WARM_START
+	//node table changed, save not often than storage allows
+	warm_save_timer += time;
+	if (warm_table_changed && warm_save_timer >= LEVCAN_WARM_START_SAVE_PERIOD) {
+		warm_table_changed = 0;
+		warm_save_timer = 0;
+		for (int i = 0; i < LEVCAN_MAX_OWN_NODES; i++)
+			LC_WarmStartSave(&own_nodes[i]);
+	}
+#endif
 
-	while (rxFIFO_in != rxFIFO_out) {
+	msgBuffered msg;
+	while (receivePop(&msg)) {
 		//proceed RX FIFO
-		headerPacked_t hdr = rxFIFO[rxFIFO_out].header;
+		headerPacked_t hdr = msg.header;
 		if (hdr.Request) {
 			if (hdr.RTS_CTS == 0 && hdr.EoM == 0) {
 				//Remote transfer request, try to create new TX object
 				LC_NodeDescription_t* node = findNode(hdr.Target);
-				LC_ObjectRecord_t obj = findObjectRecord(hdr.MsgID, rxFIFO[rxFIFO_out].length, node, Read, hdr.Source);
+				LC_ObjectRecord_t obj = findObjectRecord(hdr.MsgID, msg.length, node, Read, hdr.Source);
 				obj.NodeID = hdr.Source;    //receiver
 				if (obj.Attributes.Function && obj.Address) {
 					//function call before sending
@@ -664,9 +1068,7 @@ void LC_NetworkManager(uint32_t time) {
 						obj.Attributes.TCP |= hdr.Parity;    //force TCP mode if requested
 						LC_SendMessage((intptr_t*) node, &obj, hdr.MsgID);
 					} else {
-#ifdef LEVCAN_TRACE
-						//trace_printf("RX dual request denied:%d, from node:%d \n", hdr.MsgID, hdr.Source);
-#endif
+						LC_TRACE_FAST(LC_TE_RxDualDenied, hdr.MsgID, hdr.Source, 0);
 					}
 				}
 			} else {
@@ -679,17 +1081,12 @@ void LC_NetworkManager(uint32_t time) {
 			//we got data
 			if (hdr.RTS_CTS) {
 				//address valid?
-				if (hdr.Source >= LC_Null_Address) {
-					//get next buffer index
-					rxFIFO_out = (rxFIFO_out + 1) % LEVCAN_RX_SIZE;
+				if (hdr.Source >= LC_Null_Address)
 					continue;
-				}
 				if (hdr.EoM && hdr.Parity == 0) {
 					//fast receive for udp
-					if (objectRXfinish(hdr, (char*) &rxFIFO[rxFIFO_out].data, rxFIFO[rxFIFO_out].length, 0)) {
-#ifdef LEVCAN_TRACE
-						trace_printf("RX fast failed:%d \n", hdr.MsgID);
-#endif
+					if (objectRXfinish(hdr, (char*) &msg.data, msg.length, 0)) {
+						LC_TRACE(LC_TE_RxFastFailed, hdr.MsgID, hdr.Source, 0);
 					}
 				} else {
 					//find existing RX object, delete in case we get new RequestToSend
@@ -697,6 +1094,7 @@ void LC_NetworkManager(uint32_t time) {
 					if (RXobj) {
 						lcfree(RXobj->Pointer);
 						deleteObject(RXobj, (void*) &objRXbuf_start, (void*) &objRXbuf_end);
+						lc_metrics.TransfersAborted++;
 					}
 					//create new receive object
 #ifndef LEVCAN_MEM_STATIC
@@ -705,8 +1103,8 @@ void LC_NetworkManager(uint32_t time) {
 					objBuffered* newRXobj = getFreeObject();
 #endif
 					if (newRXobj == 0) {
-						//get next buffer index
-						rxFIFO_out = (rxFIFO_out + 1) % LEVCAN_RX_SIZE;
+						rx_stats.NoMemory++;
+						lc_metrics.AllocFails++;
 						continue;
 					}
 					//data alloc
@@ -714,10 +1112,12 @@ void LC_NetworkManager(uint32_t time) {
 					newRXobj->Pointer = lcmalloc(LEVCAN_OBJECT_DATASIZE);
 					if (newRXobj->Pointer == 0) {
 						lcfree(newRXobj);
-						rxFIFO_out = (rxFIFO_out + 1) % LEVCAN_RX_SIZE;
+						rx_stats.NoMemory++;
+						lc_metrics.AllocFails++;
 						continue;
 					}
 #endif
+					lc_metrics.TransfersCreated++;
 					newRXobj->Length = LEVCAN_OBJECT_DATASIZE;
 					newRXobj->Header = hdr;
 					newRXobj->Flags.TCP = hdr.Parity;    //setup rx mode
@@ -737,18 +1137,18 @@ void LC_NetworkManager(uint32_t time) {
 						objRXbuf_end->Next = (intptr_t*) newRXobj;
 						objRXbuf_end = newRXobj;
 					}
-					//	trace_printf("New RX object created:%d\n", newRXobj->Header.MsgID);
-					objectRXproceed(newRXobj, &rxFIFO[rxFIFO_out]);
+					LC_TRACE_FAST(LC_TE_RxCreated, hdr.MsgID, hdr.Source, 0);
+					objectRXproceed(newRXobj, &msg);
 				}
 			} else {
 				//find existing RX object
 				objBuffered* RXobj = findObject((void*) objRXbuf_start, hdr.MsgID, hdr.Target, hdr.Source);
 				if (RXobj)
-					objectRXproceed(RXobj, &rxFIFO[rxFIFO_out]);
+					objectRXproceed(RXobj, &msg);
+				else
+					rx_stats.NoObject++;
 			}
 		}
-		//get next buffer index
-		rxFIFO_out = (rxFIFO_out + 1) % LEVCAN_RX_SIZE;
 	}
 //count work time and clean up
 	objBuffered* txProceed = (objBuffered*) objTXbuf_start;
@@ -763,19 +1163,21 @@ void LC_NetworkManager(uint32_t time) {
 			if (txProceed->Time_since_comm > 100) {
 				if (txProceed->Attempt >= 3) {
 					//TX timeout, make it free!
-#ifdef LEVCAN_TRACE
-					trace_printf("TX object deleted by attempt:%d\n", txProceed->Header.MsgID);
-#endif
+					LC_TRACE(LC_TE_TxTimeout, txProceed->Header.MsgID, txProceed->Header.Target, 0);
 					if (txProceed->Flags.TXcleanup) {
 						lcfree(txProceed->Pointer);
 					}
 					deleteObject(txProceed, (objBuffered**) &objTXbuf_start, (objBuffered**) &objTXbuf_end);
+					lc_metrics.TxTimeouts++;
+					lc_metrics.TransfersAborted++;
 				} else {
 					// Try tx again
 					objectTXproceed(txProceed, 0);
 					//TOdo may cause buffer overflow if CAN is offline
-					if (txProceed->Time_since_comm == 0)
+					if (txProceed->Time_since_comm == 0) {
 						txProceed->Attempt++;
+						lc_metrics.Retransmits++;
+					}
 				}
 			}
 		}
@@ -788,11 +1190,11 @@ void LC_NetworkManager(uint32_t time) {
 		rxProceed->Time_since_comm += time;
 		if (rxProceed->Time_since_comm > 500) {
 			//UDP mode rx timeout
-#ifdef LEVCAN_TRACE
-			trace_printf("RX object deleted by timeout:%d\n", rxProceed->Header.MsgID);
-#endif
+			LC_TRACE(LC_TE_RxTimeout, rxProceed->Header.MsgID, rxProceed->Header.Source, 0);
 			lcfree(rxProceed->Pointer);
 			deleteObject(rxProceed, (objBuffered**) &objRXbuf_start, (objBuffered**) &objRXbuf_end);
+			lc_metrics.RxTimeouts++;
+			lc_metrics.TransfersAborted++;
 		}
 		rxProceed = next;
 	}
@@ -805,25 +1207,56 @@ void LC_NetworkManager(uint32_t time) {
 	const uint16_t off_period = 250;    //0.25s
 	offline_tick += time;
 	if (offline_tick > off_period) {
+#ifdef LEVCAN_HEARTBEAT
+		uint32_t rollcall[4] = { 0 };
+#endif
 		for (int i = 0; i < LEVCAN_MAX_TABLE_NODES; i++) {
 			//send every node id
 			if (node_table[i].ShortName.NodeID < LC_Null_Address) {
 				node_table[i].LastRXtime += offline_tick;
+#ifdef LEVCAN_HEARTBEAT
+				uint16_t id = node_table[i].ShortName.NodeID;
+				uint32_t period = node_table[i].HeartbeatPeriod;
+				if (period) {
+					//silence is counted in off_period steps
+					if (node_table[i].LastRXtime > period * LEVCAN_HEARTBEAT_MISSES + off_period) {
+						//timeout, delete node
+						LC_TRACE(LC_TE_NodeTimeout, id, 0, 0);
+						node_table[i].ShortName.NodeID = LC_Broadcast_Address;
+#ifdef LEVCAN_WARM_START
+						warm_table_changed = 1;
+#endif
+					} else if (node_table[i].LastRXtime > period + period / 2 + off_period && (heartbeat_rollcall[id / 32] & (1UL << (id % 32))) == 0) {
+						//heartbeat late, ask in roll call with others
+						rollcall[id / 32] |= 1UL << (id % 32);
+					}
+					continue;
+				}
+#endif
 				if (node_table[i].LastRXtime > 1500) {
 					//timeout, delete node
-#ifdef LEVCAN_TRACE
-					trace_printf("Node lost, timeout:%d\n", node_table[i].ShortName.NodeID);
-#endif
+					LC_TRACE(LC_TE_NodeTimeout, node_table[i].ShortName.NodeID, 0, 0);
 					node_table[i].ShortName.NodeID = LC_Broadcast_Address;
+#ifdef LEVCAN_WARM_START
+					warm_table_changed = 1;
+#endif
 				} else if (node_table[i].LastRXtime > 1000) {
 					//ask node, is it online?
 					LC_SendDiscoveryRequest(node_table[i].ShortName.NodeID);
 				}
 			}
 		}
+#ifdef LEVCAN_HEARTBEAT
+		heartbeatRollCall(rollcall);
+		memset(heartbeat_rollcall, 0, sizeof(heartbeat_rollcall));
+#endif
 		offline_tick = offline_tick % off_period;
 	}
 #endif
+#ifdef LEVCAN_PARAMETERS
+	//parameter retries and delayed answers
+	lc_paramManager(time);
+#endif
 }
 
 void deleteObject(objBuffered* obj, objBuffered** start, objBuffered** end) {
@@ -831,11 +1264,9 @@ void deleteObject(objBuffered* obj, objBuffered** start, objBuffered** end) {
 	if (obj->Previous)
 		((objBuffered*) obj->Previous)->Next = obj->Next;    //junction
 	else {
-#ifdef LEVCAN_TRACE
 		if ((*start) != obj) {
-			trace_printf("Start object error\n");
+			LC_TRACE(LC_TE_ObjectListError, 0, obj->Header.MsgID, 0);
 		}
-#endif
 		(*start) = (objBuffered*) obj->Next;    //Starting
 		if ((*start) != 0)
 			(*start)->Previous = 0;
@@ -843,11 +1274,9 @@ void deleteObject(objBuffered* obj, objBuffered** start, objBuffered** end) {
 	if (obj->Next) {
 		((objBuffered*) obj->Next)->Previous = obj->Previous;
 	} else {
-#ifdef LEVCAN_TRACE
 		if ((*end) != obj) {
-			trace_printf("End object error\n");
+			LC_TRACE(LC_TE_ObjectListError, 1, obj->Header.MsgID, 0);
 		}
-#endif
 		(*end) = (objBuffered*) obj->Previous;    //ending
 		if ((*end) != 0)
 			(*end)->Next = 0;
@@ -895,9 +1324,7 @@ void releaseObject(objBuffered* obj) {
 		if (index < objectBuffer_freeID)
 		objectBuffer_freeID = index;
 	} else {
-#ifdef LEVCAN_TRACE
-		trace_printf("Delete object error\n");
-#endif
+		LC_TRACE(LC_TE_ObjectListError, 2, 0, 0);
 	}
 	lc_enable_irq();
 }
@@ -928,34 +1355,273 @@ LC_Header_t headerUnpack(headerPacked_t header) {
 }
 
 void claimFreeID(LC_NodeDescription_t* node) {
-	uint16_t freeid = LC_NodeFreeIDmin;
-	if (freeid < node->LastID) {
-		//this one will increment freeid
-		freeid = node->LastID;
-	}
-	if (freeid > LC_NodeFreeIDmax)
-		freeid = LC_NodeFreeIDmin;
-//todo fix endless loop
-	while (searchIndexCollision(freeid, node)) {
-		freeid++;
-		if (freeid > LC_NodeFreeIDmax)
-			freeid = LC_NodeFreeIDmin;
+	//last id is lost, its holder may be missing in full node table. do not claim it again
+	uint16_t freeid = findFreeID(node, nextFreeID(node, node->LastID));
+	if (freeid == LC_Null_Address) {
+		//all ids taken, stay with null address
+#ifdef LEVCAN_CLAIM_SPREAD
+		claimBackoff(node);
+#endif
+		return;
 	}
 	node->LastID = freeid;
 	node->ShortName.NodeID = freeid;
-#ifdef LEVCAN_TRACE
-	trace_printf("Trying claim ID:%d\n", freeid);
-#endif
+	LC_TRACE(LC_TE_IdClaim, freeid, 0, 0);
 	LC_AddressClaimHandler(node->ShortName, LC_TX);
 	node->LastTXtime = 0;
 	node->State = LCNodeState_WaitingClaim;
 //add new own address filter TODO add later after verification
-	CAN_FilterEditOn();
-	addAddressFilter(freeid);
-	CAN_FilterEditOff();
+	configureFilters();
+
+}
+
+#ifdef LEVCAN_WARM_START
+/// Saves claimed id and node table using lc_warmStartSave. Called automatically when node
+/// goes online and after node table changes
+/// @param mynode Your node, 0 - first own node
+void LC_WarmStartSave(void* mynode) {
+	static LC_WarmStart_t state;
+	LC_NodeDescription_t* node = mynode;
+	if (node == 0)
+		node = &own_nodes[0];
+	if (node->State != LCNodeState_Online)
+		return;
+	memset(&state, 0, sizeof(state));
+	state.Magic = LC_WARM_START_MAGIC;
+	state.Serial = node->Serial;
+	state.NodeID = node->ShortName.NodeID;
+	for (int i = 0; i < LEVCAN_MAX_TABLE_NODES && state.NodesCount < LEVCAN_WARM_START_NODES; i++)
+		if (node_table[i].ShortName.NodeID < LC_Null_Address)
+			state.Nodes[state.NodesCount++] = node_table[i].ShortName;
+	state.Checksum = warmStartChecksum(&state);
+	warm_save_timer = 0;
+	lc_warmStartSave(&state);
+}
 
+uint8_t warmStartRestore(LC_NodeDescription_t* node) {
+	static LC_WarmStart_t state;
+	memset(&state, 0, sizeof(state));
+	if (lc_warmStartLoad(node->Serial, &state) != LC_Ok)
+		return 0;
+	if (state.Magic != LC_WARM_START_MAGIC || state.Serial != node->Serial || state.Checksum != warmStartChecksum(&state)
+			|| state.NodeID >= LC_Null_Address || state.NodesCount > LEVCAN_WARM_START_NODES)
+		return 0;
+	//known nodes available right after online
+	uint16_t table = 0;
+	for (int i = 0; i < state.NodesCount && table < LEVCAN_MAX_TABLE_NODES; i++) {
+		if (state.Nodes[i].NodeID >= LC_Null_Address || state.Nodes[i].NodeID == state.NodeID || LC_GetNodeIndex(state.Nodes[i].NodeID) >= 0)
+			continue;
+		while (table < LEVCAN_MAX_TABLE_NODES && node_table[table].ShortName.NodeID < LC_Null_Address)
+			table++;
+		if (table == LEVCAN_MAX_TABLE_NODES)
+			break;
+		node_table[table].ShortName = state.Nodes[i];
+		node_table[table].LastRXtime = 0;
+		node_table[table].RxBytes = 0;
+		node_table[table].TxBytes = 0;
+#ifdef LEVCAN_HEARTBEAT
+		node_table[table].HeartbeatPeriod = 0;
+#endif
+	}
+	node->LastID = state.NodeID;
+	node->ShortName.NodeID = state.NodeID;
+	node->State = LCNodeState_WaitingClaim;
+	node->LastTXtime = 0;
+	node->WarmStart = 1;
+	configureFilters();
+	//single verification claim, owner of this id will answer with own claim
+	LC_AddressClaimHandler(node->ShortName, LC_TX);
+	//live nodes refresh restored table
+	LC_SendDiscoveryRequest(LC_Broadcast_Address);
+	LC_TRACE(LC_TE_IdClaim, state.NodeID, 0, 0);
+	return 1;
 }
 
+void warmStartFail(LC_NodeDescription_t* node) {
+	//restored data is wrong, start over like cold boot
+	node->WarmStart = 0;
+	for (int i = 0; i < LEVCAN_MAX_TABLE_NODES; i++)
+		node_table[i].ShortName.NodeID = LC_Broadcast_Address;
+	node->ShortName.NodeID = node->LastID;
+	node->State = LCNodeState_NetworkDiscovery;
+	node->LastTXtime = 0;
+	LC_SendDiscoveryRequest(LC_Broadcast_Address);
+}
+
+uint32_t warmStartChecksum(const LC_WarmStart_t* state) {
+	const uint8_t* data = (const uint8_t*) state;
+	uint32_t sum = 0;
+	for (size_t i = 0; i < offsetof(LC_WarmStart_t, Checksum); i++)
+		sum = sum * 31 + data[i];
+	return sum;
+}
+#endif
+
+/// Looks for id not used by other nodes, starting from given one
+/// @return Free id or LC_Null_Address if there is none
+uint16_t findFreeID(LC_NodeDescription_t* node, uint16_t freeid) {
+	//preferred id out of free range is checked too
+	for (uint16_t tries = 0; tries <= LC_NodeFreeIDmax - LC_NodeFreeIDmin + 1; tries++) {
+#ifdef LEVCAN_CLAIM_SPREAD
+		if (searchIndexCollision(freeid, node) == 0 && claimSeen(freeid, 0) == 0)
+#else
+		if (searchIndexCollision(freeid, node) == 0)
+#endif
+			return freeid;
+		freeid = nextFreeID(node, freeid);
+	}
+#ifdef LEVCAN_CLAIM_SPREAD
+	//map is full, some holders may be gone. begin new round
+	claim_seen[0] = claim_seen[1] = 0;
+#endif
+	return LC_Null_Address;
+}
+
+/// Next id to probe after given one, always in free range
+uint16_t nextFreeID(LC_NodeDescription_t* node, uint16_t freeid) {
+#ifdef LEVCAN_CLAIM_SPREAD
+	const uint16_t range = LC_NodeFreeIDmax - LC_NodeFreeIDmin + 1;
+	if (freeid < LC_NodeFreeIDmin || freeid > LC_NodeFreeIDmax)
+		return LC_NodeFreeIDmin + claimHash(node->Serial) % range;
+	//own probe step for every node, losers of same id go different ways
+	//step coprime to range visits every id
+	uint16_t step = 1 + (claimHash(node->Serial) >> 8) % (range - 1);
+	while (claimGcd(step, range) != 1)
+		step++;
+	return LC_NodeFreeIDmin + (freeid - LC_NodeFreeIDmin + step) % range;
+#else
+	freeid++;
+	if (freeid > LC_NodeFreeIDmax || freeid < LC_NodeFreeIDmin)
+		freeid = LC_NodeFreeIDmin;
+	return freeid;
+#endif
+}
+
+#ifdef LEVCAN_CLAIM_SPREAD
+void claimBackoff(LC_NodeDescription_t* node) {
+	//slotted window doubles with every lost claim, limited
+	if (node->ClaimAttempts < 255)
+		node->ClaimAttempts++;
+	uint8_t shift = node->ClaimAttempts - 1;
+	if (shift > LEVCAN_CLAIM_MAX_SHIFT)
+		shift = LEVCAN_CLAIM_MAX_SHIFT;
+	node->ClaimBackoff = (claimRandom() % (LEVCAN_CLAIM_SLOTS << shift)) * LEVCAN_CLAIM_SLOT;
+	node->LastTXtime = 0;
+}
+
+/// Marks or checks id in map of claimed free range ids
+uint8_t claimSeen(uint16_t nodeID, uint8_t set) {
+	if (nodeID < LC_NodeFreeIDmin || nodeID > LC_NodeFreeIDmax)
+		return 0;
+	uint32_t bit = 1UL << ((nodeID - LC_NodeFreeIDmin) % 32);
+	if (set)
+		claim_seen[(nodeID - LC_NodeFreeIDmin) / 32] |= bit;
+	return (claim_seen[(nodeID - LC_NodeFreeIDmin) / 32] & bit) != 0;
+}
+
+uint32_t claimHash(uint32_t value) {
+	value ^= value >> 16;
+	value *= 0x7FEB352D;
+	value ^= value >> 15;
+	value *= 0x846CA68B;
+	value ^= value >> 16;
+	return value;
+}
+
+uint32_t claimRandom(void) {
+	//xorshift32, seeded by own serials
+	claim_seed ^= claim_seed << 13;
+	claim_seed ^= claim_seed >> 17;
+	claim_seed ^= claim_seed << 5;
+	return claim_seed;
+}
+
+uint16_t claimGcd(uint16_t a, uint16_t b) {
+	while (b) {
+		uint16_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+#endif
+
+#ifdef LEVCAN_HEARTBEAT
+void proceedHeartbeat(LC_NodeDescription_t* node, LC_Header_t header, void* data, int32_t size) {
+	if (data == 0 || size < (int32_t) sizeof(LC_Heartbeat_t))
+		return;
+	LC_Heartbeat_t hb;
+	memcpy(&hb, data, sizeof(hb));
+	//sender is alive
+	int empty = -1;
+	for (int i = 0; i < LEVCAN_MAX_TABLE_NODES; i++) {
+		if (node_table[i].ShortName.NodeID == header.Source) {
+			node_table[i].LastRXtime = 0;
+			node_table[i].HeartbeatPeriod = hb.Period;
+			empty = -2;
+			break;
+		}
+		if (node_table[i].ShortName.NodeID >= LC_Null_Address && empty == -1)
+			empty = i;
+	}
+	//unknown node (missed claim or timed out by mistake), ask for short name if there is place
+	if (empty >= 0 && header.Source < LC_Null_Address)
+		LC_SendDiscoveryRequest(header.Source);
+	//roll call
+	for (int bit = 0; bit < LC_HEARTBEAT_ROLLCALL; bit++) {
+		if ((hb.RollCall[bit / 8] & (1 << (bit % 8))) == 0)
+			continue;
+		uint16_t id = hb.RollCallBase + bit;
+		if (id >= LC_Null_Address)
+			break;
+		//do not ask this node again, answer will come
+		heartbeat_rollcall[id / 32] |= 1UL << (id % 32);
+		for (int i = 0; i < LEVCAN_MAX_OWN_NODES; i++)
+			if (own_nodes[i].ShortName.NodeID == id && own_nodes[i].State == LCNodeState_Online)
+				own_nodes[i].HeartbeatTime = own_nodes[i].HeartbeatPeriod;    //answer on next manager call
+	}
+}
+
+void heartbeatSend(LC_NodeDescription_t* node, uint8_t base, const uint8_t* rollcall) {
+	headerPacked_t header = { //
+			.Priority = (~LC_Priority_Control) & 0x3,    //
+			.MsgID = LC_SYS_Heartbeat,    //
+			.Target = LC_Broadcast_Address,    //
+			.Source = node->ShortName.NodeID,    //
+			.Request = 0, .RTS_CTS = 1, .EoM = 1 };
+	LC_Heartbeat_t hb = { .Period = node->HeartbeatPeriod, .RollCallBase = base };
+	if (rollcall)
+		memcpy(hb.RollCall, rollcall, sizeof(hb.RollCall));
+	uint32_t data[2];
+	memcpy(data, &hb, sizeof(data));
+	sendDataToQueue(header, data, sizeof(hb));
+	node->HeartbeatTime = 0;
+}
+
+/// Asks late nodes to answer, one frame for up to LC_HEARTBEAT_ROLLCALL nodes
+void heartbeatRollCall(uint32_t* rollcall) {
+	LC_NodeDescription_t* sender = 0;
+	for (int i = 0; i < LEVCAN_MAX_OWN_NODES; i++)
+		if (own_nodes[i].State == LCNodeState_Online) {
+			sender = &own_nodes[i];
+			break;
+		}
+	if (sender == 0)
+		return;
+	for (uint16_t id = 0; id < LC_Null_Address; id++) {
+		if ((rollcall[id / 32] & (1UL << (id % 32))) == 0)
+			continue;
+		//window from first late node
+		uint8_t bits[LC_HEARTBEAT_ROLLCALL / 8] = { 0 };
+		for (int bit = 0; bit < LC_HEARTBEAT_ROLLCALL && id + bit < LC_Null_Address; bit++)
+			if (rollcall[(id + bit) / 32] & (1UL << ((id + bit) % 32)))
+				bits[bit / 8] |= 1 << (bit % 8);
+		heartbeatSend(sender, id, bits);
+		id += LC_HEARTBEAT_ROLLCALL - 1;
+	}
+}
+#endif
+
 uint16_t searchIndexCollision(uint16_t nodeID, LC_NodeDescription_t* ownNode) {
 	for (int i = 0; i < LEVCAN_MAX_OWN_NODES; i++) {
 		//todo add online check?
@@ -992,7 +1658,12 @@ LC_Return_t sendDataToQueue(headerPacked_t hdr, uint32_t data[], uint8_t length)
 	}
 
 	txFIFO_in = (txFIFO_in + 1) % LEVCAN_TX_SIZE;
+	uint16_t fill = (txFIFO_in - txFIFO_out + LEVCAN_TX_SIZE) % LEVCAN_TX_SIZE;
+	if (fill > lc_metrics.TxHighWater)
+		lc_metrics.TxHighWater = fill;
 	lc_enable_irq();
+	//queued frames are counted per peer here, outside of transmit interrupt
+	countPeer(hdr.Target, length, LC_TX);
 	//proceed queue if we can do, NOT THREAD SAFE
 //	if (empty)
 //		LC_TransmitHandler();
@@ -1006,11 +1677,10 @@ uint16_t objectTXproceed(objBuffered* object, headerPacked_t* request) {
 	if (request) {
 		if (request->EoM) {
 			//TX finished? delete this buffer anyway
-#ifdef LEVCAN_TRACE
-			//trace_printf("TX TCP finished:%d\n", object->Header.MsgID);
 			if (object->Position != object->Length)
-			trace_printf("TX TCP length mismatch:%d, it is:%d, it should:%d\n", object->Header.MsgID, object->Position, object->Length);
-#endif
+				LC_TRACE(LC_TE_TxLengthMismatch, object->Header.MsgID, object->Position, object->Length);
+			else
+				LC_TRACE_FAST(LC_TE_TxFinished, object->Header.MsgID, object->Position, object->Length);
 #ifndef LEVCAN_MEM_STATIC
 			//cleanup tx buffer also
 			if (object->Flags.TXcleanup)
@@ -1033,13 +1703,8 @@ uint16_t objectTXproceed(objBuffered* object, headerPacked_t* request) {
 			if (object->Position < 0)
 				object->Position = 0;    //just in case... WTF
 			parity = ~((object->Position + 7) / 8) & 1;    //parity
-#ifdef LEVCAN_TRACE
-					// trace_printf("TX object parity lost:%d position:%d\n", object->Header.MsgID, object->Position);
-#endif
-		} else {
-#ifdef LEVCAN_TRACE
-			// trace_printf("Request got valid parity\n");
-#endif
+			lc_metrics.ParityRollbacks++;
+			LC_TRACE_FAST(LC_TE_TxParityLost, object->Header.MsgID, object->Position, 0);
 		}
 	}
 	do {
@@ -1114,10 +1779,9 @@ uint16_t objectRXproceed(objBuffered* object, msgBuffered* msg) {
 			//todo check possible pointer loose and close object
 #else
 			//out of stack, inform and delete
-#ifdef LEVCAN_TRACE
-			trace_printf("RX buffer overflow, object deleted:%d\n", object->Header.MsgID);
-#endif
+			LC_TRACE(LC_TE_RxOverflow, object->Header.MsgID, object->Position, 0);
 			deleteObject(object, (objBuffered**) &objRXbuf_start, (objBuffered**) &objRXbuf_end);
+			lc_metrics.TransfersAborted++;
 			return 0;
 #endif
 		}
@@ -1205,9 +1869,7 @@ LC_Return_t objectRXfinish(headerPacked_t header, char* data, int32_t size, uint
 		}
 	} else {
 		ret = LC_ObjectError;
-#ifdef LEVCAN_TRACE
-		trace_printf("RX finish failed %d no object found for size %d\n", header.MsgID, size);
-#endif
+		LC_TRACE(LC_TE_RxFinishFailed, header.MsgID, size, 0);
 	}
 	//cleanup
 	if (memfree)
@@ -1315,9 +1977,7 @@ LC_Return_t LC_SendMessage(void* sender, LC_ObjectRecord_t* object, uint16_t ind
 		//avoid dual same id
 		objBuffered* txProceed = findObject((void*) objTXbuf_start, index, object->NodeID, node->ShortName.NodeID);
 		if (txProceed) {
-#ifdef DEBUG
-			lc_collision_cntr++;
-#endif
+			lc_metrics.TxCollisions++;
 			return LC_Collision;
 		}
 
@@ -1341,8 +2001,11 @@ LC_Return_t LC_SendMessage(void* sender, LC_ObjectRecord_t* object, uint16_t ind
 		return LC_MallocFail;
 		objBuffered* newTXobj = getFreeObject();
 #endif
-		if (newTXobj == 0)
+		if (newTXobj == 0) {
+			lc_metrics.AllocFails++;
 			return LC_MallocFail;
+		}
+		lc_metrics.TransfersCreated++;
 		newTXobj->Attempt = 0;
 		newTXobj->Header = hdr;
 		newTXobj->Length = object->Size;
@@ -1365,10 +2028,13 @@ LC_Return_t LC_SendMessage(void* sender, LC_ObjectRecord_t* object, uint16_t ind
 			objTXbuf_end->Next = (intptr_t*) newTXobj;
 			objTXbuf_end = newTXobj;
 		}
-		lc_enable_irq();
-#ifdef LEVCAN_TRACE
-		//trace_printf("New TX object created:%d\n", newTXobj->Header.MsgID);
+#ifdef LEVCAN_SOFTWARE_FILTER
+		//receiver answers with requests for this index
+		if (index < LC_SYS_AddressClaimed)
+			soft_filter_request[index / 32] |= 1UL << (index % 32);
 #endif
+		lc_enable_irq();
+		LC_TRACE_FAST(LC_TE_TxCreated, newTXobj->Header.MsgID, newTXobj->Header.Target, 0);
 		objectTXproceed(newTXobj, 0);
 	} else {
 		//some short string? + ending
@@ -1444,6 +2110,10 @@ void LC_TransmitHandler(void) {
 			break; /* Queue Empty - nothing to send*/
 		if (CAN_Send(txFIFO[txFIFO_out].header.ToUint32, txFIFO[txFIFO_out].data, txFIFO[txFIFO_out].length) != 0)
 			break; //CAN full
+		countFrame(txFIFO[txFIFO_out].header, LC_TX);
+#ifdef LEVCAN_BUSLOAD
+		LC_BusLoadFrame(txFIFO[txFIFO_out].header.ToUint32, txFIFO[txFIFO_out].length);
+#endif
 		txFIFO_out = (txFIFO_out + 1) % LEVCAN_TX_SIZE;
 	}
 	mutex = 0;
@@ -33,7 +33,7 @@ typedef struct {
 } LC_Object_t;
 
 typedef struct {
-	int16_t Size;
+	int32_t Size;
 	LC_ObjectAttributes_t Attributes;
 	void* Address; //pointer to memory data. if LC_ObjectAttributes_t.Pointer=1, this is pointer to pointer
 	uint8_t NodeID;
@@ -89,6 +89,9 @@ typedef struct {
 	uint16_t ObjectsSize;	//array size (elements)
 	void* Directories; //array of LC_ParameterDirectory_t
 	uint16_t DirectoriesSize; //array size (elements)
+#ifdef LEVCAN_HEARTBEAT
+	uint16_t HeartbeatPeriod; //ms, depends on node class. 0 - LEVCAN_HEARTBEAT_PERIOD
+#endif
 } LC_NodeInit_t;
 
 enum {
@@ -110,6 +113,9 @@ enum {
 	LC_SYS_Shutdown,
 	LC_SYS_FileServer,
 	LC_SYS_FileClient,
+	LC_SYS_BusLoad,
+	LC_SYS_Heartbeat,
+	LC_SYS_ParametersEx,
 	LC_SYS_End,
 };
 
@@ -124,18 +130,120 @@ typedef struct {
 	enum {
 		LCNodeState_Disabled, LCNodeState_NetworkDiscovery, LCNodeState_WaitingClaim, LCNodeState_Online
 	} State;
+#ifdef LEVCAN_WARM_START
+	uint8_t WarmStart; //claiming restored id, collision starts full discovery
+#endif
+#ifdef LEVCAN_CLAIM_SPREAD
+	uint16_t ClaimBackoff; //ms to wait before next claim
+	uint8_t ClaimAttempts; //lost claims in a row
+#endif
+#ifdef LEVCAN_HEARTBEAT
+	uint16_t HeartbeatPeriod; //ms
+	uint16_t HeartbeatTime; //ms since last heartbeat
+#endif
 	LC_Object_t* Objects;
 	uint16_t ObjectsSize;
 	LC_Object_t SystemObjects[LC_SYS_End - LC_SYS_NodeName];
 	void* Directories;
 	uint16_t DirectoriesSize;
+#ifdef LEVCAN_PARAM_NAME_INDEX
+	void* NameIndex; //config parser name hash, built on first lookup
+#endif
 } LC_NodeDescription_t;
 
 typedef struct {
 	LC_NodeShortName_t ShortName;
 	uint32_t LastRXtime;
+	uint32_t RxBytes; //data received from this node
+	uint32_t TxBytes; //data queued for this node
+#ifdef LEVCAN_HEARTBEAT
+	uint16_t HeartbeatPeriod; //ms, advertised by node. 0 - no heartbeat, discovery requests used
+#endif
 } LC_NodeTable_t;
 
+#ifdef LEVCAN_HEARTBEAT
+#ifndef LEVCAN_HEARTBEAT_PERIOD
+#define LEVCAN_HEARTBEAT_PERIOD 1000 //ms, default for own nodes
+#endif
+#ifndef LEVCAN_HEARTBEAT_MISSES
+#define LEVCAN_HEARTBEAT_MISSES 3 //node removed after this many periods of silence
+#endif
+#define LC_HEARTBEAT_ROLLCALL 40 //nodes in one roll call
+//LC_SYS_Heartbeat data, single frame. Announces sender and asks silent nodes to answer
+typedef struct {
+	uint16_t Period; //ms, next heartbeat expected within
+	uint8_t RollCallBase; //node id of first bit
+	uint8_t RollCall[LC_HEARTBEAT_ROLLCALL / 8]; //nodes that should send heartbeat now
+} LC_Heartbeat_t;
+#endif
+
+#ifdef LEVCAN_CLAIM_SPREAD
+#ifndef LEVCAN_CLAIM_SLOT
+#define LEVCAN_CLAIM_SLOT 1 //ms, claim slot at power-up and after lost id
+#endif
+#ifndef LEVCAN_CLAIM_SLOTS
+#define LEVCAN_CLAIM_SLOTS 16 //power-up and first back-off window, slots
+#endif
+#ifndef LEVCAN_CLAIM_MAX_SHIFT
+#define LEVCAN_CLAIM_MAX_SHIFT 3 //window doubles up to 8 times
+#endif
+#endif
+
+#ifdef LEVCAN_WARM_START
+#ifndef LEVCAN_WARM_START_NODES
+#define LEVCAN_WARM_START_NODES LEVCAN_MAX_TABLE_NODES
+#endif
+#ifndef LEVCAN_WARM_START_CLAIM_TIME
+#define LEVCAN_WARM_START_CLAIM_TIME 50 //ms, answer time for restored id claim
+#endif
+#ifndef LEVCAN_WARM_START_SAVE_PERIOD
+#define LEVCAN_WARM_START_SAVE_PERIOD 10000 //ms, minimum time between saves
+#endif
+#define LC_WARM_START_MAGIC 0x4C43574D
+//node state kept between power cycles by lc_warmStartSave/lc_warmStartLoad
+typedef struct {
+	uint32_t Magic;
+	uint32_t Serial; //own node serial
+	uint16_t NodeID; //last claimed id
+	uint16_t NodesCount;
+	LC_NodeShortName_t Nodes[LEVCAN_WARM_START_NODES]; //node table
+	uint32_t Checksum;
+} LC_WarmStart_t;
+#endif
+
+//receive path drop counters, always enabled
+typedef struct {
+	uint32_t IsrFull; //rx buffer full in LC_ReceiveHandler
+	uint32_t DeferredFull; //deferred buffer full in LC_ReceiveDrain
+	uint32_t Filtered; //rejected by software filter, not an error
+	uint32_t NoMemory; //no free object for new transfer
+	uint32_t NoObject; //data for unknown transfer
+	uint16_t IsrHighWater; //max messages stored in rx buffer
+	uint16_t DeferredHighWater; //max messages stored in deferred buffer
+} LC_RxStats_t;
+
+//protocol counters, always enabled
+typedef struct {
+	uint32_t RxFrames[4]; //by LC_Priority_t
+	uint32_t TxFrames[4]; //by LC_Priority_t, sent to driver
+	LC_RxStats_t Rx;
+	uint16_t TxHighWater; //max messages stored in tx buffer
+	uint32_t Retransmits; //TCP data sent again after no answer
+	uint32_t ParityRollbacks; //TCP receiver asked for previous data
+	uint32_t TxTimeouts;
+	uint32_t RxTimeouts;
+	uint32_t TransfersCreated; //TCP or long TX/RX objects
+	uint32_t TransfersAborted; //objects deleted before finish
+	uint32_t AllocFails; //no free object or memory
+	uint32_t TxCollisions; //same object already in transmission
+	uint32_t AddressCollisions; //address claim for one of own ID received
+	struct {
+		uint16_t NodeID; //LC_Broadcast_Address - empty
+		uint32_t RxBytes;
+		uint32_t TxBytes;
+	} Peers[LEVCAN_MAX_TABLE_NODES];
+} LC_Metrics_t;
+
 typedef void (*LC_FunctionCall_t)(LC_NodeDescription_t* node, LC_Header_t header, void* data, int32_t size);
 
 typedef enum {
@@ -158,6 +266,14 @@ uintptr_t* LC_CreateNode(LC_NodeInit_t node);
 void LC_AddressClaimHandler(LC_NodeShortName_t node, uint16_t mode);
 void LC_ReceiveHandler(void);
 void LC_NetworkManager(uint32_t time);
+#ifdef LEVCAN_RX_DEFERRED_SIZE
+void LC_ReceiveDrain(void);
+#endif
+LC_RxStats_t LC_GetRxStats(void);
+void LC_GetMetrics(LC_Metrics_t* metrics);
+#ifdef LEVCAN_SOFTWARE_FILTER
+void LC_SoftFilterUpdate(void);
+#endif
 LC_Return_t LC_SendMessage(void* sender, LC_ObjectRecord_t* object, uint16_t index);
 LC_Return_t LC_SendRequest(void* sender, uint16_t target, uint16_t index);
 LC_Return_t LC_SendRequestSpec(void* sender, uint16_t target, uint16_t index, uint8_t size, uint8_t TCP);
@@ -167,3 +283,7 @@ LC_NodeShortName_t LC_GetActiveNodes(uint16_t* last_pos);
 LC_NodeShortName_t LC_GetNode(uint16_t nodeID);
 LC_NodeShortName_t LC_GetMyNodeName(void* mynode);
 int16_t LC_GetMyNodeIndex(void* mynode);
+int16_t LC_GetNodeIndex(uint16_t nodeID);
+#ifdef LEVCAN_WARM_START
+void LC_WarmStartSave(void* mynode);
+#endif
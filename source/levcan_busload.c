@@ -0,0 +1,170 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, bus load estimator
+ * levcan_busload.c
+ *
+ * Every frame seen by this node (received and sent) is converted to on-wire bit time.
+ * Only frames passed hardware filter are visible, so per-index and per-source values
+ * show own traffic and traffic addressed to us; total load is lower bound.
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include <string.h>
+
+#include "levcan.h"
+#include "levcan_busload.h"
+#include "levcan_internal.h"
+
+//private functions
+uint16_t busloadPercent(uint32_t bits, uint32_t period);
+//private variables
+volatile uint32_t busload_slots[LEVCAN_BUSLOAD_SLOTS][5]; //total and 4 priorities
+volatile uint16_t busload_slot = 0;
+uint32_t busload_slot_time = 0;
+uint16_t busload_rotations = 0;
+volatile uint32_t busload_source[LC_Null_Address];
+uint16_t busload_source_last[LC_Null_Address];
+volatile LC_BusLoadIndex_t busload_top[LEVCAN_BUSLOAD_TOP];
+//system object data
+LC_BusLoad_t lc_busload = { 0 };
+
+/// Worst-case on-wire length of extended frame, bits
+/// @param length Data length
+/// @param request Remote frame, no data on wire
+/// @return Bits including stuffing, ACK, EOF and interframe space
+uint16_t LC_BusLoadBits(uint16_t length, uint8_t request) {
+	if (request)
+		length = 0;
+	if (length > 8)
+		length = 8;
+	//SOF, 29bit ID, SRR, IDE, RTR, r1, r0, DLC, data, CRC - stuffed part
+	uint16_t stuffed = 54 + 8 * length;
+	//CRC delimiter, ACK, EOF, IFS are fixed form. Stuff bit every 4 bits at worst
+	return stuffed + 13 + (stuffed - 1) / 4;
+}
+
+/// Accounts one frame, called from receive and transmit paths
+/// @param header Frame identifier, headerPacked_t format
+/// @param length Data length
+void LC_BusLoadFrame(uint32_t header, uint16_t length) {
+	headerPacked_t hdr = { .ToUint32 = header };
+	uint16_t bits = LC_BusLoadBits(length, hdr.Request);
+	//receive and transmit interrupts may preempt each other
+	lc_disable_irq();
+	uint16_t slot = busload_slot;
+	busload_slots[slot][0] += bits;
+	busload_slots[slot][1 + ((~hdr.Priority) & 0x3)] += bits;
+	if (hdr.Source < LC_Null_Address)
+		busload_source[hdr.Source] += bits;
+	//keep busiest indices, replace the least one (space-saving counter)
+	int min = 0, found = -1;
+	for (int i = 0; i < LEVCAN_BUSLOAD_TOP && found < 0; i++) {
+		if (busload_top[i].MsgID == hdr.MsgID && (busload_top[i].Bits || busload_top[i].Load))
+			found = i;
+		else if (busload_top[i].Bits < busload_top[min].Bits)
+			min = i;
+	}
+	if (found < 0) {
+		found = min;
+		busload_top[min].MsgID = hdr.MsgID;
+		busload_top[min].Load = 0;
+	}
+	busload_top[found].Bits += bits;
+	lc_enable_irq();
+}
+
+/// Moves sliding window. Call it periodically, with LC_NetworkManager for example
+/// @param time Time passed since last call, ms
+void LC_BusLoadManager(uint32_t time) {
+	const uint32_t slot_period = LEVCAN_BUSLOAD_PERIOD / LEVCAN_BUSLOAD_SLOTS;
+	busload_slot_time += time;
+	while (busload_slot_time >= slot_period) {
+		busload_slot_time -= slot_period;
+		//sum full window, current slot is complete now
+		uint32_t sum[5] = { 0 };
+		for (int s = 0; s < LEVCAN_BUSLOAD_SLOTS; s++)
+			for (int i = 0; i < 5; i++)
+				sum[i] += busload_slots[s][i];
+		lc_busload.Load = busloadPercent(sum[0], LEVCAN_BUSLOAD_PERIOD);
+		for (int i = 0; i < 4; i++)
+			lc_busload.Priority[i] = busloadPercent(sum[1 + i], LEVCAN_BUSLOAD_PERIOD);
+		if (lc_busload.Load > lc_busload.Peak)
+			lc_busload.Peak = lc_busload.Load;
+
+		//next slot, oldest one is overwritten
+		uint16_t next = (busload_slot + 1) % LEVCAN_BUSLOAD_SLOTS;
+		lc_disable_irq();
+		for (int i = 0; i < 5; i++)
+			busload_slots[next][i] = 0;
+		busload_slot = next;
+		lc_enable_irq();
+
+		//per source and per index values use whole window without sliding
+		busload_rotations++;
+		if (busload_rotations < LEVCAN_BUSLOAD_SLOTS)
+			continue;
+		busload_rotations = 0;
+		for (int i = 0; i < LC_Null_Address; i++) {
+			lc_disable_irq();
+			uint32_t bits = busload_source[i];
+			busload_source[i] = 0;
+			lc_enable_irq();
+			busload_source_last[i] = busloadPercent(bits, LEVCAN_BUSLOAD_PERIOD);
+		}
+		lc_disable_irq();
+		for (int i = 0; i < LEVCAN_BUSLOAD_TOP; i++) {
+			busload_top[i].Load = busloadPercent(busload_top[i].Bits, LEVCAN_BUSLOAD_PERIOD);
+			busload_top[i].Bits = 0;
+		}
+		lc_enable_irq();
+	}
+}
+
+/// Returns total and per priority bus load
+LC_BusLoad_t LC_BusLoadGet(void) {
+	return lc_busload;
+}
+
+/// Returns bus load caused by one node in last window
+/// @param source Node ID
+uint16_t LC_BusLoadSource(uint16_t source) {
+	if (source >= LC_Null_Address)
+		return 0;
+	return busload_source_last[source];
+}
+
+/// Returns busiest message indices of last window, sorted by load
+/// @param indices Output array
+/// @param max Output array size
+/// @return Indices copied
+uint16_t LC_BusLoadTop(LC_BusLoadIndex_t* indices, uint16_t max) {
+	uint16_t count = 0;
+	LC_BusLoadIndex_t top[LEVCAN_BUSLOAD_TOP];
+	lc_disable_irq();
+	memcpy(top, (void*) busload_top, sizeof(top));
+	lc_enable_irq();
+	//insertion sort, small table
+	for (int i = 0; i < LEVCAN_BUSLOAD_TOP; i++) {
+		if (top[i].Load == 0)
+			continue;
+		int pos = count;
+		while (pos > 0 && indices[pos - 1].Load < top[i].Load) {
+			if (pos < max)
+				indices[pos] = indices[pos - 1];
+			pos--;
+		}
+		if (pos < max)
+			indices[pos] = top[i];
+		if (count < max)
+			count++;
+	}
+	return count;
+}
+
+uint16_t busloadPercent(uint32_t bits, uint32_t period) {
+	//bits * 10000 / (bitrate * period / 1000), no overflow up to 429 Mbit per window
+	uint64_t load = (uint64_t) bits * 10000 * 1000 / ((uint64_t) LEVCAN_BUSLOAD_BITRATE * period);
+	if (load > UINT16_MAX)
+		load = UINT16_MAX;
+	return load;
+}
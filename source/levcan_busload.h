@@ -0,0 +1,48 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, bus load estimator
+ * levcan_busload.h
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "stdint.h"
+#include "levcan.h"
+
+#pragma once
+
+//CAN bit rate, bit/s
+#ifndef LEVCAN_BUSLOAD_BITRATE
+#define LEVCAN_BUSLOAD_BITRATE 1000000
+#endif
+//Sliding window length, ms
+#ifndef LEVCAN_BUSLOAD_PERIOD
+#define LEVCAN_BUSLOAD_PERIOD 1000
+#endif
+//Window divided in slots, more slots - smoother value
+#ifndef LEVCAN_BUSLOAD_SLOTS
+#define LEVCAN_BUSLOAD_SLOTS 4
+#endif
+//Tracked message indices, busiest ones are kept
+#ifndef LEVCAN_BUSLOAD_TOP
+#define LEVCAN_BUSLOAD_TOP 16
+#endif
+
+//Load values are in 0.01% of bus capacity (10000 - 100%)
+typedef struct {
+	uint16_t Load; //sliding window
+	uint16_t Peak; //maximum Load since start
+	uint16_t Priority[4]; //by LC_Priority_t
+} LC_BusLoad_t;
+
+typedef struct {
+	uint16_t MsgID;
+	uint16_t Load; //last full window
+	uint32_t Bits; //current window
+} LC_BusLoadIndex_t;
+
+uint16_t LC_BusLoadBits(uint16_t length, uint8_t request);
+void LC_BusLoadFrame(uint32_t header, uint16_t length);
+void LC_BusLoadManager(uint32_t time);
+LC_BusLoad_t LC_BusLoadGet(void);
+uint16_t LC_BusLoadSource(uint16_t source);
+uint16_t LC_BusLoadTop(LC_BusLoadIndex_t* indices, uint16_t max);
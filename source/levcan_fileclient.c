@@ -18,6 +18,9 @@
 #ifndef LEVCAN_FILE_DATASIZE
 #define LEVCAN_FILE_DATASIZE LEVCAN_OBJECT_DATASIZE
 #endif
+#ifndef LEVCAN_FILE_TIMEOUT
+#define LEVCAN_FILE_TIMEOUT 500 //ms, answer wait of each request
+#endif
 
 #if LEVCAN_OBJECT_DATASIZE < 16
 #error "Too small LEVCAN_OBJECT_DATASIZE size for file io!"
@@ -26,11 +29,15 @@
 extern void *lcdelay(uint32_t time);
 //private functions
 LC_FileResult_t lc_client_sendwait(void* data, uint16_t size, void* sender_node, int16_t* retid);
+LC_FileResult_t readSend(int id, void* sender_node, char* buffer, uint16_t size, uint32_t position);
 //private variables
 volatile fRead_t rxtoread[LEVCAN_MAX_OWN_NODES] = { 0 };
 volatile uint32_t fpos[LEVCAN_MAX_OWN_NODES] = { 0 };
 volatile uint8_t fnode[LEVCAN_MAX_OWN_NODES] = { [0 ... (LEVCAN_MAX_OWN_NODES - 1)] = LC_Broadcast_Address };
 volatile fOpAck_t rxack[LEVCAN_MAX_OWN_NODES] = { 0 };
+//LC_FileReadAhead request waiting for LC_FileReadWait
+char* ahead_buffer[LEVCAN_MAX_OWN_NODES] = { 0 };
+uint16_t ahead_size[LEVCAN_MAX_OWN_NODES] = { 0 };
 #ifdef LEVCAN_BUFFER_FILEPRINTF
 char lc_printf_buffer[LEVCAN_FILE_DATASIZE - sizeof(fOpData_t)];
 uint32_t lc_printf_size = 0;
@@ -137,14 +144,6 @@ LC_FileResult_t LC_FileRead(char* buffer, uint32_t btr, uint32_t* br, void* send
 	if (server.FileServer == 0 || server.NodeID == LC_Broadcast_Address)
 		return LC_FR_NodeOffline;
 
-	fOpRead_t readf;
-	readf.Operation = fOpRead;
-	LC_ObjectRecord_t rec = { 0 };
-	rec.Attributes.TCP = 1;
-	rec.Attributes.Priority = LC_Priority_Low;
-	rec.NodeID = server.NodeID;
-	rec.Address = &readf;
-	rec.Size = sizeof(fOpRead_t);
 	LC_FileResult_t ret = LC_FR_Ok;
 
 	for (uint32_t position = 0; position < btr;) {
@@ -157,25 +156,10 @@ LC_FileResult_t LC_FileRead(char* buffer, uint32_t btr, uint32_t* br, void* send
 			toreadnow = LEVCAN_FILE_DATASIZE - sizeof(fOpData_t);
 		if (toreadnow > INT16_MAX)
 			toreadnow = INT16_MAX;
-		//Prepare receiver
-		rxtoread[id].Buffer = &buffer[position];
-		rxtoread[id].Error = 0;
-		rxtoread[id].Position = UINT32_MAX;
-		rxtoread[id].ReadBytes = toreadnow;
-		readf.ToBeRead = toreadnow;
-		readf.Position = globalpos; //add global position
-
-		LC_Return_t sr = LC_SendMessage(sender_node, &rec, LC_SYS_FileClient);
+		ret = readSend(id, sender_node, &buffer[position], toreadnow, globalpos);
 		//send error?
-		if (sr) {
-			if (sr == LC_BufferFull)
-				ret = LC_FR_NetworkBusy;
-			else if (sr == LC_MallocFail)
-				ret = LC_FR_MemoryFull;
-			else
-				ret = LC_FR_NetworkError;
+		if (ret)
 			break;
-		}
 		//wait 500ms
 		for (int time = 0; time < LEVCAN_FILE_TIMEOUT; time++) {
 			lcdelay(1);
@@ -210,6 +194,107 @@ LC_FileResult_t LC_FileRead(char* buffer, uint32_t btr, uint32_t* br, void* send
 	return ret;
 }
 
+/// Requests next part of the file without waiting, data comes to buffer in background.
+/// Parse previous part meanwhile, then get result with LC_FileReadWait. One request per node
+/// @param buffer Buffer to store read data, not touched by caller until LC_FileReadWait
+/// @param btr Number of bytes to read, one LEVCAN_FILE_DATASIZE message at most
+/// @param sender_node Own network node
+/// @return LC_FileResult_t
+LC_FileResult_t LC_FileReadAhead(char* buffer, uint32_t btr, void* sender_node) {
+	if (buffer == 0 || btr == 0)
+		return LC_FR_InvalidParameter;
+	int id = LC_GetMyNodeIndex(sender_node);
+	if (id < 0)
+		return LC_FR_NodeOffline;
+	if (ahead_size[id])
+		return LC_FR_Locked;
+	if (btr > LEVCAN_FILE_DATASIZE - sizeof(fOpData_t))
+		btr = LEVCAN_FILE_DATASIZE - sizeof(fOpData_t);
+	if (btr > INT16_MAX)
+		btr = INT16_MAX;
+	LC_FileResult_t ret = readSend(id, sender_node, buffer, btr, fpos[id]);
+	if (ret == LC_FR_Ok) {
+		ahead_buffer[id] = buffer;
+		ahead_size[id] = btr;
+	}
+	return ret;
+}
+
+/// Waits for LC_FileReadAhead data, lost request is repeated
+/// @param br Number of bytes read, less than requested at file end
+/// @param sender_node Own network node
+/// @return LC_FileResult_t
+LC_FileResult_t LC_FileReadWait(uint32_t* br, void* sender_node) {
+	if (br == 0)
+		return LC_FR_InvalidParameter;
+	*br = 0;
+	int id = LC_GetMyNodeIndex(sender_node);
+	if (id < 0)
+		return LC_FR_NodeOffline;
+	uint16_t size = ahead_size[id];
+	if (size == 0)
+		return LC_FR_InvalidParameter;
+	LC_FileResult_t ret = LC_FR_Ok;
+	for (uint16_t attempt = 0;;) {
+		for (int time = 0; time < LEVCAN_FILE_TIMEOUT; time++) {
+			if (rxtoread[id].Position != UINT32_MAX)
+				break;
+			lcdelay(1);
+		}
+		if (rxtoread[id].Position == fpos[id] && rxtoread[id].ReadBytes <= size) {
+			*br = rxtoread[id].ReadBytes;
+			if (rxtoread[id].Error && rxtoread[id].Error != LC_FR_NetworkError)
+				ret = rxtoread[id].Error;
+			break;
+		}
+		attempt++;
+		if (attempt > 3) {
+			ret = LC_FR_NetworkTimeout;
+			break;
+		}
+		ret = readSend(id, sender_node, ahead_buffer[id], size, fpos[id]);
+		if (ret)
+			break;
+	}
+	fpos[id] += *br;
+	rxtoread[id].Buffer = 0;
+	ahead_size[id] = 0;
+	return ret;
+}
+
+/// Prepares receiver and sends one read request
+LC_FileResult_t readSend(int id, void* sender_node, char* buffer, uint16_t size, uint32_t position) {
+	if (fnode[id] == LC_Broadcast_Address)
+		return LC_FR_FileNotOpened;
+	LC_NodeShortName_t server = LC_GetNode(fnode[id]);
+	if (server.FileServer == 0 || server.NodeID == LC_Broadcast_Address)
+		return LC_FR_NodeOffline;
+	fOpRead_t readf;
+	readf.Operation = fOpRead;
+	readf.ToBeRead = size;
+	readf.Position = position; //add global position
+	LC_ObjectRecord_t rec = { 0 };
+	rec.Attributes.TCP = 1;
+	rec.Attributes.Priority = LC_Priority_Low;
+	rec.NodeID = server.NodeID;
+	rec.Address = &readf;
+	rec.Size = sizeof(fOpRead_t);
+	//Prepare receiver
+	rxtoread[id].Buffer = buffer;
+	rxtoread[id].Error = 0;
+	rxtoread[id].Position = UINT32_MAX;
+	rxtoread[id].ReadBytes = size;
+	LC_Return_t sr = LC_SendMessage(sender_node, &rec, LC_SYS_FileClient);
+	if (sr == LC_Ok)
+		return LC_FR_Ok;
+	rxtoread[id].Buffer = 0;
+	if (sr == LC_BufferFull)
+		return LC_FR_NetworkBusy;
+	else if (sr == LC_MallocFail)
+		return LC_FR_MemoryFull;
+	return LC_FR_NetworkError;
+}
+
 /// Writes data to a file.
 /// @param buffer Pointer to the data to be written
 /// @param btw Number of bytes to write
@@ -264,7 +349,7 @@ LC_FileResult_t LC_FileWrite(const char* buffer, uint32_t btw, uint32_t* bw, voi
 			}
 		}
 		//got some errs?
-		if (ret != LC_FR_NetworkError) {
+		if (ret != LC_FR_Ok && ret != LC_FR_NetworkError) {
 			break;
 		}
 	}
@@ -56,6 +56,8 @@ typedef struct {
 
 LC_FileResult_t LC_FileOpen(char* name, LC_FileAccess_t mode, void* sender_node, uint8_t server_node);
 LC_FileResult_t LC_FileRead(char* buffer, uint32_t btr, uint32_t* br, void* sender_node);
+LC_FileResult_t LC_FileReadAhead(char* buffer, uint32_t btr, void* sender_node);
+LC_FileResult_t LC_FileReadWait(uint32_t* br, void* sender_node);
 LC_FileResult_t LC_FileWrite(const char* buffer, uint32_t btw, uint32_t* bw, void* sender_node);
 LC_FileResult_t LC_FileClose(void* sender_node, uint8_t server_node);
 LC_FileResult_t LC_FileLseek(uint32_t position, void* sender_node);
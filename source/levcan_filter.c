@@ -0,0 +1,301 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, acceptance filter planner
+ * levcan_filter.c
+ *
+ * Builds set of (MsgID, Target) pairs that node can receive, from it's object dictionary,
+ * system objects and subscriptions. Then covers this set by a minimal number of mask
+ * filters, merging the closest ones until they fit into hardware filter banks.
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include <string.h>
+
+#include "levcan.h"
+#include "levcan_internal.h"
+#include "levcan_filter.h"
+
+//filter key: MsgID (10bit) << 7 | Target (7bit)
+#define KEY_BITS 17
+#define KEY_MASK ((1UL << KEY_BITS) - 1)
+
+typedef struct {
+	uint32_t Value;
+	uint32_t Care;
+} cube_t;
+
+typedef struct {
+	cube_t Cubes[LEVCAN_FILTER_PLAN_SIZE];
+	uint16_t Count;
+} plan_t;
+
+//private functions
+void collectIndices(const LC_NodeDescription_t* nodes, uint16_t nodes_count, uint8_t* bitmap, uint8_t* targets, uint16_t* targets_count,
+		uint8_t* broadcast_all);
+void addRange(plan_t* plan, uint8_t* bitmap, uint16_t target);
+void addCube(plan_t* plan, cube_t cube);
+void mergeExact(plan_t* plan);
+void mergeCheapest(plan_t* plan);
+void removeCovered(plan_t* plan, uint16_t keep);
+cube_t mergeCubes(cube_t a, cube_t b);
+uint32_t cubeSize(cube_t cube);
+int cubeCovers(cube_t a, cube_t b);
+int popcount32(uint32_t value);
+//extern variables
+extern const uint16_t* filter_subscriptions; //LC_FilterSubscribe
+extern uint16_t filter_subscriptions_size;
+
+/// Computes hardware mask filters, accepting every (MsgID, Target) node needs
+/// @param nodes Own nodes array
+/// @param nodes_count Array size
+/// @param rules Output filter rules
+/// @param max_rules Available hardware filters
+/// @return Rules count, -1 if failed
+int16_t LC_FilterPlan(const LC_NodeDescription_t* nodes, uint16_t nodes_count, LC_FilterRule_t* rules, uint16_t max_rules) {
+	uint8_t bitmap[1024 / 8];
+	uint8_t system[1024 / 8];
+	uint8_t targets[LEVCAN_MAX_OWN_NODES];
+	uint16_t targets_count = 0;
+	uint8_t broadcast_all = 0;
+	plan_t plan;
+
+	if (rules == 0 || max_rules == 0)
+		return -1;
+	plan.Count = 0;
+
+	collectIndices(nodes, nodes_count, bitmap, targets, &targets_count, &broadcast_all);
+	//own addresses receive everything in dictionary
+	for (int i = 0; i < targets_count; i++)
+		addRange(&plan, bitmap, targets[i]);
+	//broadcast gets only system messages until node is online
+	if (broadcast_all)
+		addRange(&plan, bitmap, LC_Broadcast_Address);
+	else {
+		memset(system, 0, sizeof(system));
+		for (uint16_t id = LC_SYS_AddressClaimed; id < LC_SYS_End; id++)
+			system[id / 8] |= 1 << (id % 8);
+		addRange(&plan, system, LC_Broadcast_Address);
+	}
+	mergeExact(&plan);
+	while (plan.Count > max_rules)
+		mergeCheapest(&plan);
+
+	for (int i = 0; i < plan.Count; i++) {
+		headerPacked_t reg = { 0 }, mask = { 0 };
+		reg.MsgID = plan.Cubes[i].Value >> 7;
+		reg.Target = plan.Cubes[i].Value & 0x7F;
+		mask.MsgID = plan.Cubes[i].Care >> 7;
+		mask.Target = plan.Cubes[i].Care & 0x7F;
+		rules[i].Reg = reg.ToUint32;
+		rules[i].Mask = mask.ToUint32;
+	}
+	return plan.Count;
+}
+
+void collectIndices(const LC_NodeDescription_t* nodes, uint16_t nodes_count, uint8_t* bitmap, uint8_t* targets, uint16_t* targets_count,
+		uint8_t* broadcast_all) {
+	memset(bitmap, 0, 1024 / 8);
+	//system messages always
+	for (uint16_t id = LC_SYS_AddressClaimed; id < LC_SYS_End; id++)
+		bitmap[id / 8] |= 1 << (id % 8);
+	for (int i = 0; i < filter_subscriptions_size; i++)
+		bitmap[(filter_subscriptions[i] & 0x3FF) / 8] |= 1 << (filter_subscriptions[i] % 8);
+
+	for (int n = 0; n < nodes_count; n++) {
+		const LC_NodeDescription_t* node = &nodes[n];
+		if (node->State == LCNodeState_Disabled || node->ShortName.NodeID >= LC_Null_Address)
+			continue;
+		if (*targets_count < LEVCAN_MAX_OWN_NODES)
+			targets[(*targets_count)++] = node->ShortName.NodeID;
+		if (node->State == LCNodeState_Online)
+			*broadcast_all = 1;
+		for (int i = 0; i < node->ObjectsSize; i++) {
+			uint16_t id = node->Objects[i].Index & 0x3FF;
+			bitmap[id / 8] |= 1 << (id % 8);
+		}
+	}
+}
+
+void addRange(plan_t* plan, uint8_t* bitmap, uint16_t target) {
+	//split every run of indices to aligned power of two blocks
+	for (uint16_t id = 0; id < 1024;) {
+		if ((bitmap[id / 8] & (1 << (id % 8))) == 0) {
+			id++;
+			continue;
+		}
+		uint16_t bits = 0;
+		//grow block while aligned and fully set
+		while (bits < 10) {
+			uint16_t size = 1 << (bits + 1);
+			if (id % size)
+				break;
+			int full = 1;
+			for (uint16_t b = id + (size >> 1); b < id + size && full; b++)
+				if ((bitmap[b / 8] & (1 << (b % 8))) == 0)
+					full = 0;
+			if (!full)
+				break;
+			bits++;
+		}
+		cube_t cube;
+		cube.Care = (((0x3FFUL << bits) & 0x3FF) << 7) | 0x7F;
+		cube.Value = ((uint32_t) id << 7) | (target & 0x7F);
+		addCube(plan, cube);
+		id += 1 << bits;
+	}
+}
+
+void addCube(plan_t* plan, cube_t cube) {
+	for (int i = 0; i < plan->Count; i++)
+		if (cubeCovers(plan->Cubes[i], cube))
+			return;
+	//out of space, lose some precision
+	if (plan->Count == LEVCAN_FILTER_PLAN_SIZE)
+		mergeCheapest(plan);
+	plan->Cubes[plan->Count++] = cube;
+	removeCovered(plan, plan->Count - 1);
+}
+
+void mergeExact(plan_t* plan) {
+	//merge pairs with same care bits differing by one bit, no extra frames accepted
+	int merged = 1;
+	while (merged) {
+		merged = 0;
+		for (int a = 0; a < plan->Count && !merged; a++)
+			for (int b = a + 1; b < plan->Count && !merged; b++) {
+				uint32_t diff = plan->Cubes[a].Value ^ plan->Cubes[b].Value;
+				if (plan->Cubes[a].Care == plan->Cubes[b].Care && popcount32(diff) == 1) {
+					plan->Cubes[a] = mergeCubes(plan->Cubes[a], plan->Cubes[b]);
+					plan->Cubes[b] = plan->Cubes[--plan->Count];
+					removeCovered(plan, a);
+					merged = 1;
+				}
+			}
+	}
+}
+
+void mergeCheapest(plan_t* plan) {
+	if (plan->Count < 2)
+		return;
+	int best_a = 0, best_b = 1;
+	uint32_t best_cost = UINT32_MAX;
+	for (int a = 0; a < plan->Count; a++)
+		for (int b = a + 1; b < plan->Count; b++) {
+			//extra key space accepted by merged filter
+			uint32_t size = cubeSize(mergeCubes(plan->Cubes[a], plan->Cubes[b]));
+			uint32_t cost = size - cubeSize(plan->Cubes[a]) - cubeSize(plan->Cubes[b]);
+			if (size < cubeSize(plan->Cubes[a]) + cubeSize(plan->Cubes[b]))
+				cost = 0; //overlapped
+			if (cost < best_cost) {
+				best_cost = cost;
+				best_a = a;
+				best_b = b;
+			}
+		}
+	plan->Cubes[best_a] = mergeCubes(plan->Cubes[best_a], plan->Cubes[best_b]);
+	plan->Cubes[best_b] = plan->Cubes[--plan->Count];
+	removeCovered(plan, best_a);
+}
+
+void removeCovered(plan_t* plan, uint16_t keep) {
+	cube_t cube = plan->Cubes[keep];
+	for (int i = 0; i < plan->Count;) {
+		if (i != keep && cubeCovers(cube, plan->Cubes[i])) {
+			plan->Cubes[i] = plan->Cubes[--plan->Count];
+			if (keep == plan->Count)
+				keep = i; //moved
+		} else
+			i++;
+	}
+}
+
+cube_t mergeCubes(cube_t a, cube_t b) {
+	cube_t merged;
+	merged.Care = a.Care & b.Care & ~(a.Value ^ b.Value);
+	merged.Value = a.Value & merged.Care;
+	return merged;
+}
+
+uint32_t cubeSize(cube_t cube) {
+	return 1UL << (KEY_BITS - popcount32(cube.Care & KEY_MASK));
+}
+
+int cubeCovers(cube_t a, cube_t b) {
+	//a accepts everything b does
+	return ((a.Care & ~b.Care) == 0) && ((a.Value ^ b.Value) & a.Care) == 0;
+}
+
+int popcount32(uint32_t value) {
+	int count = 0;
+	for (; value; value &= value - 1)
+		count++;
+	return count;
+}
+
+#ifdef LEVCAN_FILTER_MODEL
+/// Checks if hardware filter banks accept frame, like bxCAN does in 32bit mask mode
+/// @param rules Filter rules
+/// @param count Rules count
+/// @param id Frame identifier in CAN_IR format
+/// @return 1 if accepted
+int LC_FilterModelAccept(const LC_FilterRule_t* rules, uint16_t count, uint32_t id) {
+	headerPacked_t ide = { 0 };
+	ide.IDE = 1;
+	for (int i = 0; i < count; i++) {
+		//HAL forces extended ID match
+		uint32_t mask = (rules[i].Mask | ide.ToUint32) & ~1UL;
+		uint32_t reg = (rules[i].Reg | ide.ToUint32) & ~1UL;
+		if (((id ^ reg) & mask) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+/// Checks if node should receive frame at all
+/// @param nodes Own nodes array
+/// @param nodes_count Array size
+/// @param id Frame identifier in CAN_IR format
+/// @return 1 if needed
+int LC_FilterModelNeeded(const LC_NodeDescription_t* nodes, uint16_t nodes_count, uint32_t id) {
+	uint8_t bitmap[1024 / 8];
+	uint8_t targets[LEVCAN_MAX_OWN_NODES];
+	uint16_t targets_count = 0;
+	uint8_t broadcast_all = 0;
+	headerPacked_t hdr = { .ToUint32 = id };
+
+	collectIndices(nodes, nodes_count, bitmap, targets, &targets_count, &broadcast_all);
+	if ((bitmap[hdr.MsgID / 8] & (1 << (hdr.MsgID % 8))) == 0)
+		return 0;
+	if (hdr.Target == LC_Broadcast_Address)
+		return broadcast_all || (hdr.MsgID >= LC_SYS_AddressClaimed && hdr.MsgID < LC_SYS_End);
+	for (int i = 0; i < targets_count; i++)
+		if (targets[i] == hdr.Target)
+			return 1;
+	return 0;
+}
+
+/// Runs recorded traffic through filter model and counts filter quality
+/// @param nodes Own nodes array
+/// @param nodes_count Array size
+/// @param rules Filter rules, from LC_FilterPlan for example
+/// @param count Rules count
+/// @param trace Recorded identifiers in CAN_IR format, as CAN_Receive returns them
+/// @param trace_size Trace length
+/// @return LC_FilterStats_t
+LC_FilterStats_t LC_FilterModelEvaluate(const LC_NodeDescription_t* nodes, uint16_t nodes_count, const LC_FilterRule_t* rules, uint16_t count,
+		const uint32_t* trace, uint32_t trace_size) {
+	LC_FilterStats_t stats = { 0 };
+	for (uint32_t i = 0; i < trace_size; i++) {
+		int accepted = LC_FilterModelAccept(rules, count, trace[i]);
+		int needed = LC_FilterModelNeeded(nodes, nodes_count, trace[i]);
+		stats.Frames++;
+		stats.Accepted += accepted;
+		stats.Needed += needed;
+		if (accepted && !needed)
+			stats.FalseAccepted++;
+		if (!accepted && needed)
+			stats.Missed++;
+	}
+	return stats;
+}
+#endif
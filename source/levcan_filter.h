@@ -0,0 +1,41 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, acceptance filter planner
+ * levcan_filter.h
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "stdint.h"
+#include "levcan.h"
+
+#pragma once
+
+//Maximum rules kept while planning, bigger value gives better result but uses more stack
+#ifndef LEVCAN_FILTER_PLAN_SIZE
+#define LEVCAN_FILTER_PLAN_SIZE 48
+#endif
+
+//one hardware mask filter, values are in headerPacked_t (CAN_IR) format
+typedef struct {
+	uint32_t Reg;
+	uint32_t Mask; //1 - care, 0 - don't care
+} LC_FilterRule_t;
+
+typedef struct {
+	uint32_t Frames; //total frames in trace
+	uint32_t Accepted; //passed hardware filter
+	uint32_t Needed; //should be received by node
+	uint32_t FalseAccepted; //passed filter, but not needed
+	uint32_t Missed; //needed, but rejected. Should be zero!
+} LC_FilterStats_t;
+
+int16_t LC_FilterPlan(const LC_NodeDescription_t* nodes, uint16_t nodes_count, LC_FilterRule_t* rules, uint16_t max_rules);
+void LC_FilterSubscribe(const uint16_t* indices, uint16_t size);
+
+#ifdef LEVCAN_FILTER_MODEL
+//host-side model of hardware filter banks
+int LC_FilterModelAccept(const LC_FilterRule_t* rules, uint16_t count, uint32_t id);
+int LC_FilterModelNeeded(const LC_NodeDescription_t* nodes, uint16_t nodes_count, uint32_t id);
+LC_FilterStats_t LC_FilterModelEvaluate(const LC_NodeDescription_t* nodes, uint16_t nodes_count, const LC_FilterRule_t* rules, uint16_t count,
+		const uint32_t* trace, uint32_t trace_size);
+#endif
@@ -0,0 +1,28 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol [LC]
+ * levcan_internal.h
+ * Private definitions shared between LEVCAN modules
+ */
+
+#include "stdint.h"
+#include "levcan_config.h"
+
+#pragma once
+
+typedef union {
+	uint32_t ToUint32;
+	struct {
+		//can specific:
+		unsigned reserved1 :1;
+		unsigned Request :1;
+		unsigned IDE :1;    //29b=1
+		//index 29bit:
+		unsigned Source :7;
+		unsigned Target :7;
+		unsigned MsgID :10;
+		unsigned EoM :1;
+		unsigned Parity :1;
+		unsigned RTS_CTS :1;
+		unsigned Priority :2;
+	}LEVCAN_PACKED;
+} headerPacked_t;
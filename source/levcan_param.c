@@ -7,6 +7,9 @@
  */
 #include "levcan.h"
 #include "levcan_param.h"
+#ifdef LEVCAN_PARAM_CACHE
+#include "levcan_paramcache.h"
+#endif
 
 #include <stdio.h>
 #include <string.h>
@@ -40,21 +43,190 @@ typedef struct {
 	void* Node;
 	uint16_t Directory;
 	uint16_t Source;
+	uint16_t Order; //enqueue sequence, requests are sent in this order
+	uint16_t Time; //ms since request sent
 	uint8_t Full;
+	uint8_t Sent;
+	uint8_t Retries;
 } bufferedParam_t;
 
+typedef struct {
+	void* Node;
+	uint16_t Target;
+	uint8_t Directory;
+	uint8_t Index;
+	uint8_t Full;
+	uint8_t TCP;
+	uint8_t Bulk; //LC_SYS_ParametersEx answer, Index is first parameter or directory
+	uint8_t Opcode; //request
+	uint8_t Count;
+} bufferedReply_t;
+
+typedef struct {
+	uint8_t Opcode;
+	uint8_t Directory;
+	uint8_t First;
+	uint8_t Count;
+} bulkRequestPacked_t;
+
+typedef struct {
+	uint8_t Opcode;
+	uint8_t Directory;
+	uint8_t First;
+	uint8_t Count; //records in this answer
+	uint16_t DirectorySize;
+	uint16_t Capabilities; //PX_CAP_x of answering node, 0 in older nodes
+} bulkAnswerPacked_t;
+
+//bulkAnswerPacked_t.Capabilities
+#define PX_CAP_COMPACT 0x01
+//longest compact record without strings: type, value, min, max, step (5 bytes varint), decimal
+#define PX_COMPACT_MAX 22
+#define ZIGZAG(v) (((uint32_t) (v) << 1) ^ (uint32_t) ((int32_t) (v) >> 31))
+#define UNZIGZAG(u) ((int32_t) (((u) >> 1) ^ -((u) & 1)))
+
+typedef struct {
+	void* Array; //LC_ParameterValue_t by parameter index or LC_ParameterTag_t by directory
+	void* Node;
+	uint16_t Size;
+	uint16_t Directory;
+	uint16_t Source;
+	uint16_t Next; //first index of next request
+	uint16_t Time;
+	uint8_t Opcode; //request
+	uint8_t Sent;
+	uint8_t Retries;
+} bufferedBulk_t;
+
+#ifdef LEVCAN_PARAM_SUBSCRIBE
+typedef struct {
+	void* Node; //own node, 0 - free
+	uint16_t Target;
+	uint16_t Lease; //ms since last renew
+	uint8_t Directory;
+	uint8_t First;
+	uint8_t Count;
+	uint8_t Fresh; //send every value on next scan
+	int32_t Shadow[LEVCAN_PARAM_SUBSCRIBE_SIZE]; //last sent values
+} bufferedSubscription_t;
+
+typedef struct {
+	LC_ParameterValue_t* Array; //optional, by parameter index
+	void* Node; //0 - free
+	uint16_t Size;
+	uint16_t Source;
+	uint16_t Time; //ms since renew sent
+	uint8_t Directory;
+	uint8_t First;
+	uint8_t Count;
+	uint8_t Renew; //subscribe request should be sent
+} bufferedWatch_t;
+#endif
+
+#if defined(LEVCAN_PARAMETERS_PARSING) && defined(LEVCAN_PARAM_NAME_INDEX)
+//name slot Directory values
+#define NAME_DIRECTORY 0xFFFE //directory name, Index is directory
+#define NAME_EMPTY 0xFFFF
+
+typedef struct {
+	uint16_t Directory;
+	uint16_t Index;
+} nameSlot_t;
+
+typedef struct {
+	const void* Owner; //node
+	const void* Directories; //table index was built from
+	LC_ParameterDirectory_t* Layout; //copy of table, directory may be edited in place
+	uint16_t DirectoriesSize;
+	uint16_t Mask; //slots - 1
+	nameSlot_t Slots[];
+} nameIndex_t;
+#endif
+
 //### Local functions ###
 void lc_proceedParam(LC_NodeDescription_t* node, LC_Header_t header, void* data, int32_t size);
+void lc_paramManager(uint32_t time);
+void lc_proceedParamEx(LC_NodeDescription_t* node, LC_Header_t header, void* data, int32_t size);
 const char* extractName(const LC_ParameterAdress_t* param);
 uint16_t check_align(const LC_ParameterAdress_t* parameter);
 bufferedParam_t* findReceiver(int16_t dir, int16_t index, int16_t source);
+uint16_t countSent(uint16_t source);
+uint16_t windowSize(uint16_t source);
+void learnWindow(uint16_t source, uint8_t windowed);
 void proceed_RX(void);
+void proceed_TX(void);
+bufferedReply_t* replyPush(LC_NodeDescription_t* node, uint16_t target);
+LC_Return_t sendReply(const bufferedReply_t* reply);
+LC_Return_t sendBulk(const bufferedReply_t* reply);
+int32_t bulkRecordSize(const LC_ParameterAdress_t* parameter, int32_t* namelength, int32_t* formatlength);
+void packParameter(parameterValuePacked_t* packed, const LC_ParameterAdress_t* parameter, uint8_t dir, uint8_t index, uint16_t dirsize);
+int32_t compactEncode(uint8_t* out, const parameterValuePacked_t* packed);
+int32_t compactDecode(parameterValuePacked_t* packed, const uint8_t* data, int32_t size);
+uint8_t* putVarint(uint8_t* out, uint32_t value);
+const uint8_t* getVarint(const uint8_t* data, const uint8_t* end, uint32_t* value);
+void receiveBulk(uint16_t source, const uint8_t* data, int32_t size);
+void receiveTags(uint16_t source, const uint8_t* data, int32_t size);
+void learnCapabilities(uint16_t source, uint16_t capabilities);
+bufferedBulk_t* findBulk(uint16_t source, uint8_t opcode, uint16_t dir, uint16_t first);
+LC_Return_t sendTags(const bufferedReply_t* reply);
+void applyBatch(LC_NodeDescription_t* node, LC_Header_t header, const uint8_t* data, int32_t size);
+uint8_t checkSetItem(LC_NodeDescription_t* node, uint8_t dir, uint8_t index, int32_t value);
+LC_Return_t sendBatch(bufferedBulk_t* bulk);
+void receiveBatchResult(uint16_t source, const uint8_t* data, int32_t size);
+uint32_t hashBytes(uint32_t hash, const void* data, int32_t size);
+int32_t storeFull(LC_ParameterValue_t* param, const parameterValuePacked_t* received, const char* literals, int32_t maxstr);
+#ifdef LEVCAN_PARAM_SUBSCRIBE
+void subscribe(LC_NodeDescription_t* node, uint16_t target, const bulkRequestPacked_t* request);
+void unsubscribe(LC_NodeDescription_t* node, uint16_t target, const bulkRequestPacked_t* request);
+void notifyChanges(uint32_t time);
+LC_Return_t sendChanges(void* node, uint16_t target);
+void receiveChanges(uint16_t source, const uint8_t* data, int32_t size);
+void renewWatches(uint32_t time);
+void lc_param_onchange(uint16_t source, uint16_t dir, uint16_t index, int32_t value);
+extern void __attribute__((weak, alias("lc_param_onchange")))
+LC_ParameterOnChange(uint16_t source, uint16_t dir, uint16_t index, int32_t value);
+#endif
+#ifdef LEVCAN_PARAMETERS_PARSING
+uint8_t nameEquals(const char* name, const char* s, int32_t length);
+void writeText(LC_ParamWriter_t* writer, const char* text, char stop);
+void writeNumber(LC_ParamWriter_t* writer, int32_t value, uint8_t decimal);
+uint8_t writerFlush(LC_ParamWriter_t* writer);
+#ifdef LEVCAN_FILECLIENT
+void importLine(LC_NodeDescription_t* node, const char* line, int16_t* dir, LC_ParameterSetItem_t* items, uint16_t* count, LC_ParameterImport_t* counters);
+void importApply(LC_NodeDescription_t* node, const LC_ParameterSetItem_t* items, uint16_t count, LC_ParameterImport_t* counters);
+int32_t exportFlush(LC_ParamWriter_t* writer);
+#endif
+#ifdef LEVCAN_PARAM_NAME_INDEX
+nameIndex_t* nameIndexGet(LC_NodeDescription_t* node, uint16_t dir);
+int32_t nameLookup(LC_NodeDescription_t* node, uint16_t dir, const char* s, int32_t length);
+uint32_t nameKey(uint16_t dir, const char* s, int32_t length);
+uint8_t nameLayoutSame(const nameIndex_t* index, const LC_NodeDescription_t* node, uint16_t dir);
+#endif
+#endif
 const char* skipspaces(const char* s);
 int32_t pow10i(int32_t dec);
 //### Local variables ###
 bufferedParam_t receive_buffer[LEVCAN_PARAM_QUEUE_SIZE];
-volatile uint16_t receiveFIFO_in = 0, receiveFIFO_out = 0;
-volatile uint16_t receive_busy = 0;
+volatile uint16_t receive_order = 0;
+bufferedReply_t reply_buffer[LEVCAN_PARAM_REPLY_SIZE];
+volatile uint16_t replyFIFO_in = 0, replyFIFO_out = 0;
+bufferedBulk_t bulk_buffer[LEVCAN_PARAM_BULK_QUEUE];
+volatile uint8_t batch_sequence = 0;
+uint8_t compact_nodes[(LC_Broadcast_Address + 1) / 8]; //learned from answer headers
+uint8_t window_nodes[(LC_Broadcast_Address + 1) / 8]; //answered in request mode, older nodes get one request at time
+//last applied batch, repeated request gets same answer without second apply
+struct {
+	uint16_t Source;
+	uint8_t Sequence;
+	uint32_t Hash;
+	uint8_t Answer[4 + (LEVCAN_PARAM_BATCH_SIZE + 7) / 8];
+	uint8_t Size;
+} batch_last = { .Source = LC_Broadcast_Address };
+#ifdef LEVCAN_PARAM_SUBSCRIBE
+bufferedSubscription_t subscription_buffer[LEVCAN_PARAM_SUBSCRIPTIONS];
+bufferedWatch_t watch_buffer[LEVCAN_PARAM_SUBSCRIPTIONS];
+uint16_t notify_time = 0;
+#endif
 
 const char* extractName(const LC_ParameterAdress_t* param) {
 	const char* source = 0;
@@ -75,17 +247,40 @@ const char* extractName(const LC_ParameterAdress_t* param) {
 parameterValuePacked_t param_invalid = { .Index = 0, .Directory = 0, .ParamType = PT_invalid, .Literals = { 0, 0 } };
 
 bufferedParam_t* findReceiver(int16_t dir, int16_t index, int16_t source) {
-	if (receiveFIFO_in != receiveFIFO_out) {
-		//receive_buffer[receiveFIFO_out]
-		int out = receiveFIFO_out;
-		receiveFIFO_out = (receiveFIFO_out + 1) % LEVCAN_PARAM_QUEUE_SIZE;
-
-		if (receive_buffer[out].Param != 0 && receive_buffer[out].Directory == dir && receive_buffer[out].Param->Index == index && receive_buffer[out].Source == source)
-			return &receive_buffer[out];
+	//answers may come in any order, late answer to repeated request is valid too
+	for (int i = 0; i < LEVCAN_PARAM_QUEUE_SIZE; i++) {
+		bufferedParam_t* receive = &receive_buffer[i];
+		if (receive->Param != 0 && receive->Directory == dir && receive->Param->Index == index && receive->Source == source)
+			return receive;
 	}
 	return 0;
 }
 
+uint16_t countSent(uint16_t source) {
+	uint16_t sent = 0;
+	for (int i = 0; i < LEVCAN_PARAM_QUEUE_SIZE; i++)
+		if (receive_buffer[i].Param != 0 && receive_buffer[i].Sent && receive_buffer[i].Source == source)
+			sent++;
+	return sent;
+}
+
+/// Older server answers every request by TCP and drops answer while previous one is still sent,
+/// so node gets full window only after it answered UDP request by UDP
+uint16_t windowSize(uint16_t source) {
+	if (source < LC_Null_Address && (window_nodes[source / 8] & (1 << (source % 8))))
+		return LEVCAN_PARAM_WINDOW;
+	return 1;
+}
+
+void learnWindow(uint16_t source, uint8_t windowed) {
+	if (source >= LC_Null_Address)
+		return;
+	if (windowed)
+		window_nodes[source / 8] |= 1 << (source % 8);
+	else
+		window_nodes[source / 8] &= ~(1 << (source % 8));
+}
+
 uint16_t check_align(const LC_ParameterAdress_t* parameter) {
 //parameter should be aligned to avoid memory fault, this may happen when int16 accessed as int32
 	uint16_t align = 0;
@@ -165,20 +360,338 @@ int LC_SetParameterValue(const LC_ParameterAdress_t* parameter, int32_t value) {
 }
 
 void lc_proceedParam(LC_NodeDescription_t* node, LC_Header_t header, void* data, int32_t size) {
+	if (data == 0)
+		return; // nothing to do so here
+	//TODO add node filter
+	switch (size) {
+	case 2:
+	case 3: {
+		//2 byte - request (index and directory), 3 byte - request data value
+		//answers are queued, transmitter may still send previous answer to this node
+		bufferedReply_t* reply = replyPush(node, header.Source);
+		if (reply) {
+			reply->Index = ((uint8_t*) data)[0];
+			reply->Directory = ((uint8_t*) data)[1];
+			reply->Full = (size == 2);
+			//answer in request mode. UDP requests come from client that repeats lost ones,
+			//UDP answer is sent at once, without waiting for acknowledge of every frame
+			reply->TCP = header.Parity;
+		}
+		proceed_TX();
+	}
+		break;
+	case sizeof(storeValuePacked_t): {
+		//store value
+		storeValuePacked_t* store = data;
+		if (store->Directory < node->DirectoriesSize && store->Index < ((LC_ParameterDirectory_t*) node->Directories)[store->Directory].Size)
+			LC_SetParameterValue(&((LC_ParameterDirectory_t*) node->Directories)[store->Directory].Address[store->Index], store->Value);
+	}
+		break;
+	case sizeof(storeValuePacked_t) + 1: {
+		//update requested value
+		storeValuePacked_t* update = data;
+		learnWindow(header.Source, header.Parity == 0);
+		bufferedParam_t* receiver = findReceiver(update->Directory, update->Index, header.Source);
+		//somebody receiving
+		if (receiver) {
+			receiver->Param->Value = update->Value;
+			receiver->Param->ParamType &= ~PT_reqval;
+			//full information still expected
+			if (receiver->Full == 0)
+				receiver->Param = 0;
+		}
+	}
+		break;
+#ifndef LEVCAN_MEM_STATIC
+		//no receive for static memory
+	default: {
+		if (size > (int32_t) sizeof(parameterValuePacked_t)) {
+			//parameter full receive
+			parameterValuePacked_t* param_received = data;
+			learnWindow(header.Source, header.Parity == 0);
+			bufferedParam_t* receiver = findReceiver(param_received->Directory, param_received->Index, header.Source);
+			//somebody receiving
+			if (receiver) {
+				int32_t maxstr = size - sizeof(parameterValuePacked_t);
+#ifdef LEVCAN_TRACE
+				if (storeFull(receiver->Param, param_received, param_received->Literals, maxstr) > maxstr)
+					trace_printf("Parameter RX size fail\n");
+#else
+				storeFull(receiver->Param, param_received, param_received->Literals, maxstr);
+#endif
+				//delete receiver
+				receiver->Param = 0;
+			}
+		}
+	}
+#endif
+		break;
+	}
+	//window may have free place now
+	proceed_RX();
+	return; // nothing to do so here
+}
+
+void lc_proceedParamEx(LC_NodeDescription_t* node, LC_Header_t header, void* data, int32_t size) {
+	if (data == 0 || size < 1)
+		return; // nothing to do so here
+	switch (((uint8_t*) data)[0]) {
+	case LC_PX_ValuesRequest:
+	case LC_PX_FullRequest:
+	case LC_PX_CompactRequest:
+	case LC_PX_TagsRequest: {
+		if (size < (int32_t) sizeof(bulkRequestPacked_t))
+			break;
+		bulkRequestPacked_t* request = data;
+		bufferedReply_t* reply = replyPush(node, header.Source);
+		if (reply) {
+			reply->Bulk = 1;
+			reply->Opcode = request->Opcode;
+			reply->Full = (request->Opcode == LC_PX_FullRequest || request->Opcode == LC_PX_CompactRequest);
+			reply->Directory = request->Directory;
+			reply->Index = request->First;
+			reply->Count = request->Count;
+			//answer in request mode, same as single parameter
+			reply->TCP = header.Parity;
+		}
+		proceed_TX();
+	}
+		break;
+	case LC_PX_Values:
+	case LC_PX_Full:
+	case LC_PX_Compact:
+		receiveBulk(header.Source, data, size);
+		break;
+	case LC_PX_Tags:
+		receiveTags(header.Source, data, size);
+		break;
+	case LC_PX_SetBatch:
+		applyBatch(node, header, data, size);
+		break;
+	case LC_PX_SetResult:
+		receiveBatchResult(header.Source, data, size);
+		break;
+#ifdef LEVCAN_PARAM_SUBSCRIBE
+	case LC_PX_Subscribe:
+	case LC_PX_Unsubscribe:
+		if (size < (int32_t) sizeof(bulkRequestPacked_t))
+			break;
+		if (((uint8_t*) data)[0] == LC_PX_Subscribe)
+			subscribe(node, header.Source, data);
+		else
+			unsubscribe(node, header.Source, data);
+		break;
+	case LC_PX_Changes:
+		receiveChanges(header.Source, data, size);
+		break;
+#endif
+	default:
+		break;
+	}
+	proceed_RX();
+}
+
+#ifndef LEVCAN_MEM_STATIC
+/// Copies received parameter information, name and formatting are allocated.
+/// With LEVCAN_PARAM_CACHE they are pooled strings shared with cache, never freed here
+/// @return Literal bytes used by this record, more than maxstr if record is broken
+int32_t storeFull(LC_ParameterValue_t* param, const parameterValuePacked_t* received, const char* literals, int32_t maxstr) {
+	param->Decimal = received->Decimal;
+	param->Min = received->Min;
+	param->Max = received->Max;
+	param->Step = received->Step;
+	param->Value = received->Value;
+	param->ParamType = received->ParamType;
+	//param->Index=received->Index; //should be equal
+	//extract name
+	int32_t length = strnlen(literals, maxstr);
+#ifdef LEVCAN_PARAM_CACHE
+	param->Name = (char*) LC_ParamCacheIntern(literals, length);
+#else
+	char* clean = param->Name;
+	param->Name = 0;
+	if (length) {
+		param->Name = lcmalloc(length + 1);
+		if (param->Name) {
+			memcpy(param->Name, literals, length);
+			param->Name[length] = 0; //terminate string
+		}
+	}
+	//cleanup if there was pointer
+	if (clean)
+		lcfree(clean);
+#endif
+	int32_t strpos = length + 1; //skip one terminating character
+	//extract formatting
+	length = 0;
+	if (strpos < maxstr)
+		length = strnlen(&literals[strpos], maxstr - strpos);
+#ifdef LEVCAN_PARAM_CACHE
+	param->Formatting = (char*) LC_ParamCacheIntern(&literals[strpos], length);
+#else
+	clean = param->Formatting;
+	param->Formatting = 0;
+	if (length) {
+		param->Formatting = lcmalloc(length + 1);
+		if (param->Formatting) {
+			memcpy(param->Formatting, &literals[strpos], length);
+			param->Formatting[length] = 0; //terminate string
+		}
+	}
+	//cleanup if there was pointer
+	if (clean)
+		lcfree(clean);
+#endif
+	return strpos + length + 1;
+}
+#endif
+
+bufferedBulk_t* findBulk(uint16_t source, uint8_t opcode, uint16_t dir, uint16_t first) {
+	for (int i = 0; i < LEVCAN_PARAM_BULK_QUEUE; i++) {
+		bufferedBulk_t* bulk = &bulk_buffer[i];
+		if (bulk->Array != 0 && bulk->Source == source && bulk->Opcode == opcode && bulk->Directory == dir && bulk->Next == first)
+			return bulk;
+	}
+	return 0;
+}
+
+void receiveBulk(uint16_t source, const uint8_t* data, int32_t size) {
+	bulkAnswerPacked_t head;
+	if (size < (int32_t) sizeof(bulkAnswerPacked_t))
+		return;
+	memcpy(&head, data, sizeof(bulkAnswerPacked_t));
+	uint8_t compact = (head.Opcode == LC_PX_Compact);
+	uint8_t full = (head.Opcode == LC_PX_Full) || compact;
+	learnCapabilities(source, head.Capabilities);
+	bufferedBulk_t* bulk = findBulk(source, full ? LC_PX_FullRequest : LC_PX_ValuesRequest, head.Directory, head.First);
+	if (bulk == 0)
+		return;
+	LC_ParameterValue_t* params = bulk->Array;
+	//records may be unaligned, copy them out
+	int32_t position = sizeof(bulkAnswerPacked_t);
+	uint16_t count = 0;
+	for (; count < head.Count && head.First + count < bulk->Size; count++) {
+		LC_ParameterValue_t* param = &params[head.First + count];
+		if (full) {
+#ifndef LEVCAN_MEM_STATIC
+			parameterValuePacked_t packed;
+			if (compact) {
+				int32_t used = compactDecode(&packed, &data[position], size - position);
+				if (used < 0)
+					break;
+				position += used;
+			} else {
+				if (position + (int32_t) sizeof(parameterValuePacked_t) > size)
+					break;
+				memcpy(&packed, &data[position], sizeof(parameterValuePacked_t));
+				position += sizeof(parameterValuePacked_t);
+			}
+			int32_t maxstr = size - position;
+			int32_t used = storeFull(param, &packed, (const char*) &data[position], maxstr);
+			position += used;
+			if (used > maxstr)
+				break; //broken size
+#else
+			break; //no strings for static memory
+#endif
+		} else {
+			int32_t value;
+			if (position + (int32_t) sizeof(int32_t) > size)
+				break;
+			memcpy(&value, &data[position], sizeof(int32_t));
+			position += sizeof(int32_t);
+			if ((param->ParamType & PT_typeMask) != PT_dir && (param->ParamType & PT_typeMask) != PT_func)
+				param->Value = value;
+			param->ParamType &= ~PT_reqval;
+		}
+	}
+	bulk->Next = head.First + count;
+	if (count == 0 || bulk->Next >= head.DirectorySize || bulk->Next >= bulk->Size) {
+		//directory end, array tail is not in directory
+		for (uint16_t i = bulk->Next; i < bulk->Size; i++) {
+			if (full && i >= head.DirectorySize)
+				params[i].ParamType = PT_invalid;
+			else
+				params[i].ParamType &= ~PT_reqval;
+		}
+		bulk->Array = 0;
+	} else {
+		//next part
+		bulk->Sent = 0;
+		bulk->Retries = 0;
+	}
+}
+
+void learnCapabilities(uint16_t source, uint16_t capabilities) {
+	if (source >= LC_Null_Address)
+		return;
+	if (capabilities & PX_CAP_COMPACT)
+		compact_nodes[source / 8] |= 1 << (source % 8);
+	else
+		compact_nodes[source / 8] &= ~(1 << (source % 8));
+	//LC_SYS_ParametersEx came with request mode answers
+	learnWindow(source, 1);
+}
+
+void receiveTags(uint16_t source, const uint8_t* data, int32_t size) {
+	bulkAnswerPacked_t head;
+	if (size < (int32_t) sizeof(bulkAnswerPacked_t))
+		return;
+	memcpy(&head, data, sizeof(bulkAnswerPacked_t));
+	learnCapabilities(source, head.Capabilities);
+	bufferedBulk_t* bulk = findBulk(source, LC_PX_TagsRequest, 0, head.First);
+	if (bulk == 0)
+		return;
+	LC_ParameterTag_t* tags = bulk->Array;
+	int32_t position = sizeof(bulkAnswerPacked_t);
+	uint16_t count = 0;
+	for (; count < head.Count && head.First + count < bulk->Size && position + 8 <= size; count++) {
+		LC_ParameterTag_t* tag = &tags[head.First + count];
+		memcpy(&tag->Descriptor, &data[position], sizeof(uint32_t));
+		memcpy(&tag->Values, &data[position + 4], sizeof(uint32_t));
+		tag->Pending = 0;
+		position += 8;
+	}
+	bulk->Next = head.First + count;
+	if (count == 0 || bulk->Next >= head.DirectorySize || bulk->Next >= bulk->Size) {
+		//no such directories
+		for (uint16_t i = bulk->Next; i < bulk->Size; i++)
+			tags[i] = (LC_ParameterTag_t ) { 0 };
+		bulk->Array = 0;
+	} else {
+		bulk->Sent = 0;
+		bulk->Retries = 0;
+	}
+}
+
+bufferedReply_t* replyPush(LC_NodeDescription_t* node, uint16_t target) {
+	uint16_t next = (replyFIFO_in + 1) % LEVCAN_PARAM_REPLY_SIZE;
+	if (next == replyFIFO_out)
+		return 0; //client will repeat request
+	bufferedReply_t* reply = &reply_buffer[replyFIFO_in];
+	*reply = (bufferedReply_t ) { 0 };
+	reply->Node = node;
+	reply->Target = target;
+	replyFIFO_in = next;
+	return reply;
+}
+
+LC_Return_t sendReply(const bufferedReply_t* reply) {
+	if (reply->Bulk)
+		return (reply->Opcode == LC_PX_TagsRequest) ? sendTags(reply) : sendBulk(reply);
 #ifdef LEVCAN_MEM_STATIC
 	static char static_buffer[sizeof(parameterValuePacked_t) + 128] = {0};
 #endif
+	LC_NodeDescription_t* node = reply->Node;
+	uint16_t pdindex = reply->Index;
+	uint16_t pddir = reply->Directory;
 	LC_ObjectRecord_t txrec = { 0 };
 	txrec.Attributes.Priority = LC_Priority_Low;
-	txrec.Attributes.TCP = 1;
-	if (data == 0)
-		return; // nothing to do so here
-	//TODO add node filter
-	switch (size) {
-	case 2: {
-		//2 byte - request (index and directory)
-		uint16_t pdindex = ((uint8_t*) data)[0];
-		uint16_t pddir = ((uint8_t*) data)[1];
+	txrec.Attributes.TCP = reply->TCP;
+	txrec.NodeID = reply->Target;
+	LC_Return_t state = LC_Ok;
+
+	if (reply->Full) {
 		//trace_printf("Request: id=%d, dir=%d\n", pdindex,pddir);
 		int32_t value = 0;
 		LC_ParameterDirectory_t* directory = &(((LC_ParameterDirectory_t*) node->Directories)[pddir]);
@@ -206,7 +719,7 @@ void lc_proceedParam(LC_NodeDescription_t* node, LC_Header_t header, void* data,
 			parameterValuePacked_t* param_to_send = lcmalloc(totalsize);
 #endif
 			if (param_to_send == 0)
-				return; // nothing to do so here
+				return LC_MallocFail;
 
 			//just copy-paste
 			value = LC_GetParameterValue(parameter);
@@ -232,11 +745,11 @@ void lc_proceedParam(LC_NodeDescription_t* node, LC_Header_t header, void* data,
 
 			txrec.Address = param_to_send;
 			txrec.Size = totalsize;
-			txrec.NodeID = header.Source;
 #ifndef LEVCAN_MEM_STATIC
 			txrec.Attributes.Cleanup = 1;
 #endif
-			if (LC_SendMessage(node, &txrec, LC_SYS_Parameters)) {
+			state = LC_SendMessage(node, &txrec, LC_SYS_Parameters);
+			if (state) {
 #ifndef LEVCAN_MEM_STATIC
 				lcfree(param_to_send);
 #endif
@@ -247,16 +760,10 @@ void lc_proceedParam(LC_NodeDescription_t* node, LC_Header_t header, void* data,
 			param_invalid.Directory = pddir;
 			txrec.Address = &param_invalid;
 			txrec.Size = sizeof(parameterValuePacked_t) + 2;
-			txrec.NodeID = header.Source;
-			LC_SendMessage(node, &txrec, LC_SYS_Parameters);
+			state = LC_SendMessage(node, &txrec, LC_SYS_Parameters);
 			//trace_printf("Info ERR sent i:%d, d:%d\n", pdindex, pddir);
 		}
-	}
-		break;
-	case 3: {
-		//request data value
-		uint16_t pdindex = ((uint8_t*) data)[0];
-		uint16_t pddir = ((uint8_t*) data)[1];
+	} else {
 		//array correctly filled?
 		if ((pddir < node->DirectoriesSize && pdindex < ((LC_ParameterDirectory_t*) node->Directories)[pddir].Size)
 				&& (((LC_ParameterDirectory_t*) node->Directories)[pddir].Address[pdindex].ParamType & ~PT_readonly) != PT_dir
@@ -268,111 +775,309 @@ void lc_proceedParam(LC_NodeDescription_t* node, LC_Header_t header, void* data,
 
 			txrec.Address = &sendvalue;
 			txrec.Size = sizeof(storeValuePacked_t) + 1;
-			txrec.NodeID = header.Source;
 			//send back data value
-			LC_SendMessage(node, &txrec, LC_SYS_Parameters);
+			state = LC_SendMessage(node, &txrec, LC_SYS_Parameters);
 		}
 	}
+	return state;
+}
+
+int32_t bulkRecordSize(const LC_ParameterAdress_t* parameter, int32_t* namelength, int32_t* formatlength) {
+	*namelength = 0;
+	*formatlength = 0;
+	const char* s_name = extractName(parameter);
+	if (s_name)
+		*namelength = strlen(s_name);
+	if (parameter->Formatting)
+		*formatlength = strlen(parameter->Formatting);
+	//same limit as static memory single answer
+	if (*namelength + *formatlength + 2 > 128) {
+		*formatlength = 0;
+		if (*namelength + 2 > 128)
+			*namelength = 128 - 2;
+	}
+	return sizeof(parameterValuePacked_t) + *namelength + *formatlength + 2;
+}
+
+void packParameter(parameterValuePacked_t* packed, const LC_ParameterAdress_t* parameter, uint8_t dir, uint8_t index, uint16_t dirsize) {
+	packed->Value = LC_GetParameterValue(parameter);
+	packed->Min = parameter->Min;
+	if (index == 0)
+		packed->Max = dirsize; //directory size
+	else
+		packed->Max = parameter->Max;
+	packed->Step = parameter->Step;
+	packed->Decimal = parameter->Decimal;
+	packed->ParamType = parameter->ParamType;
+	packed->Index = index;
+	packed->Directory = dir;
+}
+
+/// Compact record numbers: type byte, then zigzag varints used by this type.
+/// Directory - min and max (size), function - nothing, bool - value,
+/// others - value, min, max - min (unsigned), step and decimal byte
+/// @return Bytes written, PX_COMPACT_MAX at most
+int32_t compactEncode(uint8_t* out, const parameterValuePacked_t* packed) {
+	uint8_t* start = out;
+	*out++ = packed->ParamType;
+	switch (packed->ParamType & PT_typeMask) {
+	case PT_dir:
+		out = putVarint(out, ZIGZAG(packed->Min));
+		out = putVarint(out, ZIGZAG(packed->Max));
+		break;
+	case PT_func:
+		break;
+	case PT_bool:
+		out = putVarint(out, ZIGZAG(packed->Value));
+		break;
+	default:
+		out = putVarint(out, ZIGZAG(packed->Value));
+		out = putVarint(out, ZIGZAG(packed->Min));
+		out = putVarint(out, (uint32_t) packed->Max - (uint32_t) packed->Min);
+		out = putVarint(out, ZIGZAG(packed->Step));
+		*out++ = packed->Decimal;
 		break;
-	case sizeof(storeValuePacked_t): {
-		//store value
-		storeValuePacked_t* store = data;
-		if (store->Directory < node->DirectoriesSize && store->Index < ((LC_ParameterDirectory_t*) node->Directories)[store->Directory].Size)
-			LC_SetParameterValue(&((LC_ParameterDirectory_t*) node->Directories)[store->Directory].Address[store->Index], store->Value);
 	}
+	return out - start;
+}
+
+/// Reads numbers of compact record, fields not sent for this type get defaults
+/// @return Bytes used or -1 if record is broken
+int32_t compactDecode(parameterValuePacked_t* packed, const uint8_t* data, int32_t size) {
+	const uint8_t* end = data + size;
+	const uint8_t* in = data;
+	uint32_t fields[4] = { 0 };
+	int count = 4;
+	if (size < 1)
+		return -1;
+	memset(packed, 0, sizeof(parameterValuePacked_t));
+	packed->ParamType = *in++;
+	switch (packed->ParamType & PT_typeMask) {
+	case PT_dir:
+		count = 2;
+		break;
+	case PT_func:
+		count = 0;
+		break;
+	case PT_bool:
+		count = 1;
 		break;
-	case sizeof(storeValuePacked_t) + 1: {
-		//update requested value
-		storeValuePacked_t* update = data;
-		bufferedParam_t* receiver = findReceiver(update->Directory, update->Index, header.Source);
-		//somebody receiving
-		if (receiver) {
-			receiver->Param->Value = update->Value;
-			receiver->Param->ParamType &= ~PT_reqval;
-			receiver->Param = 0;
-		}
 	}
+	for (int i = 0; i < count; i++) {
+		in = getVarint(in, end, &fields[i]);
+		if (in == 0)
+			return -1;
+	}
+	switch (packed->ParamType & PT_typeMask) {
+	case PT_dir:
+		packed->Min = UNZIGZAG(fields[0]);
+		packed->Max = UNZIGZAG(fields[1]);
 		break;
-#ifndef LEVCAN_MEM_STATIC
-		//no receive for static memory
-	default: {
-		if (size > (int32_t) sizeof(parameterValuePacked_t)) {
-			//parameter full receive
-			parameterValuePacked_t* param_received = data;
-			bufferedParam_t* receiver = findReceiver(param_received->Directory, param_received->Index, header.Source);
-			int sizefail = 0;
-			//somebody receiving
-			if (receiver) {
-				receiver->Param->Decimal = param_received->Decimal;
-				receiver->Param->Min = param_received->Min;
-				receiver->Param->Max = param_received->Max;
-				receiver->Param->Step = param_received->Step;
-				receiver->Param->Value = param_received->Value;
-				receiver->Param->ParamType = param_received->ParamType;
-				//receiver->Param->Index=param_received->Index; //should be equal
-				int32_t maxstr = size - sizeof(parameterValuePacked_t);
-				//extract name
-				char* clean = receiver->Param->Name;
-				int strpos = 0;
-				if (param_received->Literals[0] != 0) {
-					int length = strnlen(param_received->Literals, 128);
-					if (length > maxstr) {
-						//broken size!
-						sizefail = 1;
-						length = maxstr;
-					}
-					receiver->Param->Name = lcmalloc(length + 1);
-					if (receiver->Param->Name) {
-						strncpy(receiver->Param->Name, &param_received->Literals[strpos], length);
-						receiver->Param->Name[length] = 0; //terminate string
-					}
-					strpos = length;
-				} else
-					receiver->Param->Name = 0;
-				//cleanup if there was pointer
-				if (clean)
-					lcfree(clean);
-				strpos++; //skip one terminating character
-				//extract formatting
-				clean = receiver->Param->Formatting;
-				if (param_received->Literals[strpos] != 0 && strpos < maxstr) {
-					int length = strnlen(&param_received->Literals[strpos], 128);
-					if (strpos + length > maxstr) {
-						//broken size!
-						sizefail = 1;
-						length = maxstr - strpos;
-					}
-					receiver->Param->Formatting = lcmalloc(length + 1);
-					if (receiver->Param->Formatting) {
-						strcpy(receiver->Param->Formatting, &param_received->Literals[strpos]);
-						receiver->Param->Formatting[length] = 0; //terminate string
-					}
-					strpos = length + 1;
-				} else
-					receiver->Param->Formatting = 0;
-				//cleanup if there was pointer
-				if (clean)
-					lcfree(clean);
-				//delete receiver
-				receiver->Param = 0;
+	case PT_func:
+		break;
+	case PT_bool:
+		packed->Value = UNZIGZAG(fields[0]);
+		packed->Max = 1;
+		packed->Step = 1;
+		break;
+	default:
+		if (in >= end)
+			return -1;
+		packed->Value = UNZIGZAG(fields[0]);
+		packed->Min = UNZIGZAG(fields[1]);
+		packed->Max = (uint32_t) packed->Min + fields[2];
+		packed->Step = UNZIGZAG(fields[3]);
+		packed->Decimal = *in++;
+		break;
+	}
+	return in - data;
+}
 
-#ifdef LEVCAN_TRACE
-				if (sizefail)
-				trace_printf("Parameter RX size fail\n");
+uint8_t* putVarint(uint8_t* out, uint32_t value) {
+	while (value >= 0x80) {
+		*out++ = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+	*out++ = value;
+	return out;
+}
+
+/// @return Position after number or 0 if it is truncated or too long
+const uint8_t* getVarint(const uint8_t* data, const uint8_t* end, uint32_t* value) {
+	*value = 0;
+	for (int shift = 0; shift < 35; shift += 7) {
+		if (data >= end)
+			return 0;
+		uint8_t byte = *data++;
+		*value |= (uint32_t) (byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			return data;
+	}
+	return 0;
+}
+
+LC_Return_t sendBulk(const bufferedReply_t* reply) {
+#ifdef LEVCAN_MEM_STATIC
+	static uint32_t static_bulk[LEVCAN_PARAM_BULK_SIZE / 4] = { 0 };
 #endif
-			}
+	LC_NodeDescription_t* node = reply->Node;
+	LC_ParameterDirectory_t* directory = 0;
+	uint16_t dirsize = 0, count = 0;
+	if (reply->Directory < node->DirectoriesSize) {
+		directory = &((LC_ParameterDirectory_t*) node->Directories)[reply->Directory];
+		dirsize = directory->Size;
+	}
+	uint8_t compact = (reply->Opcode == LC_PX_CompactRequest);
+	uint8_t numbers[PX_COMPACT_MAX];
+	parameterValuePacked_t packed;
+	//count records that fit in one answer
+	int32_t totalsize = sizeof(bulkAnswerPacked_t);
+	int32_t namelength, formatlength;
+	for (; count < reply->Count && reply->Index + count < dirsize; count++) {
+		int32_t record = sizeof(int32_t);
+		if (reply->Full)
+			record = bulkRecordSize(&directory->Address[reply->Index + count], &namelength, &formatlength);
+		if (compact) {
+			packParameter(&packed, &directory->Address[reply->Index + count], reply->Directory, reply->Index + count, dirsize);
+			record += compactEncode(numbers, &packed) - (int32_t) sizeof(parameterValuePacked_t);
 		}
+		if (totalsize + record > LEVCAN_PARAM_BULK_SIZE)
+			break;
+		totalsize += record;
 	}
+	//values may change until written, longer varint goes to slack or next part
+	if (compact)
+		totalsize = totalsize + 4 < LEVCAN_PARAM_BULK_SIZE ? totalsize + 4 : LEVCAN_PARAM_BULK_SIZE;
+#ifdef LEVCAN_MEM_STATIC
+	uint8_t* answer = (uint8_t*) static_bulk;
+#else
+	uint8_t* answer = lcmalloc(totalsize);
+	if (answer == 0)
+		return LC_MallocFail;
 #endif
-		break;
+	bulkAnswerPacked_t* head = (bulkAnswerPacked_t*) answer;
+	head->Opcode = compact ? LC_PX_Compact : (reply->Full ? LC_PX_Full : LC_PX_Values);
+	head->Directory = reply->Directory;
+	head->First = reply->Index;
+	head->Count = count;
+	head->DirectorySize = dirsize;
+	head->Capabilities = PX_CAP_COMPACT;
+	//records back to back, receiver copies them out
+	int32_t position = sizeof(bulkAnswerPacked_t);
+	for (uint16_t i = 0; i < count; i++) {
+		uint16_t pdindex = reply->Index + i;
+		const LC_ParameterAdress_t* parameter = &directory->Address[pdindex];
+		if (reply->Full) {
+			int32_t record = bulkRecordSize(parameter, &namelength, &formatlength);
+			int32_t numsize = sizeof(parameterValuePacked_t);
+			packParameter(&packed, parameter, reply->Directory, pdindex, dirsize);
+			if (compact) {
+				numsize = compactEncode(numbers, &packed);
+				record += numsize - (int32_t) sizeof(parameterValuePacked_t);
+				if (position + record > totalsize) {
+					head->Count = i;
+					break;
+				}
+				memcpy(&answer[position], numbers, numsize);
+			} else
+				memcpy(&answer[position], &packed, sizeof(parameterValuePacked_t));
+			char* literals = (char*) &answer[position + numsize];
+			if (namelength)
+				memcpy(literals, extractName(parameter), namelength);
+			literals[namelength] = 0;
+			if (formatlength)
+				memcpy(&literals[namelength + 1], parameter->Formatting, formatlength);
+			literals[namelength + 1 + formatlength] = 0;
+			position += record;
+		} else {
+			int32_t value = 0;
+			if ((parameter->ParamType & ~PT_readonly) != PT_dir && (parameter->ParamType & ~PT_readonly) != PT_func)
+				value = LC_GetParameterValue(parameter);
+			memcpy(&answer[position], &value, sizeof(int32_t));
+			position += sizeof(int32_t);
+		}
 	}
-	//get new now
-	receive_busy = 0;
-	proceed_RX();
-	return; // nothing to do so here
+	LC_ObjectRecord_t txrec = { 0 };
+	txrec.Attributes.Priority = LC_Priority_Low;
+	txrec.Attributes.TCP = reply->TCP;
+	txrec.NodeID = reply->Target;
+	txrec.Address = answer;
+	txrec.Size = position;
+#ifndef LEVCAN_MEM_STATIC
+	txrec.Attributes.Cleanup = 1;
+#endif
+	LC_Return_t state = LC_SendMessage(node, &txrec, LC_SYS_ParametersEx);
+#ifndef LEVCAN_MEM_STATIC
+	if (state)
+		lcfree(answer);
+#endif
+	return state;
 }
 
-/// Returns and prints local parameters information
+LC_Return_t sendTags(const bufferedReply_t* reply) {
+#ifdef LEVCAN_MEM_STATIC
+	static uint32_t static_tags[LEVCAN_PARAM_BULK_SIZE / 4] = { 0 };
+#endif
+	LC_NodeDescription_t* node = reply->Node;
+	uint16_t count = 0;
+	int32_t totalsize = sizeof(bulkAnswerPacked_t);
+	for (; count < reply->Count && reply->Index + count < node->DirectoriesSize; count++) {
+		if (totalsize + 8 > LEVCAN_PARAM_BULK_SIZE)
+			break;
+		totalsize += 8;
+	}
+#ifdef LEVCAN_MEM_STATIC
+	uint32_t* answer = static_tags;
+#else
+	uint32_t* answer = lcmalloc(totalsize);
+	if (answer == 0)
+		return LC_MallocFail;
+#endif
+	bulkAnswerPacked_t* head = (bulkAnswerPacked_t*) answer;
+	head->Opcode = LC_PX_Tags;
+	head->Directory = 0;
+	head->First = reply->Index;
+	head->Count = count;
+	head->DirectorySize = node->DirectoriesSize;
+	head->Capabilities = PX_CAP_COMPACT;
+	uint32_t* tag = &answer[sizeof(bulkAnswerPacked_t) / 4];
+	for (uint16_t i = 0; i < count; i++) {
+		LC_ParameterTag_t dirtag = LC_ParameterDirectoryTag(node, reply->Index + i);
+		*tag++ = dirtag.Descriptor;
+		*tag++ = dirtag.Values;
+	}
+	LC_ObjectRecord_t txrec = { 0 };
+	txrec.Attributes.Priority = LC_Priority_Low;
+	txrec.Attributes.TCP = reply->TCP;
+	txrec.NodeID = reply->Target;
+	txrec.Address = answer;
+	txrec.Size = totalsize;
+#ifndef LEVCAN_MEM_STATIC
+	txrec.Attributes.Cleanup = 1;
+#endif
+	LC_Return_t state = LC_SendMessage(node, &txrec, LC_SYS_ParametersEx);
+#ifndef LEVCAN_MEM_STATIC
+	if (state)
+		lcfree(answer);
+#endif
+	return state;
+}
+
+void proceed_TX(void) {
+	//one pass in arrival order, busy answers go back to queue end
+	uint16_t count = (replyFIFO_in - replyFIFO_out + LEVCAN_PARAM_REPLY_SIZE) % LEVCAN_PARAM_REPLY_SIZE;
+	for (; count > 0; count--) {
+		bufferedReply_t reply = reply_buffer[replyFIFO_out];
+		replyFIFO_out = (replyFIFO_out + 1) % LEVCAN_PARAM_REPLY_SIZE;
+		LC_Return_t state = sendReply(&reply);
+		if (state == LC_Collision || state == LC_BufferFull || state == LC_MallocFail) {
+			reply_buffer[replyFIFO_in] = reply;
+			replyFIFO_in = (replyFIFO_in + 1) % LEVCAN_PARAM_REPLY_SIZE;
+		}
+	}
+}
+
+/// Returns and prints local parameters information
 LC_ParameterTableSize_t LC_ParamInfo_Size(void* vnode) {
 	LC_NodeDescription_t* node = vnode;
 	int32_t size = 0;
@@ -423,23 +1128,75 @@ LC_Return_t LC_ParameterSet(LC_ParameterValue_t* paramv, uint16_t dir, void* sen
 	return LC_SendMessage(sender_node, &record, LC_SYS_Parameters);
 }
 
+/// Sends many values in one transfer. Node checks all of them and sets them together with interrupts
+/// disabled, or sets nothing if any value is rejected. Lost request or answer is repeated by LC_NetworkManager
+/// @param batch Setup Items and Count, up to LEVCAN_PARAM_BATCH_SIZE. Pending is cleared with answer
+/// @param sender_node Sender node
+/// @param receiver_node Receiver ID node
+LC_Return_t LC_ParameterSetBatch(LC_ParameterBatch_t* batch, void* sender_node, uint16_t receiver_node) {
+	if (batch == 0 || batch->Items == 0 || batch->Count == 0 || batch->Count > LEVCAN_PARAM_BATCH_SIZE)
+		return LC_DataError;
+	bufferedBulk_t* bulk = 0;
+	for (int i = 0; i < LEVCAN_PARAM_BULK_QUEUE; i++) {
+		if (bulk_buffer[i].Array == batch)
+			return LC_Collision;
+		if (bulk == 0 && bulk_buffer[i].Array == 0)
+			bulk = &bulk_buffer[i];
+	}
+	if (bulk == 0)
+		return LC_BufferFull;
+	*bulk = (bufferedBulk_t ) { 0 };
+	bulk->Node = sender_node;
+	bulk->Size = batch->Count;
+	bulk->Source = receiver_node;
+	bulk->Opcode = LC_PX_SetBatch;
+	bulk->Next = batch_sequence++;
+	batch->Pending = 1;
+	batch->Applied = 0;
+	batch->Result = LC_Ok;
+	memset(batch->Rejected, 0, sizeof(batch->Rejected));
+	bulk->Array = batch;
+	proceed_RX();
+
+	return LC_Ok;
+}
+
 /// Asynchroniously updates parameter. Setup index and directory to get one.
 /// @param paramv Pointer to parameter, where it will be stored. Setup LC_ParameterValue_t.Index here
 /// @param dir Directory index
 /// @param sender_node Sender node, who is asking for
 /// @param receiver_node Receiver ID node
 /// @param full	0 - request just value, 1 - request full parameter information.
+/// @return LC_Collision if paramv already waits for other parameter or node. Request flags are cleared
+/// when node answers, or with LC_ParameterValue_t.Result = LC_Timeout after LEVCAN_PARAM_RETRIES
 LC_Return_t LC_ParameterUpdateAsync(LC_ParameterValue_t* paramv, uint16_t dir, void* sender_node, uint16_t receiver_node, uint8_t full) {
 	//todo reentrancy
-	if (receiveFIFO_in == ((receiveFIFO_out - 1 + LEVCAN_PARAM_QUEUE_SIZE) % LEVCAN_PARAM_QUEUE_SIZE))
+	bufferedParam_t* receive = 0;
+	for (int i = 0; i < LEVCAN_PARAM_QUEUE_SIZE; i++) {
+		if (receive_buffer[i].Param == paramv) {
+			if (receive_buffer[i].Directory != dir || receive_buffer[i].Source != receiver_node || receive_buffer[i].Node != sender_node)
+				return LC_Collision;
+			//already waiting, just upgrade request
+			if (full && receive_buffer[i].Full == 0) {
+				receive_buffer[i].Full = 1;
+				receive_buffer[i].Sent = 0;
+				paramv->ParamType |= PT_noinit;
+			}
+			return LC_Ok;
+		}
+		if (receive == 0 && receive_buffer[i].Param == 0)
+			receive = &receive_buffer[i];
+	}
+	if (receive == 0)
 		return LC_BufferFull;
 
-	bufferedParam_t* receive = &receive_buffer[receiveFIFO_in];
-	receive->Param = paramv;
 	receive->Directory = dir;
 	receive->Source = receiver_node;
 	receive->Full = full;
 	receive->Node = sender_node;
+	receive->Order = receive_order++;
+	receive->Sent = 0;
+	receive->Retries = 0;
 
 	if (paramv->ParamType == PT_invalid)
 		paramv->ParamType = 0;
@@ -449,9 +1206,9 @@ LC_Return_t LC_ParameterUpdateAsync(LC_ParameterValue_t* paramv, uint16_t dir, v
 	} else {
 		paramv->ParamType |= PT_reqval;
 	}
-	receiveFIFO_in = (receiveFIFO_in + 1) % LEVCAN_PARAM_QUEUE_SIZE;
-	if (receive_busy == 0)
-		proceed_RX();
+	paramv->Result = LC_Ok;
+	receive->Param = paramv;
+	proceed_RX();
 
 	return LC_Ok;
 }
@@ -463,34 +1220,709 @@ void LC_ParametersStopUpdating(void) {
 	for (int i = 0; i < LEVCAN_PARAM_QUEUE_SIZE; i++) {
 		receive_buffer[i] = (bufferedParam_t ) { 0 };
 	}
-	receiveFIFO_in = 0;
-	receiveFIFO_out = 0;
-	receive_busy = 0;
+	for (int i = 0; i < LEVCAN_PARAM_BULK_QUEUE; i++) {
+		bulk_buffer[i] = (bufferedBulk_t ) { 0 };
+	}
+}
+
+#ifdef LEVCAN_PARAM_SUBSCRIBE
+/// Subscribes to value changes of parameter range. Server sends all values first, then changed ones
+/// collected for LEVCAN_PARAM_NOTIFY_INTERVAL. Subscription is renewed by LC_NetworkManager,
+/// so server forgets client that left, restarted server gets subscription again
+/// @param params Optional array, element index is parameter index in directory. Value is updated on change
+/// @param size Array size
+/// @param dir Directory index
+/// @param first First parameter index
+/// @param count Parameters count, server limits it to LEVCAN_PARAM_SUBSCRIBE_SIZE
+/// @param sender_node Sender node, who is asking for
+/// @param receiver_node Receiver ID node
+/// @return LC_BufferFull if all LEVCAN_PARAM_SUBSCRIPTIONS are used
+LC_Return_t LC_ParameterSubscribe(LC_ParameterValue_t* params, uint16_t size, uint16_t dir, uint16_t first, uint16_t count, void* sender_node,
+		uint16_t receiver_node) {
+	if (count == 0 || dir > UINT8_MAX || first > UINT8_MAX)
+		return LC_DataError;
+	if (first + count > UINT8_MAX)
+		count = UINT8_MAX - first;
+	bufferedWatch_t* watch = 0;
+	for (int i = 0; i < LEVCAN_PARAM_SUBSCRIPTIONS; i++) {
+		bufferedWatch_t* other = &watch_buffer[i];
+		if (other->Node && other->Source == receiver_node && other->Directory == dir && other->First == first && other->Count == count)
+			return LC_Collision;
+		if (watch == 0 && other->Node == 0)
+			watch = other;
+	}
+	if (watch == 0)
+		return LC_BufferFull;
+	*watch = (bufferedWatch_t ) { 0 };
+	watch->Array = params;
+	watch->Size = params ? size : 0;
+	watch->Source = receiver_node;
+	watch->Directory = dir;
+	watch->First = first;
+	watch->Count = count;
+	watch->Renew = 1;
+	watch->Node = sender_node;
+	renewWatches(0);
+
+	return LC_Ok;
+}
+
+/// Removes subscription made with LC_ParameterSubscribe
+/// @param dir Directory index
+/// @param first First parameter index
+/// @param count Parameters count, same as subscribed
+/// @param sender_node Sender node
+/// @param receiver_node Receiver ID node
+LC_Return_t LC_ParameterUnsubscribe(uint16_t dir, uint16_t first, uint16_t count, void* sender_node, uint16_t receiver_node) {
+	if (first + count > UINT8_MAX)
+		count = UINT8_MAX - first;
+	for (int i = 0; i < LEVCAN_PARAM_SUBSCRIPTIONS; i++) {
+		bufferedWatch_t* watch = &watch_buffer[i];
+		if (watch->Node && watch->Source == receiver_node && watch->Directory == dir && watch->First == first && watch->Count == count)
+			watch->Node = 0;
+	}
+	bulkRequestPacked_t request = { LC_PX_Unsubscribe, dir, first, count };
+	LC_ObjectRecord_t record = { 0 };
+	record.Address = &request;
+	record.Attributes.Priority = LC_Priority_Low;
+	record.NodeID = receiver_node;
+	record.Size = sizeof(bulkRequestPacked_t);
+	//lost request is not repeated, server lease expires anyway
+	return LC_SendMessage(sender_node, &record, LC_SYS_ParametersEx);
+}
+
+void subscribe(LC_NodeDescription_t* node, uint16_t target, const bulkRequestPacked_t* request) {
+	if (request->Directory >= node->DirectoriesSize)
+		return;
+	uint16_t dirsize = ((LC_ParameterDirectory_t*) node->Directories)[request->Directory].Size;
+	uint16_t count = request->Count;
+	if (request->First >= dirsize)
+		return;
+	if (count > dirsize - request->First)
+		count = dirsize - request->First;
+	if (count > LEVCAN_PARAM_SUBSCRIBE_SIZE)
+		count = LEVCAN_PARAM_SUBSCRIBE_SIZE;
+	bufferedSubscription_t* slot = 0;
+	for (int i = 0; i < LEVCAN_PARAM_SUBSCRIPTIONS; i++) {
+		bufferedSubscription_t* subscription = &subscription_buffer[i];
+		if (subscription->Node == node && subscription->Target == target && subscription->Directory == request->Directory
+				&& subscription->First == request->First && subscription->Count == count) {
+			//renew, whole range goes again. Changes are UDP, lost one is repaired by next renew
+			subscription->Lease = 0;
+			subscription->Fresh = 1;
+			return;
+		}
+		if (slot == 0 && subscription->Node == 0)
+			slot = subscription;
+	}
+	//no place, client repeats request with every renew
+	if (slot == 0)
+		return;
+	*slot = (bufferedSubscription_t ) { 0 };
+	slot->Target = target;
+	slot->Directory = request->Directory;
+	slot->First = request->First;
+	slot->Count = count;
+	slot->Fresh = 1;
+	slot->Node = node;
+}
+
+void unsubscribe(LC_NodeDescription_t* node, uint16_t target, const bulkRequestPacked_t* request) {
+	for (int i = 0; i < LEVCAN_PARAM_SUBSCRIPTIONS; i++) {
+		bufferedSubscription_t* subscription = &subscription_buffer[i];
+		//count may be limited by server
+		if (subscription->Node == node && subscription->Target == target && subscription->Directory == request->Directory
+				&& subscription->First == request->First && subscription->Count <= request->Count)
+			subscription->Node = 0;
+	}
+}
+
+/// Drops expired subscriptions, sends changes collected for LEVCAN_PARAM_NOTIFY_INTERVAL
+void notifyChanges(uint32_t time) {
+	for (int i = 0; i < LEVCAN_PARAM_SUBSCRIPTIONS; i++) {
+		bufferedSubscription_t* subscription = &subscription_buffer[i];
+		if (subscription->Node == 0)
+			continue;
+		if (subscription->Lease + time >= LEVCAN_PARAM_SUBSCRIBE_LEASE)
+			subscription->Node = 0;
+		else
+			subscription->Lease += time;
+	}
+	if (notify_time + time < LEVCAN_PARAM_NOTIFY_INTERVAL) {
+		notify_time += time;
+		return;
+	}
+	notify_time = 0;
+	//one message for all subscriptions of client
+	uint8_t sent[LEVCAN_PARAM_SUBSCRIPTIONS] = { 0 };
+	for (int i = 0; i < LEVCAN_PARAM_SUBSCRIPTIONS; i++) {
+		bufferedSubscription_t* subscription = &subscription_buffer[i];
+		if (subscription->Node == 0 || sent[i])
+			continue;
+		for (int k = i; k < LEVCAN_PARAM_SUBSCRIPTIONS; k++)
+			if (subscription_buffer[k].Node == subscription->Node && subscription_buffer[k].Target == subscription->Target)
+				sent[k] = 1;
+		sendChanges(subscription->Node, subscription->Target);
+	}
+}
+
+LC_Return_t sendChanges(void* node, uint16_t target) {
+#ifdef LEVCAN_MEM_STATIC
+	static uint8_t static_changes[LEVCAN_PARAM_BULK_SIZE] = { 0 };
+#endif
+	const int32_t record = 6; //directory, index, value
+	int32_t maxcount = (LEVCAN_PARAM_BULK_SIZE - 2) / record;
+	if (maxcount > UINT8_MAX)
+		maxcount = UINT8_MAX;
+	//count first, message has exact size
+	int32_t count = 0;
+	for (int i = 0; i < LEVCAN_PARAM_SUBSCRIPTIONS; i++) {
+		bufferedSubscription_t* subscription = &subscription_buffer[i];
+		if (subscription->Node != node || subscription->Target != target)
+			continue;
+		const LC_ParameterDirectory_t* directory = &((LC_ParameterDirectory_t*) ((LC_NodeDescription_t*) node)->Directories)[subscription->Directory];
+		for (uint16_t p = 0; p < subscription->Count; p++) {
+			const LC_ParameterAdress_t* parameter = &directory->Address[subscription->First + p];
+			if ((parameter->ParamType & ~PT_readonly) == PT_dir || (parameter->ParamType & ~PT_readonly) == PT_func)
+				continue;
+			if (subscription->Fresh || LC_GetParameterValue(parameter) != subscription->Shadow[p])
+				count++;
+		}
+	}
+	if (count == 0)
+		return LC_Ok;
+	if (count > maxcount)
+		count = maxcount; //rest goes with next message
+	int32_t totalsize = 2 + count * record;
+#ifdef LEVCAN_MEM_STATIC
+	uint8_t* message = static_changes;
+#else
+	uint8_t* message = lcmalloc(totalsize);
+	if (message == 0)
+		return LC_MallocFail;
+#endif
+	message[0] = LC_PX_Changes;
+	int32_t position = 2;
+	for (int i = 0; i < LEVCAN_PARAM_SUBSCRIPTIONS && position < totalsize; i++) {
+		bufferedSubscription_t* subscription = &subscription_buffer[i];
+		if (subscription->Node != node || subscription->Target != target)
+			continue;
+		const LC_ParameterDirectory_t* directory = &((LC_ParameterDirectory_t*) ((LC_NodeDescription_t*) node)->Directories)[subscription->Directory];
+		uint16_t p = 0;
+		for (; p < subscription->Count && position < totalsize; p++) {
+			const LC_ParameterAdress_t* parameter = &directory->Address[subscription->First + p];
+			if ((parameter->ParamType & ~PT_readonly) == PT_dir || (parameter->ParamType & ~PT_readonly) == PT_func)
+				continue;
+			int32_t value = LC_GetParameterValue(parameter);
+			if (subscription->Fresh == 0 && value == subscription->Shadow[p])
+				continue;
+			subscription->Shadow[p] = value;
+			message[position] = subscription->Directory;
+			message[position + 1] = subscription->First + p;
+			memcpy(&message[position + 2], &value, sizeof(int32_t));
+			position += record;
+		}
+		//whole range sent
+		if (p == subscription->Count)
+			subscription->Fresh = 0;
+	}
+	//value may return to its shadow after counting, send only records written
+	if (position == 2) {
+#ifndef LEVCAN_MEM_STATIC
+		lcfree(message);
+#endif
+		return LC_Ok;
+	}
+	message[1] = (position - 2) / record;
+	LC_ObjectRecord_t txrec = { 0 };
+	txrec.Attributes.Priority = LC_Priority_Low;
+	txrec.NodeID = target;
+	txrec.Address = message;
+	txrec.Size = position;
+#ifndef LEVCAN_MEM_STATIC
+	txrec.Attributes.Cleanup = 1;
+#endif
+	LC_Return_t state = LC_SendMessage(node, &txrec, LC_SYS_ParametersEx);
+	if (state) {
+#ifndef LEVCAN_MEM_STATIC
+		lcfree(message);
+#endif
+		//shadows are updated already, send everything again
+		for (int i = 0; i < LEVCAN_PARAM_SUBSCRIPTIONS; i++)
+			if (subscription_buffer[i].Node == node && subscription_buffer[i].Target == target)
+				subscription_buffer[i].Fresh = 1;
+	}
+	return state;
+}
+
+void receiveChanges(uint16_t source, const uint8_t* data, int32_t size) {
+	if (size < 2)
+		return;
+	uint8_t count = data[1];
+	if (size < 2 + count * 6)
+		return;
+	for (uint16_t c = 0; c < count; c++) {
+		const uint8_t* change = &data[2 + c * 6];
+		uint8_t dir = change[0], index = change[1];
+		int32_t value;
+		memcpy(&value, &change[2], sizeof(int32_t));
+		uint8_t known = 0;
+		for (int i = 0; i < LEVCAN_PARAM_SUBSCRIPTIONS; i++) {
+			bufferedWatch_t* watch = &watch_buffer[i];
+			if (watch->Node == 0 || watch->Source != source || watch->Directory != dir || index < watch->First || index >= watch->First + watch->Count)
+				continue;
+			known = 1;
+			if (index < watch->Size)
+				watch->Array[index].Value = value;
+		}
+		if (known)
+			LC_ParameterOnChange(source, dir, index, value);
+	}
+}
+
+/// Sends new subscriptions and renews old ones
+void renewWatches(uint32_t time) {
+	for (int i = 0; i < LEVCAN_PARAM_SUBSCRIPTIONS; i++) {
+		bufferedWatch_t* watch = &watch_buffer[i];
+		if (watch->Node == 0)
+			continue;
+		if (watch->Time + time >= LEVCAN_PARAM_SUBSCRIBE_LEASE / 3)
+			watch->Renew = 1;
+		else
+			watch->Time += time;
+		if (watch->Renew == 0)
+			continue;
+		bulkRequestPacked_t request = { LC_PX_Subscribe, watch->Directory, watch->First, watch->Count };
+		LC_ObjectRecord_t record = { 0 };
+		record.Address = &request;
+		record.Attributes.Priority = LC_Priority_Low;
+		record.NodeID = watch->Source;
+		record.Size = sizeof(bulkRequestPacked_t);
+		//lost request is repeated with next renew
+		if (LC_SendMessage(watch->Node, &record, LC_SYS_ParametersEx) == 0) {
+			watch->Renew = 0;
+			watch->Time = 0;
+		}
+	}
+}
+
+void lc_param_onchange(uint16_t source, uint16_t dir, uint16_t index, int32_t value) {
+	//make your own LC_ParameterOnChange to update screen
+}
+#endif
+
+void applyBatch(LC_NodeDescription_t* node, LC_Header_t header, const uint8_t* data, int32_t size) {
+#ifdef LEVCAN_MEM_STATIC
+	static uint8_t static_result[sizeof(batch_last.Answer)];
+#endif
+	if (size < 4)
+		return;
+	uint8_t sequence = data[1], count = data[2];
+	if (count > LEVCAN_PARAM_BATCH_SIZE || size < 4 + count * 6)
+		return;
+	uint32_t hash = hashBytes(2166136261u, data, 4 + count * 6);
+	if (batch_last.Source != header.Source || batch_last.Sequence != sequence || batch_last.Hash != hash) {
+		uint8_t* answer = batch_last.Answer;
+		uint8_t bitmap = (count + 7) / 8;
+		memset(answer, 0, 4 + bitmap);
+		answer[0] = LC_PX_SetResult;
+		answer[1] = sequence;
+		answer[2] = count;
+		uint8_t rejected = 0;
+		for (uint16_t i = 0; i < count; i++) {
+			const uint8_t* item = &data[4 + i * 6];
+			int32_t value;
+			memcpy(&value, &item[2], sizeof(int32_t));
+			if (checkSetItem(node, item[0], item[1], value)) {
+				answer[4 + i / 8] |= 1 << (i % 8);
+				rejected = 1;
+			}
+		}
+		if (rejected == 0) {
+			//nobody sees half of new values
+			lc_disable_irq();
+			for (uint16_t i = 0; i < count; i++) {
+				const uint8_t* item = &data[4 + i * 6];
+				int32_t value;
+				memcpy(&value, &item[2], sizeof(int32_t));
+				LC_SetParameterValue(&((LC_ParameterDirectory_t*) node->Directories)[item[0]].Address[item[1]], value);
+			}
+			lc_enable_irq();
+			answer[3] = 1;
+		}
+		batch_last.Source = header.Source;
+		batch_last.Sequence = sequence;
+		batch_last.Hash = hash;
+		batch_last.Size = 4 + bitmap;
+	}
+	//answer in request mode, lost one makes client repeat request
+	LC_ObjectRecord_t txrec = { 0 };
+	txrec.Attributes.Priority = LC_Priority_Low;
+	txrec.Attributes.TCP = header.Parity;
+	txrec.NodeID = header.Source;
+	txrec.Size = batch_last.Size;
+	if (txrec.Size <= 8 && txrec.Attributes.TCP == 0) {
+		//single frame is sent at once
+		txrec.Address = batch_last.Answer;
+		LC_SendMessage(node, &txrec, LC_SYS_ParametersEx);
+		return;
+	}
+#ifdef LEVCAN_MEM_STATIC
+	uint8_t* answer = static_result;
+#else
+	uint8_t* answer = lcmalloc(txrec.Size);
+	if (answer == 0)
+		return;
+	txrec.Attributes.Cleanup = 1;
+#endif
+	memcpy(answer, batch_last.Answer, txrec.Size);
+	txrec.Address = answer;
+	if (LC_SendMessage(node, &txrec, LC_SYS_ParametersEx)) {
+#ifndef LEVCAN_MEM_STATIC
+		lcfree(answer);
+#endif
+	}
+}
+
+/// Same checks as LC_SetParameterValue, also directory entry and function can not be set
+/// @return 1 if value is rejected
+uint8_t checkSetItem(LC_NodeDescription_t* node, uint8_t dir, uint8_t index, int32_t value) {
+	if (dir >= node->DirectoriesSize || index >= ((LC_ParameterDirectory_t*) node->Directories)[dir].Size)
+		return 1;
+	const LC_ParameterAdress_t* parameter = &((LC_ParameterDirectory_t*) node->Directories)[dir].Address[index];
+	LC_ParamType_t type = parameter->ParamType & ~PT_readonly;
+	if (type == PT_dir || type == PT_func || (parameter->ParamType & PT_readonly))
+		return 1;
+	if (value > parameter->Max || value < parameter->Min)
+		return 1;
+	if ((uintptr_t) parameter->Address <= UINT8_MAX || check_align(parameter))
+		return 1;
+	return 0;
+}
+
+LC_Return_t sendBatch(bufferedBulk_t* bulk) {
+#ifdef LEVCAN_MEM_STATIC
+	static uint8_t static_batch[4 + LEVCAN_PARAM_BATCH_SIZE * 6];
+#endif
+	const LC_ParameterBatch_t* batch = bulk->Array;
+	int32_t totalsize = 4 + bulk->Size * 6;
+#ifdef LEVCAN_MEM_STATIC
+	uint8_t* request = static_batch;
+#else
+	uint8_t* request = lcmalloc(totalsize);
+	if (request == 0)
+		return LC_MallocFail;
+#endif
+	request[0] = LC_PX_SetBatch;
+	request[1] = bulk->Next; //sequence
+	request[2] = bulk->Size;
+	request[3] = 0;
+	for (uint16_t i = 0; i < bulk->Size; i++) {
+		uint8_t* item = &request[4 + i * 6];
+		item[0] = batch->Items[i].Directory;
+		item[1] = batch->Items[i].Index;
+		memcpy(&item[2], &batch->Items[i].Value, sizeof(int32_t));
+	}
+	LC_ObjectRecord_t record = { 0 };
+	record.Address = request;
+	//UDP at bus speed, answer confirms it
+	record.Attributes.TCP = 0;
+	record.Attributes.Priority = LC_Priority_Low;
+	record.NodeID = bulk->Source;
+	record.Size = totalsize;
+#ifndef LEVCAN_MEM_STATIC
+	record.Attributes.Cleanup = 1;
+#endif
+	LC_Return_t state = LC_SendMessage(bulk->Node, &record, LC_SYS_ParametersEx);
+#ifndef LEVCAN_MEM_STATIC
+	if (state)
+		lcfree(request);
+#endif
+	return state;
+}
+
+void receiveBatchResult(uint16_t source, const uint8_t* data, int32_t size) {
+	if (size < 4)
+		return;
+	bufferedBulk_t* bulk = findBulk(source, LC_PX_SetBatch, 0, data[1]);
+	if (bulk == 0 || data[2] != bulk->Size || size < 4 + (data[2] + 7) / 8)
+		return;
+	LC_ParameterBatch_t* batch = bulk->Array;
+	memcpy(batch->Rejected, &data[4], (data[2] + 7) / 8);
+	batch->Applied = data[3];
+	batch->Result = LC_Ok;
+	batch->Pending = 0;
+	bulk->Array = 0;
+}
+
+/// Asynchroniously gets change tags of node directories, compare them with tags of last sync
+/// and load only changed directories with LC_ParameterDirectoryAsync
+/// @param tags Array, element index is directory index. Pending is cleared on receive, past node directories get zero tags.
+/// Node without LC_SYS_ParametersEx does not answer: Pending is cleared with Result = LC_Timeout, load it without tags
+/// @param size Array size
+/// @param sender_node Sender node, who is asking for
+/// @param receiver_node Receiver ID node
+LC_Return_t LC_ParameterTagsAsync(LC_ParameterTag_t* tags, uint16_t size, void* sender_node, uint16_t receiver_node) {
+	//todo reentrancy
+	if (tags == 0 || size == 0)
+		return LC_DataError;
+	bufferedBulk_t* bulk = 0;
+	for (int i = 0; i < LEVCAN_PARAM_BULK_QUEUE; i++) {
+		if (bulk_buffer[i].Array == tags)
+			return LC_Collision;
+		if (bulk == 0 && bulk_buffer[i].Array == 0)
+			bulk = &bulk_buffer[i];
+	}
+	if (bulk == 0)
+		return LC_BufferFull;
+	*bulk = (bufferedBulk_t ) { 0 };
+	bulk->Node = sender_node;
+	bulk->Size = size;
+	bulk->Source = receiver_node;
+	bulk->Opcode = LC_PX_TagsRequest;
+	for (uint16_t i = 0; i < size; i++) {
+		tags[i].Pending = 1;
+		tags[i].Result = LC_Ok;
+	}
+	bulk->Array = tags;
+	proceed_RX();
+
+	return LC_Ok;
+}
+
+/// Returns change tags of own node directory
+/// @param node Own node
+/// @param dir Directory index
+LC_ParameterTag_t LC_ParameterDirectoryTag(const LC_NodeDescription_t* node, uint16_t dir) {
+	LC_ParameterTag_t tag = { 0 };
+	if (dir >= node->DirectoriesSize)
+		return tag;
+	const LC_ParameterDirectory_t* directory = &((LC_ParameterDirectory_t*) node->Directories)[dir];
+	//FNV-1a
+	uint32_t descriptor = 2166136261u, values = 2166136261u;
+	descriptor = hashBytes(descriptor, &directory->Size, sizeof(directory->Size));
+	for (uint16_t i = 0; i < directory->Size; i++) {
+		const LC_ParameterAdress_t* parameter = &directory->Address[i];
+		descriptor = hashBytes(descriptor, &parameter->Min, sizeof(parameter->Min));
+		descriptor = hashBytes(descriptor, &parameter->Max, sizeof(parameter->Max));
+		descriptor = hashBytes(descriptor, &parameter->Step, sizeof(parameter->Step));
+		descriptor = hashBytes(descriptor, &parameter->Decimal, sizeof(parameter->Decimal));
+		uint8_t types[2] = { parameter->ValueType, parameter->ParamType };
+		descriptor = hashBytes(descriptor, types, sizeof(types));
+		//strings with terminator, missing string differs from empty one
+		const char* name = extractName(parameter);
+		if (name)
+			descriptor = hashBytes(descriptor, name, strlen(name) + 1);
+		if (parameter->Formatting)
+			descriptor = hashBytes(descriptor, parameter->Formatting, strlen(parameter->Formatting) + 1);
+		descriptor = hashBytes(descriptor, "\xFF", 1);
+		if ((parameter->ParamType & ~PT_readonly) != PT_dir && (parameter->ParamType & ~PT_readonly) != PT_func) {
+			int32_t value = LC_GetParameterValue(parameter);
+			values = hashBytes(values, &value, sizeof(value));
+		}
+	}
+	tag.Descriptor = descriptor;
+	tag.Values = values;
+	return tag;
+}
+
+uint32_t hashBytes(uint32_t hash, const void* data, int32_t size) {
+	const uint8_t* bytes = data;
+	for (int32_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/// Asynchroniously updates whole directory with one transfer, long directory is received in parts.
+/// Parameters are marked as with LC_ParameterUpdateAsync, array elements past directory end get PT_invalid.
+/// Node without LC_SYS_ParametersEx does not answer: flags are cleared with LC_ParameterValue_t.Result = LC_Timeout
+/// @param params Array, element index is parameter index in directory
+/// @param size Array size
+/// @param dir Directory index
+/// @param sender_node Sender node, who is asking for
+/// @param receiver_node Receiver ID node
+/// @param full	0 - request just values, 1 - request full parameter information.
+LC_Return_t LC_ParameterDirectoryAsync(LC_ParameterValue_t* params, uint16_t size, uint16_t dir, void* sender_node, uint16_t receiver_node, uint8_t full) {
+	//todo reentrancy
+	if (params == 0 || size == 0)
+		return LC_DataError;
+	bufferedBulk_t* bulk = 0;
+	for (int i = 0; i < LEVCAN_PARAM_BULK_QUEUE; i++) {
+		if (bulk_buffer[i].Array == params)
+			return LC_Collision;
+		if (bulk == 0 && bulk_buffer[i].Array == 0)
+			bulk = &bulk_buffer[i];
+	}
+	if (bulk == 0)
+		return LC_BufferFull;
+	*bulk = (bufferedBulk_t ) { 0 };
+	bulk->Node = sender_node;
+	bulk->Size = size;
+	bulk->Directory = dir;
+	bulk->Source = receiver_node;
+	bulk->Opcode = full ? LC_PX_FullRequest : LC_PX_ValuesRequest;
+	for (uint16_t i = 0; i < size; i++) {
+		params[i].Index = i;
+		if (params[i].ParamType == PT_invalid)
+			params[i].ParamType = 0;
+		if (full) {
+			params[i].ParamType |= PT_noinit;
+		} else {
+			params[i].ParamType |= PT_reqval;
+		}
+		params[i].Result = LC_Ok;
+	}
+	bulk->Array = params;
+	proceed_RX();
+
+	return LC_Ok;
+}
+
+/// Repeats lost requests and sends answers delayed by busy transmitter. Called by LC_NetworkManager
+/// @param time Time passed since last call in ms
+void lc_paramManager(uint32_t time) {
+	for (int i = 0; i < LEVCAN_PARAM_QUEUE_SIZE; i++) {
+		bufferedParam_t* receive = &receive_buffer[i];
+		if (receive->Param == 0 || receive->Sent == 0)
+			continue;
+		if (receive->Time + time < LEVCAN_PARAM_TIMEOUT) {
+			receive->Time += time;
+			continue;
+		}
+		//node id may be taken by older node, one request at time until it answers in request mode
+		learnWindow(receive->Source, 0);
+		//no answer, request again or give up
+		if (receive->Retries < LEVCAN_PARAM_RETRIES) {
+			receive->Retries++;
+			receive->Sent = 0;
+		} else {
+			receive->Param->ParamType &= ~(PT_noinit | PT_reqval);
+			receive->Param->Result = LC_Timeout;
+			receive->Param = 0;
+		}
+	}
+	for (int i = 0; i < LEVCAN_PARAM_BULK_QUEUE; i++) {
+		bufferedBulk_t* bulk = &bulk_buffer[i];
+		if (bulk->Array == 0 || bulk->Sent == 0)
+			continue;
+		if (bulk->Time + time < LEVCAN_PARAM_BULK_TIMEOUT) {
+			bulk->Time += time;
+			continue;
+		}
+		//node id may be taken by older node, ask plain records again
+		if (bulk->Source < LC_Null_Address)
+			compact_nodes[bulk->Source / 8] &= ~(1 << (bulk->Source % 8));
+		if (bulk->Retries < LEVCAN_PARAM_RETRIES) {
+			bulk->Retries++;
+			bulk->Sent = 0;
+		} else {
+			if (bulk->Opcode == LC_PX_SetBatch) {
+				LC_ParameterBatch_t* batch = bulk->Array;
+				batch->Result = LC_Timeout;
+				batch->Pending = 0;
+			} else if (bulk->Opcode == LC_PX_FullRequest || bulk->Opcode == LC_PX_ValuesRequest) {
+				//parameters not received yet
+				LC_ParameterValue_t* params = bulk->Array;
+				for (uint16_t p = bulk->Next; p < bulk->Size; p++) {
+					params[p].ParamType &= ~(PT_noinit | PT_reqval);
+					params[p].Result = LC_Timeout;
+				}
+			} else if (bulk->Opcode == LC_PX_TagsRequest) {
+				LC_ParameterTag_t* tags = bulk->Array;
+				for (uint16_t t = bulk->Next; t < bulk->Size; t++) {
+					tags[t].Pending = 0;
+					tags[t].Result = LC_Timeout;
+				}
+			}
+			bulk->Array = 0;
+		}
+	}
+#ifdef LEVCAN_PARAM_SUBSCRIBE
+	notifyChanges(time);
+	renewWatches(time);
+#endif
+	proceed_TX();
+	proceed_RX();
 }
 
 void proceed_RX(void) {
-	if (receiveFIFO_in != receiveFIFO_out) {
-		//receive_buffer[receiveFIFO_out]
+	//directory requests, one transfer per node
+	for (int i = 0; i < LEVCAN_PARAM_BULK_QUEUE; i++) {
+		bufferedBulk_t* bulk = &bulk_buffer[i];
+		if (bulk->Array == 0 || bulk->Sent)
+			continue;
+		int busy = 0;
+		for (int k = 0; k < LEVCAN_PARAM_BULK_QUEUE; k++)
+			if (bulk_buffer[k].Array != 0 && bulk_buffer[k].Sent && bulk_buffer[k].Source == bulk->Source)
+				busy = 1;
+		if (busy)
+			continue;
+		if (bulk->Opcode == LC_PX_SetBatch) {
+			if (sendBatch(bulk) == 0) {
+				bulk->Sent = 1;
+				bulk->Time = 0;
+			}
+			continue;
+		}
+		bulkRequestPacked_t request;
+		request.Opcode = bulk->Opcode;
+		if (bulk->Opcode == LC_PX_FullRequest && bulk->Source < LC_Null_Address && (compact_nodes[bulk->Source / 8] & (1 << (bulk->Source % 8))))
+			request.Opcode = LC_PX_CompactRequest;
+		request.Directory = bulk->Directory;
+		request.First = bulk->Next;
+		request.Count = (bulk->Size - bulk->Next > UINT8_MAX) ? UINT8_MAX : bulk->Size - bulk->Next;
+
+		LC_ObjectRecord_t record = { 0 };
+		record.Address = &request;
+		//single frame, UDP answer comes at bus speed, lost one is requested again
+		record.Attributes.TCP = 0;
+		record.Attributes.Priority = LC_Priority_Low;
+		record.NodeID = bulk->Source;
+		record.Size = sizeof(bulkRequestPacked_t);
+		if (LC_SendMessage(bulk->Node, &record, LC_SYS_ParametersEx) == 0) {
+			bulk->Sent = 1;
+			bulk->Time = 0;
+		}
+	}
+	//send oldest waiting requests while target node window allows
+	for (;;) {
+		bufferedParam_t* next = 0;
+		for (int i = 0; i < LEVCAN_PARAM_QUEUE_SIZE; i++) {
+			bufferedParam_t* receive = &receive_buffer[i];
+			if (receive->Param == 0 || receive->Sent)
+				continue;
+			if (next && (uint16_t) (receive_order - receive->Order) <= (uint16_t) (receive_order - next->Order))
+				continue;
+			if (countSent(receive->Source) < windowSize(receive->Source))
+				next = receive;
+		}
+		if (next == 0)
+			return;
 
 		uint8_t data[3] = { 0 };
-		data[0] = receive_buffer[receiveFIFO_out].Param->Index;
-		data[1] = receive_buffer[receiveFIFO_out].Directory;
+		data[0] = next->Param->Index;
+		data[1] = next->Directory;
 		data[2] = 0;
 
 		LC_ObjectRecord_t record = { 0 };
 		record.Address = &data;
-		record.Attributes.TCP = 1;
+		//single frame without transfer object, many requests to one node can be on the bus
+		record.Attributes.TCP = 0;
 		record.Attributes.Priority = LC_Priority_Low;
-		record.NodeID = receive_buffer[receiveFIFO_out].Source;
+		record.NodeID = next->Source;
 
-		if (receive_buffer[receiveFIFO_out].Full) {
+		if (next->Full) {
 			record.Size = 2;
 		} else {
 			record.Size = 3;
 		}
-		//get next buffer index. sent in short mode
-		if (LC_SendMessage(receive_buffer[receiveFIFO_out].Node, &record, LC_SYS_Parameters) == 0)
-			receive_busy = 1;
+		//tx queue full or node offline, manager will try again
+		if (LC_SendMessage(next->Node, &record, LC_SYS_Parameters))
+			return;
+		next->Sent = 1;
+		next->Time = 0;
 	}
 }
 
@@ -509,72 +1941,128 @@ const LC_ParameterAdress_t* LC_GetParameterAdress(const LC_NodeDescription_t* no
 
 const char* equality = " = ";
 
+/// Prints parameter line to buffer, see LC_WriteParam
+/// @param buffer Should fit longest line, LC_WriteParam with writer is bounded
+/// @param parameter
 void LC_PrintParam(char* buffer, const LC_ParameterAdress_t* parameter) {
 	if (buffer == 0)
 		return;
-	//for string this enough
-	buffer[0] = 0;
-	switch (parameter->ParamType & PT_typeMask) {
-	case PT_dir: {
-		strcat(buffer, "\n[");
-		strcat(buffer, extractName(parameter));
-		strcat(buffer, "]\n");
-	}
-		break;
-	case PT_enum: {
-		strcpy(buffer, parameter->Name);
-		strcat(buffer, equality);
-
-		int32_t val = LC_GetParameterValue(parameter);
+	LC_ParamWriter_t writer = { .Data = buffer, .Size = UINT16_MAX };
+	LC_WriteParam(&writer, parameter);
+	buffer[writer.Used] = 0;
+}
 
-		const char *position = parameter->Formatting;
-		for (int i = 0; (i < val); i++) {
-			position = strchr(position, '\n'); //look for buffer specified by val index
-			if (position == 0)
-				break;
-			position++; //skip '\n'
+/// Writes parameter as config line in one pass over its strings, directory entry as "[name]" header.
+/// Read only values are commented out, strings and other types are not written
+/// @param writer Output buffer, flushed when full
+/// @param parameter
+void LC_WriteParam(LC_ParamWriter_t* writer, const LC_ParameterAdress_t* parameter) {
+	if (writer == 0 || parameter == 0)
+		return;
+	uint8_t type = parameter->ParamType & PT_typeMask;
+	if (type == PT_dir) {
+		writeText(writer, "\n[", 0);
+		writeText(writer, extractName(parameter), 0);
+		writeText(writer, "]\n", 0);
+		return;
+	}
+	if (type != PT_enum && type != PT_value && type != PT_bool)
+		return;
+	int32_t val = LC_GetParameterValue(parameter);
+	if (parameter->ParamType & PT_readonly)
+		writeText(writer, "# ", 0);
+	writeText(writer, parameter->Name, 0);
+	writeText(writer, equality, 0);
+	if (type == PT_bool)
+		writeText(writer, val ? "ON" : "OFF", 0);
+	else if (type == PT_enum) {
+		//look for line specified by val index
+		const char* position = val >= 0 ? parameter->Formatting : 0;
+		for (int32_t i = 0; position && i < val; i++) {
+			position = strchr(position, '\n');
+			if (position)
+				position++; //skip '\n'
 		}
-		if (position == 0) {
-			sprintf(buffer + strlen(buffer), "%ld", val);
-		} else {
-			char* end = strchr(position, '\n'); //search for buffer end
-			if (end) {
-				strncat(buffer, position, end - position);
-			} else
-				strcat(buffer, position);	//end is possible zero
+		if (position)
+			writeText(writer, position, '\n');
+		else
+			writeNumber(writer, val, 0);
+	} else
+		writeNumber(writer, val, parameter->Decimal);
+	writeText(writer, "\n", 0);
+}
+
+/// Writes config of all own node directories in format LC_ParseParameterLine reads, one pass through
+/// writer buffer. Read only directories are runtime variables and not written. Rest is flushed at the end
+/// @param vnode Own node
+/// @param writer Output buffer
+void LC_ParametersWrite(void* vnode, LC_ParamWriter_t* writer) {
+	LC_NodeDescription_t* node = vnode;
+	if (node == 0 || writer == 0)
+		return;
+	writeText(writer, "# ", 0);
+	writeText(writer, node->DeviceName, 0);
+	writeText(writer, "\n", 0);
+	for (int dir = 0; dir < node->DirectoriesSize && writer->Result == 0; dir++) {
+		const LC_ParameterDirectory_t* directory = &((LC_ParameterDirectory_t*) node->Directories)[dir];
+		if (directory->Size == 0 || (directory->Address[0].ParamType & PT_readonly))
+			continue;
+		for (int i = 0; i < directory->Size; i++) {
+			const LC_ParameterAdress_t* param = &directory->Address[i];
+			//other directories entry
+			if ((param->ParamType & PT_typeMask) == PT_dir && i != 0)
+				continue;
+			LC_WriteParam(writer, param);
 		}
-		strcat(buffer, "\n");
 	}
-		break;
+	if (writer->Used && writer->Flush)
+		writerFlush(writer);
+}
 
-	case PT_value: {
-		int32_t val = LC_GetParameterValue(parameter);
-		strcpy(buffer, parameter->Name);
-		strcat(buffer, equality);
-		if (parameter->Decimal) {
-			uint32_t powww = pow10i(parameter->Decimal);
-			sprintf(buffer + strlen(buffer), "%ld.%ld", val / powww, val % powww);
-		} else
-			sprintf(buffer + strlen(buffer), "%ld", val);
-		strcat(buffer, "\n");
+/// Copies text till terminator or stop char, full buffer is flushed
+void writeText(LC_ParamWriter_t* writer, const char* text, char stop) {
+	if (text == 0)
+		return;
+	for (; *text && *text != stop; text++) {
+		if (writer->Used == writer->Size && writerFlush(writer))
+			return;
+		writer->Data[writer->Used++] = *text;
 	}
-		break;
+}
 
-	case PT_bool: {
-		int32_t val = LC_GetParameterValue(parameter);
-		strcpy(buffer, parameter->Name);
-		strcat(buffer, equality);
-		if (val)
-			strcat(buffer, "ON\n");
-		else
-			strcat(buffer, "OFF\n");
-	}
-		break;
-	default:
-		break;
-	}
+/// Writes fixed point value, 105 with 2 decimals is "1.05", -5 is "-0.05"
+void writeNumber(LC_ParamWriter_t* writer, int32_t value, uint8_t decimal) {
+	char digits[24];
+	char* position = &digits[sizeof(digits) - 1];
+	*position = 0;
+	if (decimal > 16)
+		decimal = 16;
+	uint32_t magnitude = value < 0 ? 0u - (uint32_t) value : (uint32_t) value;
+	uint8_t count = 0;
+	do {
+		if (count && count == decimal)
+			*--position = '.';
+		*--position = '0' + magnitude % 10;
+		magnitude /= 10;
+		count++;
+	} while (magnitude || count <= decimal);
+	if (value < 0)
+		*--position = '-';
+	writeText(writer, position, 0);
+}
 
-	return;
+/// Sends full buffer, returns 1 if writer can't take more
+uint8_t writerFlush(LC_ParamWriter_t* writer) {
+	if (writer->Result == 0) {
+		if (writer->Flush == 0)
+			writer->Result = 1; //fixed buffer full
+		else {
+			writer->Result = writer->Flush(writer);
+			if (writer->Result == 0)
+				writer->Used = 0;
+		}
+	}
+	return writer->Result != 0;
 }
 
 /// Tryes to get value for specified parameter with string value
@@ -621,17 +2109,22 @@ int LC_GetParameterValueFromStr(const LC_ParameterAdress_t* parameter, const cha
 	}
 	if (type != PT_string && type != PT_func && type != PT_dir) {
 		//other types failed? try integer type, anywhere supported
-		integer = strtol(s, 0, 0);
+		char* end;
+		integer = strtol(s, &end, 0);
 		if (integer == INT32_MAX)
 			return 1;
-		char *decStr = memchr(s, '.', length);
-		if (decStr != NULL) {
-#ifdef LEVCAN_USE_FLOAT
-			float temp = atoff(s);
-			integer = temp * pow10i(parameter->Decimal);
-#endif
-		} else
-			integer *= pow10i(parameter->Decimal);
+		integer *= pow10i(parameter->Decimal);
+		if (*end == '.' && end < s + length) {
+			//fixed point digits, extra ones are cut off
+			int32_t fraction = 0;
+			end++;
+			for (int d = 0; d < parameter->Decimal; d++) {
+				fraction *= 10;
+				if (isdigit((unsigned char) *end))
+					fraction += *end++ - '0';
+			}
+			integer += *s == '-' ? -fraction : fraction;
+		}
 		*value = integer;
 		return 0;
 
@@ -645,9 +2138,14 @@ int16_t LC_IsDirectory(LC_NodeDescription_t* node, const char* s) {
 	//remove space ending
 	for (; searchlen > 0 && isblank(s[searchlen - 1]); searchlen--)
 		;
+#ifdef LEVCAN_PARAM_NAME_INDEX
+	int32_t found = nameLookup(node, NAME_DIRECTORY, s, searchlen);
+	if (found >= -1)
+		return found;
+#endif
 	for (uint16_t i = 0; i < node->DirectoriesSize; i++) {
 		const LC_ParameterAdress_t* directory = &((LC_ParameterDirectory_t*) node->Directories)[i].Address[0];
-		if (directory->Name && strncmp(directory->Name, s, searchlen) == 0) {
+		if (nameEquals(directory->Name, s, searchlen)) {
 			return i;
 		}
 	}
@@ -660,11 +2158,16 @@ int16_t LC_IsParameter(LC_NodeDescription_t* node, const char* s, uint8_t direct
 	//remove space ending
 	for (; searchlen > 0 && isblank(s[searchlen - 1]); searchlen--)
 		;
+#ifdef LEVCAN_PARAM_NAME_INDEX
+	int32_t found = nameLookup(node, directory, s, searchlen);
+	if (found >= -1)
+		return found;
+#endif
 	for (uint16_t i = 1; i < ((LC_ParameterDirectory_t*) node->Directories)[directory].Size; i++) {
 		//todo carefully check types
 		const LC_ParameterAdress_t* param = &((LC_ParameterDirectory_t*) node->Directories)[directory].Address[i];
 		//other directories entry don't have name in the pointer, so they will be skipped
-		if (param->Name && (strncmp(param->Name, s, searchlen) == 0)) {
+		if (nameEquals(param->Name, s, searchlen)) {
 			return i;
 		}
 	}
@@ -744,6 +2247,272 @@ const char* LC_ParseParameterLine(LC_NodeDescription_t* node, const char* input,
 	return line + strcspn(line, "\n\r");
 }
 
+#ifdef LEVCAN_FILECLIENT
+/// Reads config file from file server and sets recognized values of own node. File goes through
+/// LEVCAN_PARAM_IMPORT_SIZE buffer, next part is requested before complete lines of current one are parsed.
+/// Values are checked and set by LEVCAN_PARAM_IMPORT_BATCH with interrupts disabled, wrong ones are skipped.
+/// Values before read error stay set
+/// @param name File name
+/// @param sender_node Own node, its parameters are set
+/// @param server_node Server id, can be LC_Broadcast_Address to find first one
+/// @param result Optional line counters
+/// @return LC_FileResult_t
+LC_FileResult_t LC_ParameterImport(char* name, void* sender_node, uint8_t server_node, LC_ParameterImport_t* result) {
+#ifdef LEVCAN_MEM_STATIC
+	static char static_import[LEVCAN_PARAM_IMPORT_SIZE];
+#endif
+	LC_ParameterImport_t counters = { 0 };
+	LC_ParameterSetItem_t items[LEVCAN_PARAM_IMPORT_BATCH];
+	uint16_t count = 0;
+	LC_FileResult_t state = LC_FileOpen(name, LC_FA_Read | LC_FA_OpenExisting, sender_node, server_node);
+	if (state != LC_FR_Ok)
+		return state;
+#ifdef LEVCAN_MEM_STATIC
+	char* buffer = static_import;
+#else
+	char* buffer = lcmalloc(LEVCAN_PARAM_IMPORT_SIZE);
+	if (buffer == 0) {
+		LC_FileClose(sender_node, 0);
+		return LC_FR_MemoryFull;
+	}
+#endif
+	int16_t dir = -1;
+	uint32_t used = 0; //unparsed bytes at buffer start
+	uint8_t skip = 0; //dropping line longer than buffer
+	for (;;) {
+		//one byte is left for terminator of last line
+		uint32_t space = LEVCAN_PARAM_IMPORT_SIZE - 1 - used;
+		if (space == 0 && memchr(buffer, '\n', used) == 0) {
+			//line does not fit, drop it
+			used = 0;
+			space = LEVCAN_PARAM_IMPORT_SIZE - 1;
+			skip = 1;
+		}
+		if (space) {
+			state = LC_FileReadAhead(&buffer[used], space, sender_node);
+			if (state != LC_FR_Ok)
+				break;
+		}
+		//complete lines before requested part
+		uint32_t position = 0;
+		char* newline;
+		while ((newline = memchr(&buffer[position], '\n', used - position)) != 0) {
+			*newline = 0;
+			if (skip) {
+				skip = 0;
+				counters.Lines++;
+				counters.Rejected++;
+			} else
+				importLine(sender_node, &buffer[position], &dir, items, &count, &counters);
+			position = newline - buffer + 1;
+		}
+		uint32_t received = 0;
+		if (space) {
+			state = LC_FileReadWait(&received, sender_node);
+			if (state != LC_FR_Ok)
+				break;
+		}
+		//unfinished line and new part go to buffer start
+		used = used - position + received;
+		memmove(buffer, &buffer[position], used);
+		if (space && received == 0) {
+			//file end, last line without new line
+			if (used || skip) {
+				buffer[used] = 0;
+				if (skip) {
+					counters.Lines++;
+					counters.Rejected++;
+				} else
+					importLine(sender_node, buffer, &dir, items, &count, &counters);
+			}
+			break;
+		}
+	}
+	if (count)
+		importApply(sender_node, items, count, &counters);
+	LC_FileClose(sender_node, 0);
+#ifndef LEVCAN_MEM_STATIC
+	lcfree(buffer);
+#endif
+	if (result)
+		*result = counters;
+	return state;
+}
+
+/// Writes own node config to file server, file is created or truncated. Lines go through
+/// LEVCAN_PARAM_EXPORT_SIZE buffer, LC_ParameterImport reads file back
+/// @param name File name
+/// @param sender_node Own node, its parameters are written
+/// @param server_node Server id, can be LC_Broadcast_Address to find first one
+/// @return LC_FileResult_t
+LC_FileResult_t LC_ParameterExport(char* name, void* sender_node, uint8_t server_node) {
+	char buffer[LEVCAN_PARAM_EXPORT_SIZE];
+	LC_FileResult_t result = LC_FileOpen(name, LC_FA_Write | LC_FA_CreateAlways, sender_node, server_node);
+	if (result != LC_FR_Ok)
+		return result;
+	LC_ParamWriter_t writer = { .Data = buffer, .Size = sizeof(buffer), .Flush = exportFlush, .Context = sender_node };
+	LC_ParametersWrite(sender_node, &writer);
+	result = LC_FileClose(sender_node, 0);
+	return writer.Result != LC_FR_Ok ? (LC_FileResult_t) writer.Result : result;
+}
+
+void importLine(LC_NodeDescription_t* node, const char* line, int16_t* dir, LC_ParameterSetItem_t* items, uint16_t* count, LC_ParameterImport_t* counters) {
+	int16_t index = -1;
+	int32_t value = 0;
+	counters->Lines++;
+	LC_ParseParameterLine(node, line, dir, &index, &value);
+	if (index > 0 && index <= UINT8_MAX && *dir <= UINT8_MAX) {
+		items[*count] = (LC_ParameterSetItem_t ) { .Value = value, .Directory = *dir, .Index = index };
+		(*count)++;
+		if (*count == LEVCAN_PARAM_IMPORT_BATCH) {
+			importApply(node, items, *count, counters);
+			*count = 0;
+		}
+		return;
+	}
+	//name = value, not recognized
+	const char* text = skipspaces(line);
+	if (*text != '#' && *text != '[' && text[strcspn(text, "#=")] == '=')
+		counters->Rejected++;
+}
+
+/// Same checks as batch from network, but wrong values are skipped and others are set
+void importApply(LC_NodeDescription_t* node, const LC_ParameterSetItem_t* items, uint16_t count, LC_ParameterImport_t* counters) {
+	uint8_t rejected[(LEVCAN_PARAM_IMPORT_BATCH + 7) / 8] = { 0 };
+	for (uint16_t i = 0; i < count; i++)
+		if (checkSetItem(node, items[i].Directory, items[i].Index, items[i].Value)) {
+			rejected[i / 8] |= 1 << (i % 8);
+			counters->Rejected++;
+		}
+	lc_disable_irq();
+	for (uint16_t i = 0; i < count; i++)
+		if ((rejected[i / 8] & (1 << (i % 8))) == 0) {
+			LC_SetParameterValue(&((LC_ParameterDirectory_t*) node->Directories)[items[i].Directory].Address[items[i].Index], items[i].Value);
+			counters->Applied++;
+		}
+	lc_enable_irq();
+}
+
+int32_t exportFlush(LC_ParamWriter_t* writer) {
+	uint32_t written = 0;
+	LC_FileResult_t result = LC_FileWrite(writer->Data, writer->Used, &written, writer->Context);
+	if (result == LC_FR_Ok && written != writer->Used)
+		result = LC_FR_Denied; //disk full
+	return result;
+}
+#endif
+
+/// Whole name equals to first length chars of s, prefix is not a match
+uint8_t nameEquals(const char* name, const char* s, int32_t length) {
+	return name && strncmp(name, s, length) == 0 && name[length] == 0;
+}
+
+#ifdef LEVCAN_PARAM_NAME_INDEX
+/// Returns name index of node, (re)builds it for new or changed directories table
+/// @param dir Directory to be searched, NAME_DIRECTORY checks whole table
+/// @return Index or 0 if there is no memory for it
+nameIndex_t* nameIndexGet(LC_NodeDescription_t* node, uint16_t dir) {
+#ifdef LEVCAN_MEM_STATIC
+	static uint32_t static_index[(sizeof(nameIndex_t) + LEVCAN_PARAM_NAME_INDEX_SIZE * sizeof(nameSlot_t) + 3) / 4];
+	static LC_ParameterDirectory_t static_layout[LEVCAN_PARAM_NAME_INDEX_SIZE / 8];
+#endif
+	nameIndex_t* index = node->NameIndex;
+	if (index && index->Owner == node && index->Directories == node->Directories && index->DirectoriesSize == node->DirectoriesSize
+			&& nameLayoutSame(index, node, dir))
+		return index;
+	LC_ParameterDirectory_t* directories = node->Directories;
+	uint32_t names = 0;
+	for (uint16_t d = 0; d < node->DirectoriesSize; d++)
+		for (uint16_t i = 0; i < directories[d].Size; i++)
+			if (directories[d].Address[i].Name)
+				names++;
+	//half empty, short probe chains
+	uint32_t slots = 8;
+	while (slots < names * 2)
+		slots <<= 1;
+#ifdef LEVCAN_MEM_STATIC
+	if (slots > LEVCAN_PARAM_NAME_INDEX_SIZE || node->DirectoriesSize > LEVCAN_PARAM_NAME_INDEX_SIZE / 8)
+		return 0;
+	index = (nameIndex_t*) static_index;
+	index->Layout = static_layout;
+#else
+	if (index)
+		lcfree(index);
+	node->NameIndex = 0;
+	if (slots > 0x10000)
+		return 0;
+	index = lcmalloc(sizeof(nameIndex_t) + slots * sizeof(nameSlot_t) + node->DirectoriesSize * sizeof(LC_ParameterDirectory_t));
+	if (index == 0)
+		return 0;
+	index->Layout = (LC_ParameterDirectory_t*) &index->Slots[slots];
+#endif
+	node->NameIndex = index;
+	index->Owner = node;
+	index->Directories = node->Directories;
+	index->DirectoriesSize = node->DirectoriesSize;
+	index->Mask = slots - 1;
+	memcpy(index->Layout, directories, node->DirectoriesSize * sizeof(LC_ParameterDirectory_t));
+	memset(index->Slots, 0xFF, slots * sizeof(nameSlot_t));
+	//equal names keep table order in probe chain, first one is found as by scan
+	for (uint16_t d = 0; d < node->DirectoriesSize; d++)
+		for (uint16_t i = 0; i < directories[d].Size; i++) {
+			const char* name = directories[d].Address[i].Name;
+			if (name == 0)
+				continue;
+			nameSlot_t entry = { d, i };
+			if (i == 0)
+				entry = (nameSlot_t ) { NAME_DIRECTORY, d };
+			uint32_t slot = nameKey(entry.Directory, name, strlen(name)) & index->Mask;
+			while (index->Slots[slot].Directory != NAME_EMPTY)
+				slot = (slot + 1) & index->Mask;
+			index->Slots[slot] = entry;
+		}
+	return index;
+}
+
+/// Compares searched directory with its copy, directory names are in every directory
+uint8_t nameLayoutSame(const nameIndex_t* index, const LC_NodeDescription_t* node, uint16_t dir) {
+	const LC_ParameterDirectory_t* directories = node->Directories;
+	uint16_t first = dir, last = dir;
+	if (dir == NAME_DIRECTORY) {
+		first = 0;
+		last = node->DirectoriesSize - 1;
+	}
+	for (uint16_t d = first; d <= last && d < node->DirectoriesSize; d++)
+		if (index->Layout[d].Address != directories[d].Address || index->Layout[d].Size != directories[d].Size)
+			return 0;
+	return 1;
+}
+
+/// Finds parameter index in directory, or directory index for NAME_DIRECTORY
+/// @return Index, -1 if there is no such name, -2 if there is no name index
+int32_t nameLookup(LC_NodeDescription_t* node, uint16_t dir, const char* s, int32_t length) {
+	nameIndex_t* index = nameIndexGet(node, dir);
+	if (index == 0)
+		return -2;
+	LC_ParameterDirectory_t* directories = node->Directories;
+	for (uint32_t slot = nameKey(dir, s, length) & index->Mask;; slot = (slot + 1) & index->Mask) {
+		nameSlot_t entry = index->Slots[slot];
+		if (entry.Directory == NAME_EMPTY)
+			return -1;
+		if (entry.Directory != dir)
+			continue;
+		if (dir == NAME_DIRECTORY) {
+			if (nameEquals(directories[entry.Index].Address[0].Name, s, length))
+				return entry.Index;
+		} else if (nameEquals(directories[dir].Address[entry.Index].Name, s, length))
+			return entry.Index;
+	}
+}
+
+uint32_t nameKey(uint16_t dir, const char* s, int32_t length) {
+	uint32_t hash = hashBytes(2166136261u, &dir, sizeof(dir));
+	hash = hashBytes(hash, s, length);
+	//FNV low bits are weak for short keys
+	return hash ^ (hash >> 16);
+}
+#endif
+
 #endif
 
 const char* skipspaces(const char* s) {
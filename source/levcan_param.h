@@ -10,6 +10,87 @@
 
 #pragma once
 
+//client requests waiting for answer
+#ifndef LEVCAN_PARAM_QUEUE_SIZE
+#define LEVCAN_PARAM_QUEUE_SIZE 5
+#endif
+//requests sent to one node without answer, 1 - one request per round trip. Node gets one until it answers in request mode
+#ifndef LEVCAN_PARAM_WINDOW
+#define LEVCAN_PARAM_WINDOW 4
+#endif
+//ms, request repeated after this time without answer
+#ifndef LEVCAN_PARAM_TIMEOUT
+#define LEVCAN_PARAM_TIMEOUT 300
+#endif
+#ifndef LEVCAN_PARAM_RETRIES
+#define LEVCAN_PARAM_RETRIES 2
+#endif
+//server answers waiting for transmitter
+#ifndef LEVCAN_PARAM_REPLY_SIZE
+#define LEVCAN_PARAM_REPLY_SIZE (LEVCAN_PARAM_WINDOW * 2 + 1)
+#endif
+//whole directory transfers waiting for answer
+#ifndef LEVCAN_PARAM_BULK_QUEUE
+#define LEVCAN_PARAM_BULK_QUEUE 2
+#endif
+//bytes, maximum directory answer size, longer directory is sent in parts. Minimum 160
+#ifndef LEVCAN_PARAM_BULK_SIZE
+#define LEVCAN_PARAM_BULK_SIZE 1024
+#endif
+//ms, directory request repeated after this time without answer
+#ifndef LEVCAN_PARAM_BULK_TIMEOUT
+#define LEVCAN_PARAM_BULK_TIMEOUT 1000
+#endif
+//parameters in one LC_ParameterSetBatch, up to 255. Static memory receives only LEVCAN_OBJECT_DATASIZE bytes
+#ifndef LEVCAN_PARAM_BATCH_SIZE
+#ifdef LEVCAN_MEM_STATIC
+#define LEVCAN_PARAM_BATCH_SIZE ((LEVCAN_OBJECT_DATASIZE - 4) / 6)
+#else
+#define LEVCAN_PARAM_BATCH_SIZE 128
+#endif
+#endif
+#if LEVCAN_PARAM_BATCH_SIZE > 255
+#error "LEVCAN_PARAM_BATCH_SIZE should be 255 or less"
+#endif
+#ifdef LEVCAN_PARAM_SUBSCRIBE
+//value change subscriptions kept by server, and by client
+#ifndef LEVCAN_PARAM_SUBSCRIPTIONS
+#define LEVCAN_PARAM_SUBSCRIPTIONS 4
+#endif
+//parameters in one subscription, server keeps last sent value of each
+#ifndef LEVCAN_PARAM_SUBSCRIBE_SIZE
+#define LEVCAN_PARAM_SUBSCRIBE_SIZE 32
+#endif
+//ms, server collects changes for this time and sends them in one message
+#ifndef LEVCAN_PARAM_NOTIFY_INTERVAL
+#define LEVCAN_PARAM_NOTIFY_INTERVAL 20
+#endif
+//ms, server drops subscription not renewed for this time, client renews 3 times per lease
+#ifndef LEVCAN_PARAM_SUBSCRIBE_LEASE
+#define LEVCAN_PARAM_SUBSCRIBE_LEASE 3000
+#endif
+#endif
+#if defined(LEVCAN_PARAMETERS_PARSING) && defined(LEVCAN_FILECLIENT)
+//LC_ParameterImport buffer: longest line, unparsed part and read-ahead message
+#ifndef LEVCAN_PARAM_IMPORT_SIZE
+#define LEVCAN_PARAM_IMPORT_SIZE 256
+#endif
+//LC_ParameterImport values checked and set together
+#ifndef LEVCAN_PARAM_IMPORT_BATCH
+#define LEVCAN_PARAM_IMPORT_BATCH 16
+#endif
+//LC_ParameterExport write buffer, filled lines go to file server when it is full
+#ifndef LEVCAN_PARAM_EXPORT_SIZE
+#define LEVCAN_PARAM_EXPORT_SIZE 128
+#endif
+#endif
+#if defined(LEVCAN_PARAM_NAME_INDEX) && defined(LEVCAN_MEM_STATIC)
+//name hash slots for static memory, power of two. Node with more than half names or SIZE / 8 directories is scanned
+#ifndef LEVCAN_PARAM_NAME_INDEX_SIZE
+#define LEVCAN_PARAM_NAME_INDEX_SIZE 256
+#endif
+#endif
+
 //parameter size type, used in slaves
 typedef enum {
 	VT_uint8, VT_int8, VT_uint16, VT_int16, VT_int32, VT_float, VT_unknown
@@ -49,6 +130,23 @@ typedef enum {
 	PT_invalid = 0xFF,	//ending
 } LC_ParamType_t;
 
+//LC_SYS_ParametersEx message type, first byte of every message
+typedef enum {
+	LC_PX_ValuesRequest, //directory, first index, count. Answered with LC_PX_Values
+	LC_PX_FullRequest, //directory, first index, count. Answered with LC_PX_Full
+	LC_PX_Values, //answer header and int32 value for every index, 0 for directories and functions
+	LC_PX_Full, //answer header and parameter records with name and formatting strings, back to back
+	LC_PX_TagsRequest, //first directory, count. Answered with LC_PX_Tags
+	LC_PX_Tags, //answer header and LC_ParameterTag_t hashes for every directory
+	LC_PX_Subscribe, //directory, first index, count. Repeated to renew, new subscription gets all values first
+	LC_PX_Unsubscribe, //directory, first index, count
+	LC_PX_Changes, //count and changed values: directory, index, int32 value (6 bytes each)
+	LC_PX_SetBatch, //sequence, count and values to set, same records as LC_PX_Changes. Answered with LC_PX_SetResult
+	LC_PX_SetResult, //sequence, count, applied flag and bitmap of rejected values
+	LC_PX_CompactRequest, //as LC_PX_FullRequest, sent to nodes with compact capability in answer header
+	LC_PX_Compact, //answer header and compact records: type, varint numbers used by this type, strings
+} LC_ParamOpcode_t;
+
 typedef struct {
 	void* Address;
 	int32_t Min;
@@ -74,6 +172,7 @@ typedef struct {
 	int32_t Step;
 	uint8_t Index;
 	uint8_t Decimal;
+	uint8_t Result; //LC_Return_t of last request: LC_Ok, or LC_Timeout if node did not answer
 	LC_ParamType_t ParamType;
 	char* Name;
 	char* Formatting;
@@ -101,6 +200,30 @@ typedef struct {
 	uint16_t Size;
 } LC_VariableDirectory_t;
 
+//directory change tags, client compares them with last sync and loads only changed directories
+typedef struct {
+	uint32_t Descriptor; //hash of names, formatting, limits and types, changes only with firmware
+	uint32_t Values; //hash of current values, values are not counted so direct writes are seen too
+	uint8_t Pending; //set while waiting for answer
+	uint8_t Result; //LC_Return_t: LC_Ok, or LC_Timeout if node did not answer
+} LC_ParameterTag_t;
+
+typedef struct {
+	int32_t Value;
+	uint8_t Directory;
+	uint8_t Index;
+} LC_ParameterSetItem_t;
+
+//values applied all together or none of them
+typedef struct {
+	const LC_ParameterSetItem_t* Items; //filled by user, kept until answer
+	uint16_t Count;
+	uint8_t Pending; //set while waiting for answer
+	uint8_t Applied; //all values set, otherwise nothing is changed
+	LC_Return_t Result; //LC_Ok - node answered, LC_Timeout - no answer
+	uint8_t Rejected[(LEVCAN_PARAM_BATCH_SIZE + 7) / 8]; //bit per item: out of limits, read only or missing parameter
+} LC_ParameterBatch_t;
+
 typedef struct {
 	int32_t Size;
 	int32_t Textsize;
@@ -112,14 +235,46 @@ typedef struct {
 
 LC_ParameterTableSize_t LC_ParamInfo_Size(void* vnode);
 LC_Return_t LC_ParameterSet(LC_ParameterValue_t* paramv, uint16_t dir, void* sender_node, uint16_t receiver_node);
+LC_Return_t LC_ParameterSetBatch(LC_ParameterBatch_t* batch, void* sender_node, uint16_t receiver_node);
 LC_Return_t LC_ParameterUpdateAsync(LC_ParameterValue_t* paramv, uint16_t dir, void* sender_node, uint16_t receiver_node, uint8_t full);
 void LC_ParametersStopUpdating(void);
+LC_Return_t LC_ParameterTagsAsync(LC_ParameterTag_t* tags, uint16_t size, void* sender_node, uint16_t receiver_node);
+LC_ParameterTag_t LC_ParameterDirectoryTag(const LC_NodeDescription_t* node, uint16_t dir);
+LC_Return_t LC_ParameterDirectoryAsync(LC_ParameterValue_t* params, uint16_t size, uint16_t dir, void* sender_node, uint16_t receiver_node, uint8_t full);
+#ifdef LEVCAN_PARAM_SUBSCRIBE
+LC_Return_t LC_ParameterSubscribe(LC_ParameterValue_t* params, uint16_t size, uint16_t dir, uint16_t first, uint16_t count, void* sender_node,
+		uint16_t receiver_node);
+LC_Return_t LC_ParameterUnsubscribe(uint16_t dir, uint16_t first, uint16_t count, void* sender_node, uint16_t receiver_node);
+//weak, called for every received change
+void LC_ParameterOnChange(uint16_t source, uint16_t dir, uint16_t index, int32_t value);
+#endif
 int32_t LC_GetParameterValue(const LC_ParameterAdress_t* parameter);
 int LC_SetParameterValue(const LC_ParameterAdress_t* parameter, int32_t value);
 const LC_ParameterAdress_t* LC_GetParameterAdress(const LC_NodeDescription_t* node, int16_t dir, int16_t index);
 //misc functions
+typedef struct LC_ParamWriter_t LC_ParamWriter_t;
+struct LC_ParamWriter_t {
+	char* Data;
+	uint16_t Size;
+	uint16_t Used;
+	int32_t Result; //0, first non zero Flush result, or 1 if buffer without Flush is full
+	int32_t (*Flush)(LC_ParamWriter_t* writer); //sends Used bytes, 0 if ok. Can be 0 for fixed buffer
+	void* Context;
+};
 const char* LC_ParseParameterLine(LC_NodeDescription_t* node, const char* input, int16_t* directory, int16_t* index, int32_t* value);
 void LC_PrintParam(char* buffer, const LC_ParameterAdress_t* parameter);
+void LC_WriteParam(LC_ParamWriter_t* writer, const LC_ParameterAdress_t* parameter);
+void LC_ParametersWrite(void* vnode, LC_ParamWriter_t* writer);
 int LC_GetParameterValueFromStr(const LC_ParameterAdress_t* parameter, const char* string, int32_t* value);
 int16_t LC_IsDirectory(LC_NodeDescription_t* node, const char* s);
 int16_t LC_IsParameter(LC_NodeDescription_t* node, const char* s, uint8_t directory);
+#if defined(LEVCAN_PARAMETERS_PARSING) && defined(LEVCAN_FILECLIENT)
+#include "levcan_fileclient.h"
+typedef struct {
+	uint32_t Lines;
+	uint32_t Applied; //values set
+	uint32_t Rejected; //assignments with unknown name, wrong value, out of limits or read only
+} LC_ParameterImport_t;
+LC_FileResult_t LC_ParameterImport(char* name, void* sender_node, uint8_t server_node, LC_ParameterImport_t* result);
+LC_FileResult_t LC_ParameterExport(char* name, void* sender_node, uint8_t server_node);
+#endif
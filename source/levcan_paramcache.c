@@ -0,0 +1,443 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, client parameter descriptor cache
+ * levcan_paramcache.c
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "levcan.h"
+#include "levcan_paramcache.h"
+
+//cache file: header, string table (zero terminated, back to back), directories with parameter records.
+//Numbers are in native byte order, file is read by same device
+#define CACHE_MAGIC 0x4350434C //"LCPC"
+#define CACHE_VERSION 1
+#define CACHE_NO_STRING 0xFFFF
+
+typedef struct internString_t {
+	struct internString_t* Next;
+	uint32_t Hash;
+	uint16_t Index; //string table index while saving
+	char Text[];
+} internString_t;
+
+typedef struct {
+	int32_t Min;
+	int32_t Max;
+	int32_t Step;
+	const char* Name;
+	const char* Formatting;
+	uint8_t Decimal;
+	uint8_t ParamType;
+} cacheParam_t;
+
+typedef struct cacheDirectory_t {
+	struct cacheDirectory_t* Next;
+	uint32_t Identity; //LC_NodeShortName_t.ToUint32[1]: device type, manufacturer, serial
+	uint32_t Descriptor;
+	uint16_t Directory;
+	uint16_t Size;
+	cacheParam_t Params[];
+} cacheDirectory_t;
+
+typedef struct {
+	uint32_t Magic;
+	uint16_t Version;
+	uint16_t Strings;
+	uint16_t Directories;
+	uint16_t Reserved;
+	uint32_t StringBytes;
+} cacheFileHeader_t;
+
+typedef struct {
+	uint32_t Identity;
+	uint32_t Descriptor;
+	uint16_t Directory;
+	uint16_t Size;
+} cacheFileDirectory_t;
+
+typedef struct {
+	int32_t Min;
+	int32_t Max;
+	int32_t Step;
+	uint16_t Name; //string table index or CACHE_NO_STRING
+	uint16_t Formatting;
+	uint8_t Decimal;
+	uint8_t ParamType;
+} LEVCAN_PACKED cacheFileParam_t;
+
+#ifdef LEVCAN_FILECLIENT
+typedef struct {
+	void* Node;
+	uint16_t Used;
+	LC_FileResult_t Result;
+	char Data[64];
+} cacheWriter_t;
+#endif
+
+//extern functions
+extern void *lcmalloc(uint32_t xWantedSize);
+extern void lcfree(void *pv);
+extern uint32_t hashBytes(uint32_t hash, const void* data, int32_t size);
+//private functions
+internString_t* internNode(const char* text);
+cacheDirectory_t** findCached(uint32_t identity, uint16_t dir);
+#ifdef LEVCAN_FILECLIENT
+uint16_t indexString(const char* text, uint16_t* next, uint32_t* bytes);
+void cacheWrite(cacheWriter_t* writer, const void* data, uint32_t size);
+void cacheFlush(cacheWriter_t* writer);
+LC_FileResult_t cacheParse(const char* data, uint32_t size);
+#endif
+//private variables
+internString_t* intern_pool[LEVCAN_PARAM_CACHE_BUCKETS];
+cacheDirectory_t* cache_start = 0;
+
+/// Returns pooled copy of string, equal strings share one copy. Pooled strings live until LC_ParamCacheClear
+/// @param string Text, does not need to be terminated if length given
+/// @param length Text length, -1 to use strlen
+/// @return Pooled string or 0 if string empty or no memory
+const char* LC_ParamCacheIntern(const char* string, int32_t length) {
+	if (string == 0)
+		return 0;
+	if (length < 0)
+		length = strlen(string);
+	if (length == 0)
+		return 0;
+	uint32_t hash = hashBytes(2166136261u, string, length);
+	internString_t** bucket = &intern_pool[hash % LEVCAN_PARAM_CACHE_BUCKETS];
+	for (internString_t* entry = *bucket; entry; entry = entry->Next)
+		if (entry->Hash == hash && strncmp(entry->Text, string, length) == 0 && entry->Text[length] == 0)
+			return entry->Text;
+	internString_t* entry = lcmalloc(sizeof(internString_t) + length + 1);
+	if (entry == 0)
+		return 0;
+	entry->Hash = hash;
+	entry->Index = CACHE_NO_STRING;
+	memcpy(entry->Text, string, length);
+	entry->Text[length] = 0;
+	entry->Next = *bucket;
+	*bucket = entry;
+	return entry->Text;
+}
+
+/// Saves descriptors of fully received directory (LC_ParameterDirectoryAsync with full=1).
+/// Names and formatting are pooled, older descriptors of same node directory are replaced
+/// @param node Server node short name from LC_GetNode, node id is not used
+/// @param dir Directory index
+/// @param descriptor LC_ParameterTag_t.Descriptor of this directory
+/// @param params Received directory, elements with PT_invalid end it
+/// @param size Array size
+/// @return LC_DataError if some parameter is not received yet
+LC_Return_t LC_ParamCacheStore(LC_NodeShortName_t node, uint16_t dir, uint32_t descriptor, const LC_ParameterValue_t* params, uint16_t size) {
+	if (params == 0)
+		return LC_DataError;
+	uint16_t count = 0;
+	for (; count < size && params[count].ParamType != PT_invalid; count++)
+		if (params[count].ParamType & PT_noinit)
+			return LC_DataError;
+	cacheDirectory_t* entry = lcmalloc(sizeof(cacheDirectory_t) + count * sizeof(cacheParam_t));
+	if (entry == 0)
+		return LC_MallocFail;
+	entry->Identity = node.ToUint32[1];
+	entry->Descriptor = descriptor;
+	entry->Directory = dir;
+	entry->Size = count;
+	for (uint16_t i = 0; i < count; i++) {
+		cacheParam_t* cached = &entry->Params[i];
+		cached->Min = params[i].Min;
+		cached->Max = params[i].Max;
+		cached->Step = params[i].Step;
+		cached->Decimal = params[i].Decimal;
+		cached->ParamType = params[i].ParamType & ~PT_reqval;
+		cached->Name = LC_ParamCacheIntern(params[i].Name, -1);
+		cached->Formatting = LC_ParamCacheIntern(params[i].Formatting, -1);
+	}
+	cacheDirectory_t** old = findCached(entry->Identity, dir);
+	if (*old) {
+		entry->Next = (*old)->Next;
+		lcfree(*old);
+	} else
+		entry->Next = 0;
+	*old = entry;
+
+	return LC_Ok;
+}
+
+/// Fills directory descriptors from cache, so only values have to be loaded (LC_ParameterDirectoryAsync with full=0).
+/// Name and Formatting point to pooled strings, do not free them
+/// @param node Server node short name from LC_GetNode
+/// @param dir Directory index
+/// @param descriptor LC_ParameterTag_t.Descriptor received from node
+/// @param params Array, element index is parameter index. Elements past directory end get PT_invalid
+/// @param size Array size
+/// @return LC_ObjectError if directory is not cached or descriptor changed
+LC_Return_t LC_ParamCacheApply(LC_NodeShortName_t node, uint16_t dir, uint32_t descriptor, LC_ParameterValue_t* params, uint16_t size) {
+	if (params == 0)
+		return LC_DataError;
+	cacheDirectory_t* entry = *findCached(node.ToUint32[1], dir);
+	if (entry == 0 || entry->Descriptor != descriptor)
+		return LC_ObjectError;
+	for (uint16_t i = 0; i < size; i++) {
+		LC_ParameterValue_t* param = &params[i];
+		param->Index = i;
+		if (i >= entry->Size) {
+			param->ParamType = PT_invalid;
+			continue;
+		}
+		const cacheParam_t* cached = &entry->Params[i];
+		param->Min = cached->Min;
+		param->Max = cached->Max;
+		param->Step = cached->Step;
+		param->Decimal = cached->Decimal;
+		param->ParamType = cached->ParamType;
+		param->Name = (char*) cached->Name;
+		param->Formatting = (char*) cached->Formatting;
+	}
+
+	return LC_Ok;
+}
+
+/// Frees cache and string pool. No LC_ParameterValue_t should use pooled strings after this
+void LC_ParamCacheClear(void) {
+	while (cache_start) {
+		cacheDirectory_t* next = cache_start->Next;
+		lcfree(cache_start);
+		cache_start = next;
+	}
+	for (int b = 0; b < LEVCAN_PARAM_CACHE_BUCKETS; b++)
+		while (intern_pool[b]) {
+			internString_t* next = intern_pool[b]->Next;
+			lcfree(intern_pool[b]);
+			intern_pool[b] = next;
+		}
+}
+
+LC_ParamCacheInfo_t LC_ParamCacheGetInfo(void) {
+	LC_ParamCacheInfo_t info = { 0 };
+	for (cacheDirectory_t* entry = cache_start; entry; entry = entry->Next) {
+		info.Directories++;
+		info.Parameters += entry->Size;
+		for (uint16_t i = 0; i < entry->Size; i++)
+			info.Referenced += (entry->Params[i].Name != 0) + (entry->Params[i].Formatting != 0);
+	}
+	for (int b = 0; b < LEVCAN_PARAM_CACHE_BUCKETS; b++)
+		for (internString_t* string = intern_pool[b]; string; string = string->Next) {
+			info.Strings++;
+			info.StringBytes += strlen(string->Text) + 1;
+		}
+	return info;
+}
+
+internString_t* internNode(const char* text) {
+	return (internString_t*) (text - offsetof(internString_t, Text));
+}
+
+cacheDirectory_t** findCached(uint32_t identity, uint16_t dir) {
+	cacheDirectory_t** entry = &cache_start;
+	for (; *entry; entry = &(*entry)->Next)
+		if ((*entry)->Identity == identity && (*entry)->Directory == dir)
+			break;
+	return entry;
+}
+
+#ifdef LEVCAN_FILECLIENT
+/// Writes whole cache to file, every string is written once
+/// @param name File name
+/// @param sender_node Own network node
+/// @param server_node File server id, can be LC_Broadcast_Address to find first one
+LC_FileResult_t LC_ParamCacheSave(char* name, void* sender_node, uint8_t server_node) {
+	cacheFileHeader_t header = { .Magic = CACHE_MAGIC, .Version = CACHE_VERSION };
+	for (int b = 0; b < LEVCAN_PARAM_CACHE_BUCKETS; b++)
+		for (internString_t* string = intern_pool[b]; string; string = string->Next)
+			string->Index = CACHE_NO_STRING;
+	//number strings in order of use
+	for (cacheDirectory_t* entry = cache_start; entry; entry = entry->Next) {
+		header.Directories++;
+		for (uint16_t i = 0; i < entry->Size; i++) {
+			indexString(entry->Params[i].Name, &header.Strings, &header.StringBytes);
+			indexString(entry->Params[i].Formatting, &header.Strings, &header.StringBytes);
+		}
+	}
+	if (header.Strings >= CACHE_NO_STRING)
+		return LC_FR_InvalidParameter;
+	LC_FileResult_t result = LC_FileOpen(name, LC_FA_Write | LC_FA_CreateAlways, sender_node, server_node);
+	if (result != LC_FR_Ok)
+		return result;
+	cacheWriter_t writer = { .Node = sender_node, .Result = LC_FR_Ok };
+	cacheWrite(&writer, &header, sizeof(header));
+	//strings in index order, same walk as numbering
+	uint16_t written = 0;
+	for (cacheDirectory_t* entry = cache_start; entry; entry = entry->Next)
+		for (uint16_t i = 0; i < entry->Size * 2; i++) {
+			const char* text = (i & 1) ? entry->Params[i / 2].Formatting : entry->Params[i / 2].Name;
+			if (text && internNode(text)->Index == written) {
+				cacheWrite(&writer, text, strlen(text) + 1);
+				written++;
+			}
+		}
+	for (cacheDirectory_t* entry = cache_start; entry; entry = entry->Next) {
+		cacheFileDirectory_t dir = { entry->Identity, entry->Descriptor, entry->Directory, entry->Size };
+		cacheWrite(&writer, &dir, sizeof(dir));
+		for (uint16_t i = 0; i < entry->Size; i++) {
+			const cacheParam_t* cached = &entry->Params[i];
+			cacheFileParam_t record;
+			record.Min = cached->Min;
+			record.Max = cached->Max;
+			record.Step = cached->Step;
+			record.Name = cached->Name ? internNode(cached->Name)->Index : CACHE_NO_STRING;
+			record.Formatting = cached->Formatting ? internNode(cached->Formatting)->Index : CACHE_NO_STRING;
+			record.Decimal = cached->Decimal;
+			record.ParamType = cached->ParamType;
+			cacheWrite(&writer, &record, sizeof(record));
+		}
+	}
+	cacheFlush(&writer);
+	result = LC_FileClose(sender_node, 0);
+	return writer.Result != LC_FR_Ok ? writer.Result : result;
+}
+
+/// Reads cache file, directories are added to cache or replace cached ones
+/// @param name File name
+/// @param sender_node Own network node
+/// @param server_node File server id, can be LC_Broadcast_Address to find first one
+/// @return LC_FR_InvalidObject if file is broken or from other version
+LC_FileResult_t LC_ParamCacheLoad(char* name, void* sender_node, uint8_t server_node) {
+	LC_FileResult_t result = LC_FileOpen(name, LC_FA_Read | LC_FA_OpenExisting, sender_node, server_node);
+	if (result != LC_FR_Ok)
+		return result;
+	uint32_t size = LC_FileSize(sender_node);
+	char* data = lcmalloc(size ? size : 1);
+	if (data == 0) {
+		LC_FileClose(sender_node, 0);
+		return LC_FR_MemoryFull;
+	}
+	uint32_t read = 0;
+	result = LC_FileRead(data, size, &read, sender_node);
+	LC_FileClose(sender_node, 0);
+	if (result == LC_FR_Ok)
+		result = (read == size) ? cacheParse(data, size) : LC_FR_InvalidObject;
+	lcfree(data);
+	return result;
+}
+
+uint16_t indexString(const char* text, uint16_t* next, uint32_t* bytes) {
+	if (text == 0)
+		return CACHE_NO_STRING;
+	internString_t* string = internNode(text);
+	if (string->Index == CACHE_NO_STRING && *next < CACHE_NO_STRING) {
+		string->Index = (*next)++;
+		*bytes += strlen(text) + 1;
+	}
+	return string->Index;
+}
+
+void cacheWrite(cacheWriter_t* writer, const void* data, uint32_t size) {
+	const char* bytes = data;
+	while (size) {
+		uint32_t part = sizeof(writer->Data) - writer->Used;
+		if (part > size)
+			part = size;
+		memcpy(&writer->Data[writer->Used], bytes, part);
+		writer->Used += part;
+		bytes += part;
+		size -= part;
+		if (writer->Used == sizeof(writer->Data))
+			cacheFlush(writer);
+	}
+}
+
+void cacheFlush(cacheWriter_t* writer) {
+	uint32_t written = 0;
+	if (writer->Used && writer->Result == LC_FR_Ok) {
+		writer->Result = LC_FileWrite(writer->Data, writer->Used, &written, writer->Node);
+		if (writer->Result == LC_FR_Ok && written != writer->Used)
+			writer->Result = LC_FR_Denied; //disk full
+	}
+	writer->Used = 0;
+}
+
+LC_FileResult_t cacheParse(const char* data, uint32_t size) {
+	cacheFileHeader_t header;
+	if (size < sizeof(header))
+		return LC_FR_InvalidObject;
+	memcpy(&header, data, sizeof(header));
+	if (header.Magic != CACHE_MAGIC || header.Version != CACHE_VERSION || header.StringBytes > size - sizeof(header))
+		return LC_FR_InvalidObject;
+	const char** strings = lcmalloc((header.Strings ? header.Strings : 1) * sizeof(char*));
+	if (strings == 0)
+		return LC_FR_MemoryFull;
+	LC_FileResult_t result = LC_FR_Ok;
+	uint32_t position = sizeof(header), end = sizeof(header) + header.StringBytes;
+	for (uint16_t s = 0; s < header.Strings; s++) {
+		int32_t length = strnlen(&data[position], end - position);
+		if (position + length >= end) {
+			result = LC_FR_InvalidObject;
+			break;
+		}
+		strings[s] = LC_ParamCacheIntern(&data[position], length);
+		if (strings[s] == 0) {
+			result = LC_FR_MemoryFull;
+			break;
+		}
+		position += length + 1;
+	}
+	position = end;
+	for (uint16_t d = 0; d < header.Directories && result == LC_FR_Ok; d++) {
+		cacheFileDirectory_t dir;
+		if (position + sizeof(dir) > size) {
+			result = LC_FR_InvalidObject;
+			break;
+		}
+		memcpy(&dir, &data[position], sizeof(dir));
+		position += sizeof(dir);
+		if (position + dir.Size * sizeof(cacheFileParam_t) > size) {
+			result = LC_FR_InvalidObject;
+			break;
+		}
+		cacheDirectory_t* entry = lcmalloc(sizeof(cacheDirectory_t) + dir.Size * sizeof(cacheParam_t));
+		if (entry == 0) {
+			result = LC_FR_MemoryFull;
+			break;
+		}
+		entry->Identity = dir.Identity;
+		entry->Descriptor = dir.Descriptor;
+		entry->Directory = dir.Directory;
+		entry->Size = dir.Size;
+		for (uint16_t i = 0; i < dir.Size; i++) {
+			cacheFileParam_t record;
+			memcpy(&record, &data[position], sizeof(record));
+			position += sizeof(record);
+			if ((record.Name != CACHE_NO_STRING && record.Name >= header.Strings)
+					|| (record.Formatting != CACHE_NO_STRING && record.Formatting >= header.Strings)) {
+				result = LC_FR_InvalidObject;
+				break;
+			}
+			cacheParam_t* cached = &entry->Params[i];
+			cached->Min = record.Min;
+			cached->Max = record.Max;
+			cached->Step = record.Step;
+			cached->Decimal = record.Decimal;
+			cached->ParamType = record.ParamType;
+			cached->Name = record.Name != CACHE_NO_STRING ? strings[record.Name] : 0;
+			cached->Formatting = record.Formatting != CACHE_NO_STRING ? strings[record.Formatting] : 0;
+		}
+		if (result != LC_FR_Ok) {
+			lcfree(entry);
+			break;
+		}
+		cacheDirectory_t** old = findCached(entry->Identity, entry->Directory);
+		if (*old) {
+			entry->Next = (*old)->Next;
+			lcfree(*old);
+		} else
+			entry->Next = 0;
+		*old = entry;
+	}
+	lcfree(strings);
+	return result;
+}
+#endif
@@ -0,0 +1,40 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, client parameter descriptor cache
+ * levcan_paramcache.h
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "stdint.h"
+#include "levcan.h"
+#include "levcan_param.h"
+
+#pragma once
+
+//hash buckets of string pool
+#ifndef LEVCAN_PARAM_CACHE_BUCKETS
+#define LEVCAN_PARAM_CACHE_BUCKETS 32
+#endif
+
+#if defined(LEVCAN_PARAM_CACHE) && defined(LEVCAN_MEM_STATIC)
+#error "LEVCAN_PARAM_CACHE needs dynamic memory"
+#endif
+
+typedef struct {
+	int32_t Directories;
+	int32_t Parameters;
+	int32_t Strings; //unique strings in pool
+	int32_t StringBytes; //pool text size with terminators
+	int32_t Referenced; //string references from cache, equal strings counted every time
+} LC_ParamCacheInfo_t;
+
+const char* LC_ParamCacheIntern(const char* string, int32_t length);
+LC_Return_t LC_ParamCacheStore(LC_NodeShortName_t node, uint16_t dir, uint32_t descriptor, const LC_ParameterValue_t* params, uint16_t size);
+LC_Return_t LC_ParamCacheApply(LC_NodeShortName_t node, uint16_t dir, uint32_t descriptor, LC_ParameterValue_t* params, uint16_t size);
+void LC_ParamCacheClear(void);
+LC_ParamCacheInfo_t LC_ParamCacheGetInfo(void);
+#ifdef LEVCAN_FILECLIENT
+#include "levcan_fileclient.h"
+LC_FileResult_t LC_ParamCacheSave(char* name, void* sender_node, uint8_t server_node);
+LC_FileResult_t LC_ParamCacheLoad(char* name, void* sender_node, uint8_t server_node);
+#endif
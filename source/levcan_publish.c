@@ -0,0 +1,250 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, change-driven object publishing
+ * levcan_publish.c
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "levcan.h"
+#include "levcan_publish.h"
+
+//private functions
+const LC_Object_t* findDictionaryObject(LC_NodeDescription_t* node, uint16_t index);
+const char* publishData(LC_Publish_t* publish, int32_t* size);
+uint32_t publishChecksum(const char* data, int32_t size);
+int publishChanged(LC_Publish_t* publish, const char* data, int32_t size);
+int32_t fieldValue(const char* data, LC_PublishField_t type);
+//private variables
+volatile LC_Publish_t* publish_start = 0;
+//extern variables
+extern LC_NodeDescription_t own_nodes[LEVCAN_MAX_OWN_NODES];
+
+/// Register object for change-driven transmission. Object data will be watched in LC_PublishManager
+/// @param publish Publish description, should be static. Setup Index, Target, Fields, Deadband, MinInterval, MaxPeriod
+/// @param sender_node Own network node, can be 0 for default node
+/// @return LC_Ok or LC_ObjectError if there is no readable object with such index
+LC_Return_t LC_PublishRegister(LC_Publish_t* publish, void* sender_node) {
+	LC_NodeDescription_t* node = sender_node;
+	if (publish == 0)
+		return LC_ObjectError;
+	if (node == 0)
+		node = &own_nodes[0];
+	const LC_Object_t* object = findDictionaryObject(node, publish->Index);
+	if (object == 0)
+		return LC_ObjectError;
+	LC_ObjectAttributes_t attr = object->Attributes;
+	if (attr.Record && object->Address)
+		attr = ((LC_ObjectRecord_t*) object->Address)->Attributes;
+	if (attr.Readable == 0 || attr.Function)
+		return LC_ObjectError;
+
+	publish->Node = node;
+	publish->Object = object;
+	publish->Shadow[0] = 0;
+	publish->Shadow[1] = 0;
+	publish->Checksum = 0;
+	publish->SinceSent = 0;
+	publish->Pending = 1; //send first value as soon as possible
+	//already in list?
+	for (LC_Publish_t* pub = (LC_Publish_t*) publish_start; pub; pub = pub->Next)
+		if (pub == publish)
+			return LC_Ok;
+	lc_disable_irq();
+	publish->Next = (void*) publish_start;
+	publish_start = publish;
+	lc_enable_irq();
+	return LC_Ok;
+}
+
+/// Stops object watching
+/// @param publish Registered publish description
+void LC_PublishUnregister(LC_Publish_t* publish) {
+	lc_disable_irq();
+	volatile LC_Publish_t** link = &publish_start;
+	while (*link) {
+		if (*link == publish) {
+			*link = publish->Next;
+			break;
+		}
+		link = (volatile LC_Publish_t**) &(*link)->Next;
+	}
+	lc_enable_irq();
+	publish->Next = 0;
+}
+
+/// Forces transmission on next LC_PublishManager call, MinInterval still applies
+/// @param publish Registered publish description
+void LC_PublishTrigger(LC_Publish_t* publish) {
+	publish->Pending = 1;
+}
+
+/// Watches registered objects and sends changed ones. Call it periodically, with LC_NetworkManager for example
+/// @param time Time passed since last call, ms
+void LC_PublishManager(uint32_t time) {
+	for (LC_Publish_t* pub = (LC_Publish_t*) publish_start; pub; pub = pub->Next) {
+		//count time, saturate
+		if (pub->SinceSent + time > UINT16_MAX)
+			pub->SinceSent = UINT16_MAX;
+		else
+			pub->SinceSent += time;
+		if (pub->SinceSent < pub->MinInterval)
+			continue;
+
+		int32_t size;
+		const char* data = publishData(pub, &size);
+		if (data == 0)
+			continue;
+		int refresh = (pub->MaxPeriod != 0) && (pub->SinceSent >= pub->MaxPeriod);
+		if (!pub->Pending && !refresh && !publishChanged(pub, data, size))
+			continue;
+
+		LC_ObjectRecord_t rec = { 0 };
+		rec.Address = pub->Object->Address;
+		rec.Size = pub->Object->Size;
+		rec.Attributes = pub->Object->Attributes;
+		if (pub->Object->Attributes.Record) {
+			//first record describes data
+			LC_ObjectRecord_t* record = pub->Object->Address;
+			rec.Address = record->Address;
+			rec.Size = record->Size;
+			rec.Attributes = record->Attributes;
+		}
+		rec.NodeID = pub->Target;
+		//static data only, do not free it after transmission
+		rec.Attributes.Cleanup = 0;
+
+		if (LC_SendMessage(pub->Node, &rec, pub->Index) == LC_Ok) {
+			//save new reference data
+			if (size <= 8) {
+				pub->Shadow[0] = 0;
+				pub->Shadow[1] = 0;
+				memcpy(pub->Shadow, data, size);
+			} else
+				pub->Checksum = publishChecksum(data, size);
+			pub->SinceSent = 0;
+			pub->Pending = 0;
+		}
+		//else keep trying next time
+	}
+}
+
+const LC_Object_t* findDictionaryObject(LC_NodeDescription_t* node, uint16_t index) {
+	if (node == 0)
+		return 0;
+	for (int i = 0; i < node->ObjectsSize; i++)
+		if (node->Objects[i].Index == index)
+			return &node->Objects[i];
+	return 0;
+}
+
+const char* publishData(LC_Publish_t* publish, int32_t* size) {
+	const LC_Object_t* object = publish->Object;
+	const char* data = object->Address;
+	int32_t dsize = object->Size;
+	LC_ObjectAttributes_t attr = object->Attributes;
+	if (attr.Record) {
+		const LC_ObjectRecord_t* record = object->Address;
+		if (record == 0)
+			return 0;
+		data = record->Address;
+		dsize = record->Size;
+		attr = record->Attributes;
+	}
+	if (data && attr.Pointer)
+		data = *(char**) data;
+	if (data == 0)
+		return 0;
+	//negative size - string up to abs(size)
+	if (dsize < 0)
+		dsize = strnlen(data, -dsize);
+	*size = dsize;
+	return data;
+}
+
+uint32_t publishChecksum(const char* data, int32_t size) {
+	//FNV-1a
+	uint32_t hash = 2166136261u;
+	for (int32_t i = 0; i < size; i++) {
+		hash ^= (uint8_t) data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+int publishChanged(LC_Publish_t* publish, const char* data, int32_t size) {
+	if (size > 8)
+		return publishChecksum(data, size) != publish->Checksum;
+
+	const char* shadow = (const char*) publish->Shadow;
+	int fsize = 0;
+	switch (publish->Fields) {
+	case LC_PF_Int8:
+	case LC_PF_Uint8:
+		fsize = 1;
+		break;
+	case LC_PF_Int16:
+	case LC_PF_Uint16:
+		fsize = 2;
+		break;
+	case LC_PF_Int32:
+	case LC_PF_Uint32:
+		fsize = 4;
+		break;
+#ifdef LEVCAN_USE_FLOAT
+	case LC_PF_Float: {
+		for (int pos = 0; pos + 4 <= size; pos += 4) {
+			float now, last;
+			memcpy(&now, &data[pos], 4);
+			memcpy(&last, &shadow[pos], 4);
+			if (fabsf(now - last) > (float) publish->Deadband || (now != last && publish->Deadband == 0))
+				return 1;
+		}
+		return 0;
+	}
+#endif
+	default:
+		break;
+	}
+	if (fsize == 0 || publish->Deadband == 0)
+		return memcmp(data, shadow, size) != 0;
+	//compare each field with deadband, tail bytes compared as raw
+	int pos = 0;
+	for (; pos + fsize <= size; pos += fsize) {
+		int32_t now = fieldValue(&data[pos], publish->Fields);
+		int32_t last = fieldValue(&shadow[pos], publish->Fields);
+		int64_t diff = (int64_t) now - last;
+		if (publish->Fields == LC_PF_Uint32)
+			diff = (int64_t) (uint32_t) now - (uint32_t) last;
+		if (diff > publish->Deadband || -diff > publish->Deadband)
+			return 1;
+	}
+	return memcmp(&data[pos], &shadow[pos], size - pos) != 0;
+}
+
+int32_t fieldValue(const char* data, LC_PublishField_t type) {
+	switch (type) {
+	case LC_PF_Int8:
+		return (int8_t) data[0];
+	case LC_PF_Uint8:
+		return (uint8_t) data[0];
+	case LC_PF_Int16: {
+		int16_t v;
+		memcpy(&v, data, 2);
+		return v;
+	}
+	case LC_PF_Uint16: {
+		uint16_t v;
+		memcpy(&v, data, 2);
+		return v;
+	}
+	default: {
+		int32_t v;
+		memcpy(&v, data, 4);
+		return v;
+	}
+	}
+}
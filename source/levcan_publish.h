@@ -0,0 +1,46 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, change-driven object publishing
+ * levcan_publish.h
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "stdint.h"
+#include "levcan.h"
+
+#pragma once
+
+//how object memory is split into fields for deadband comparison
+typedef enum {
+	LC_PF_Raw, 		//any byte change triggers transmission, deadband ignored
+	LC_PF_Int8,
+	LC_PF_Uint8,
+	LC_PF_Int16,
+	LC_PF_Uint16,
+	LC_PF_Int32,
+	LC_PF_Uint32,
+	LC_PF_Float, 	//needs LEVCAN_USE_FLOAT, otherwise compared as raw
+} LC_PublishField_t;
+
+typedef struct {
+	//setup, filled by user
+	uint16_t Index; //object index in node dictionary (LC_Object_t.Index), should be Readable
+	uint16_t Target; //receiver node ID, LC_Broadcast_Address for everyone
+	LC_PublishField_t Fields; //object field type used for deadband
+	int32_t Deadband; //send when any field changed more than this value, 0 - any change
+	uint16_t MinInterval; //ms, minimum time between two transmissions
+	uint16_t MaxPeriod; //ms, refresh even if nothing changed, 0 - send only on change
+	//runtime, filled by LC_PublishRegister
+	void* Node;
+	const LC_Object_t* Object;
+	uint32_t Shadow[2]; //last sent data, objects up to 8 bytes
+	uint32_t Checksum; //last sent data checksum, objects larger than 8 bytes
+	uint16_t SinceSent;
+	uint8_t Pending;
+	void* Next;
+} LC_Publish_t;
+
+LC_Return_t LC_PublishRegister(LC_Publish_t* publish, void* sender_node);
+void LC_PublishUnregister(LC_Publish_t* publish);
+void LC_PublishTrigger(LC_Publish_t* publish);
+void LC_PublishManager(uint32_t time);
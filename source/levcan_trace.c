@@ -0,0 +1,178 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, binary event trace
+ * levcan_trace.c
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include <string.h>
+
+#include "levcan.h"
+#include "levcan_trace.h"
+
+#ifdef LEVCAN_TRACE
+extern int trace_printf(const char* format, ...);
+#endif
+
+#ifdef LEVCAN_TRACE_RING
+LC_TraceRing_t lc_trace = { .Magic = LC_TRACE_MAGIC, .Size = LEVCAN_TRACE_RING_SIZE };
+volatile uint32_t lc_trace_ticks = 0;
+
+/// Stores event in trace ring. Safe to call from any interrupt and task, never blocks
+/// @param event LC_TraceEvent_t
+/// @param a First argument
+/// @param b Second argument
+/// @param c Third argument
+void LC_TraceWrite(uint16_t event, int32_t a, int32_t b, int32_t c) {
+	uint32_t pos;
+	//reserve slot, writers do not wait each other
+#if defined(__GNUC__) && (__GCC_ATOMIC_INT_LOCK_FREE == 2)
+	pos = __atomic_fetch_add(&lc_trace.Head, 1, __ATOMIC_RELAXED);
+#else
+	lc_disable_irq();
+	pos = lc_trace.Head++;
+	lc_enable_irq();
+#endif
+	LC_TraceEntry_t* entry = &lc_trace.Entries[pos % LEVCAN_TRACE_RING_SIZE];
+	entry->Seq = 0; //invalid while writing
+	entry->Time = LEVCAN_TRACE_TIME();
+	entry->Event = event;
+	entry->Args[0] = a;
+	entry->Args[1] = b;
+	entry->Args[2] = c;
+#if defined(__GNUC__)
+	__atomic_store_n(&entry->Seq, pos + 1, __ATOMIC_RELEASE);
+#else
+	entry->Seq = pos + 1;
+#endif
+}
+
+/// Copies new trace entries, oldest first. Overwritten entries are skipped
+/// @param entries Output array
+/// @param max Output array size
+/// @param position Next entry to read, start from 0. Updated after read
+/// @return Entries copied
+uint32_t LC_TraceRead(LC_TraceEntry_t* entries, uint32_t max, uint32_t* position) {
+	uint32_t head = lc_trace.Head;
+	uint32_t pos = *position;
+	uint32_t count = 0;
+	//lost entries
+	if (head - pos > LEVCAN_TRACE_RING_SIZE)
+		pos = head - LEVCAN_TRACE_RING_SIZE;
+	for (; pos != head && count < max; pos++) {
+		const LC_TraceEntry_t* entry = &lc_trace.Entries[pos % LEVCAN_TRACE_RING_SIZE];
+		if (entry->Seq != pos + 1)
+			break; //still being written, read it next time
+		entries[count] = *entry;
+		//overwritten while copied?
+		if (entry->Seq != pos + 1)
+			break;
+		count++;
+	}
+	*position = pos;
+	return count;
+}
+#endif
+
+#if defined(LEVCAN_TRACE) || defined(LEVCAN_TRACE_DECODER)
+const char* const trace_names[LC_TE_End] = {
+		[LC_TE_None] = "None",
+		[LC_TE_IdLost] = "IdLost",
+		[LC_TE_IdCollision] = "IdCollision",
+		[LC_TE_IdClaim] = "IdClaim",
+		[LC_TE_DiscoveryFinish] = "DiscoveryFinish",
+		[LC_TE_Online] = "Online",
+		[LC_TE_Alone] = "Alone",
+		[LC_TE_NodeNew] = "NodeNew",
+		[LC_TE_NodeReplaced] = "NodeReplaced",
+		[LC_TE_NodeLostId] = "NodeLostId",
+		[LC_TE_NodeTimeout] = "NodeTimeout",
+		[LC_TE_TxCreated] = "TxCreated",
+		[LC_TE_TxFinished] = "TxFinished",
+		[LC_TE_TxLengthMismatch] = "TxLengthMismatch",
+		[LC_TE_TxParityLost] = "TxParityLost",
+		[LC_TE_TxTimeout] = "TxTimeout",
+		[LC_TE_RxCreated] = "RxCreated",
+		[LC_TE_RxDualDenied] = "RxDualDenied",
+		[LC_TE_RxFastFailed] = "RxFastFailed",
+		[LC_TE_RxFinishFailed] = "RxFinishFailed",
+		[LC_TE_RxOverflow] = "RxOverflow",
+		[LC_TE_RxTimeout] = "RxTimeout",
+		[LC_TE_ObjectListError] = "ObjectListError",
+};
+
+//human readable text for each event, up to 3 arguments
+const char* const trace_formats[LC_TE_End] = {
+		[LC_TE_None] = "",
+		[LC_TE_IdLost] = "We lost ID:%d\n",
+		[LC_TE_IdCollision] = "Collision found ID:%d\n",
+		[LC_TE_IdClaim] = "Trying claim ID:%d\n",
+		[LC_TE_DiscoveryFinish] = "Discovery finish id:%d\n",
+		[LC_TE_Online] = "We are online ID:%d\n",
+		[LC_TE_Alone] = "Are we alone?:%d\n",
+		[LC_TE_NodeNew] = "New node detected ID:%d\n",
+		[LC_TE_NodeReplaced] = "Replaced ID: %d from S/N: 0x%04X to S/N: 0x%04X\n",
+		[LC_TE_NodeLostId] = "Lost ID:%d S/N:%08X\n",
+		[LC_TE_NodeTimeout] = "Node lost, timeout:%d\n",
+		[LC_TE_TxCreated] = "New TX object created:%d to:%d\n",
+		[LC_TE_TxFinished] = "TX TCP finished:%d position:%d length:%d\n",
+		[LC_TE_TxLengthMismatch] = "TX TCP length mismatch:%d, it is:%d, it should:%d\n",
+		[LC_TE_TxParityLost] = "TX object parity lost:%d position:%d\n",
+		[LC_TE_TxTimeout] = "TX object deleted by attempt:%d to:%d\n",
+		[LC_TE_RxCreated] = "New RX object created:%d from:%d\n",
+		[LC_TE_RxDualDenied] = "RX dual request denied:%d, from node:%d\n",
+		[LC_TE_RxFastFailed] = "RX fast failed:%d from:%d\n",
+		[LC_TE_RxFinishFailed] = "RX finish failed %d no object found for size %d\n",
+		[LC_TE_RxOverflow] = "RX buffer overflow, object deleted:%d position:%d\n",
+		[LC_TE_RxTimeout] = "RX object deleted by timeout:%d from:%d\n",
+		[LC_TE_ObjectListError] = "Object list error:%d\n",
+};
+
+/// Returns event short name
+const char* LC_TraceEventName(uint16_t event) {
+	if (event >= LC_TE_End || trace_names[event] == 0)
+		return "Unknown";
+	return trace_names[event];
+}
+
+/// Renders one entry as text line with timestamp
+/// @param entry Trace entry
+/// @param print printf-like output function
+void LC_TraceRender(const LC_TraceEntry_t* entry, LC_TracePrintf_t print) {
+	print("%10lu %-16s ", (unsigned long) entry->Time, LC_TraceEventName(entry->Event));
+	if (entry->Event < LC_TE_End && trace_formats[entry->Event])
+		print(trace_formats[entry->Event], entry->Args[0], entry->Args[1], entry->Args[2]);
+	else
+		print("%d %d %d\n", entry->Args[0], entry->Args[1], entry->Args[2]);
+}
+
+/// Renders whole ring content, oldest first. Works with memory dump of LC_TraceRing_t
+/// @param entries Ring entries
+/// @param size Ring size, LC_TraceRing_t.Size
+/// @param head Entries written, LC_TraceRing_t.Head
+/// @param print printf-like output function
+/// @return Entries rendered
+uint32_t LC_TraceDecode(const LC_TraceEntry_t* entries, uint32_t size, uint32_t head, LC_TracePrintf_t print) {
+	uint32_t pos = 0, count = 0;
+	if (size == 0)
+		return 0;
+	if (head > size)
+		pos = head - size;
+	for (; pos != head; pos++) {
+		const LC_TraceEntry_t* entry = &entries[pos % size];
+		if (entry->Seq != pos + 1)
+			continue; //torn or never written
+		LC_TraceRender(entry, print);
+		count++;
+	}
+	return count;
+}
+#endif
+
+#ifdef LEVCAN_TRACE
+/// Prints event immediately with trace_printf, used when binary ring is disabled
+void LC_TracePrint(uint16_t event, int32_t a, int32_t b, int32_t c) {
+	if (event < LC_TE_End && trace_formats[event])
+		trace_printf(trace_formats[event], a, b, c);
+}
+#endif
@@ -0,0 +1,98 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, binary event trace
+ * levcan_trace.h
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "stdint.h"
+#include "levcan.h"
+
+#pragma once
+
+//Entries in trace ring, should be power of 2
+#ifndef LEVCAN_TRACE_RING_SIZE
+#define LEVCAN_TRACE_RING_SIZE 64
+#endif
+//Timestamp source, default is ms counter updated by LC_NetworkManager
+#ifndef LEVCAN_TRACE_TIME
+#define LEVCAN_TRACE_TIME() lc_trace_ticks
+#endif
+
+typedef enum {
+	LC_TE_None,
+	//address claim
+	LC_TE_IdLost, //id
+	LC_TE_IdCollision, //id
+	LC_TE_IdClaim, //id
+	LC_TE_DiscoveryFinish, //id
+	LC_TE_Online, //id
+	LC_TE_Alone, //id
+	//node table
+	LC_TE_NodeNew, //id
+	LC_TE_NodeReplaced, //id, old serial, new serial
+	LC_TE_NodeLostId, //id, serial
+	LC_TE_NodeTimeout, //id
+	//transfers
+	LC_TE_TxCreated, //msgid, target
+	LC_TE_TxFinished, //msgid, position, length
+	LC_TE_TxLengthMismatch, //msgid, position, length
+	LC_TE_TxParityLost, //msgid, position
+	LC_TE_TxTimeout, //msgid, target
+	LC_TE_RxCreated, //msgid, source
+	LC_TE_RxDualDenied, //msgid, source
+	LC_TE_RxFastFailed, //msgid, source
+	LC_TE_RxFinishFailed, //msgid, size
+	LC_TE_RxOverflow, //msgid, position
+	LC_TE_RxTimeout, //msgid, source
+	LC_TE_ObjectListError, //0 - start, 1 - end, 2 - delete
+	LC_TE_End,
+} LC_TraceEvent_t;
+
+typedef struct {
+	uint32_t Seq; //position + 1, written last. Mismatch means entry is being written
+	uint32_t Time;
+	uint16_t Event;
+	uint16_t Reserved;
+	int32_t Args[3];
+} LC_TraceEntry_t;
+
+//self-described memory layout, can be dumped by debugger and decoded on host
+typedef struct {
+	uint32_t Magic;
+	uint32_t Size;
+	volatile uint32_t Head; //total entries written
+	LC_TraceEntry_t Entries[LEVCAN_TRACE_RING_SIZE];
+} LC_TraceRing_t;
+
+#define LC_TRACE_MAGIC 0x5254434C //"LCTR"
+
+#if defined(LEVCAN_TRACE_RING)
+//always enabled events
+#define LC_TRACE(event, a, b, c) LC_TraceWrite(event, a, b, c)
+//frequent events, binary ring only
+#define LC_TRACE_FAST(event, a, b, c) LC_TraceWrite(event, a, b, c)
+#elif defined(LEVCAN_TRACE)
+#define LC_TRACE(event, a, b, c) LC_TracePrint(event, a, b, c)
+#define LC_TRACE_FAST(event, a, b, c) do { } while (0)
+#else
+#define LC_TRACE(event, a, b, c) do { } while (0)
+#define LC_TRACE_FAST(event, a, b, c) do { } while (0)
+#endif
+
+#ifdef LEVCAN_TRACE_RING
+extern LC_TraceRing_t lc_trace;
+extern volatile uint32_t lc_trace_ticks;
+void LC_TraceWrite(uint16_t event, int32_t a, int32_t b, int32_t c);
+uint32_t LC_TraceRead(LC_TraceEntry_t* entries, uint32_t max, uint32_t* position);
+#endif
+
+#if defined(LEVCAN_TRACE) || defined(LEVCAN_TRACE_DECODER)
+typedef int (*LC_TracePrintf_t)(const char* format, ...);
+const char* LC_TraceEventName(uint16_t event);
+void LC_TraceRender(const LC_TraceEntry_t* entry, LC_TracePrintf_t print);
+uint32_t LC_TraceDecode(const LC_TraceEntry_t* entries, uint32_t size, uint32_t head, LC_TracePrintf_t print);
+#endif
+#ifdef LEVCAN_TRACE
+void LC_TracePrint(uint16_t event, int32_t a, int32_t b, int32_t c);
+#endif
@@ -0,0 +1,309 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, transport benchmark
+ * lc_bench.c
+ *
+ *  Created on: 18 oct 2026
+ *
+ * Runs LEVCAN nodes on virtual bus (hal/Virtual) and prints JSON report:
+ * UDP/TCP transfer time and throughput for 8 B..64 KB, LC_SendRequest round trip,
+ * CPU time of LC_ReceiveHandler, LC_NetworkManager and LC_TransmitHandler.
+ * Transfer times are bus time, so they depend only on protocol, bit rate and manager
+ * period. CPU times are host time and useful to compare builds on same machine.
+ *
+ * Build library as described in hal/Virtual/can_instance.h, then:
+ * gcc -O2 -Iexamples/host -Isource -Ihal/Virtual tools/lc_bench.c hal/Virtual/can_vbus.c
+ *   hal/Virtual/can_instance.c -ldl -o lc_bench
+ * Usage: lc_bench liblevcan_vnode.so [-b bitrate] [-m manager_us] [-r repeats] [-n nodes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "can_instance.h"
+
+#define BENCH_MAX_NODES 8
+#define BENCH_UDP_INDEX 0x100
+#define BENCH_TCP_INDEX 0x101
+#define BENCH_REQ_INDEX 0x102
+#define BENCH_MAX_SIZE 65536
+#define BENCH_LATENCY_COUNT 200
+//transfer is failed after this bus time, ns
+#define BENCH_TIMEOUT 20000000000ull
+
+typedef struct {
+	CAN_Instance_t Lib;
+	void* Node;
+	uint16_t NodeID;
+	uint64_t RxNs, TxNs, ManagerNs;
+	uint32_t RxCalls, TxCalls, ManagerCalls;
+	LC_Object_t Objects[3];
+} BenchNode_t;
+
+typedef struct {
+	uint64_t Min, Max, Sum;
+	uint32_t Count, Failed, Frames;
+} BenchTimes_t;
+
+//private functions
+uint64_t benchNow(void);
+void benchRx(void* context);
+void benchTx(void* context);
+void benchStep(void);
+int benchWait(volatile uint8_t* flag, uint64_t timeout);
+void benchReceived(LC_NodeDescription_t* node, LC_Header_t header, void* data, int32_t size);
+void benchAnswer(LC_NodeDescription_t* node, LC_Header_t header, void* data, int32_t size);
+void benchTransfer(BenchTimes_t* result, uint16_t index, int32_t size);
+void benchLatency(void);
+void benchCpu(void);
+int benchCompare(const void* a, const void* b);
+//private variables
+CAN_VirtualBus_t bench_bus;
+BenchNode_t bench_nodes[BENCH_MAX_NODES];
+uint16_t bench_count = 2;
+uint32_t bench_manager_us = 1000;
+uint32_t bench_repeats = 5;
+uint32_t bench_us_rest;
+uint8_t bench_payload[BENCH_MAX_SIZE];
+uint64_t bench_answer = 0x0123456789ABCDEFull;
+//completion, written from callbacks
+volatile uint8_t bench_done;
+volatile uint64_t bench_done_time;
+volatile int32_t bench_done_size;
+volatile uint32_t bench_errors;
+
+int main(int argc, char** argv) {
+	uint32_t bitrate = 1000000;
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s liblevcan_vnode.so [-b bitrate] [-m manager_us] [-r repeats] [-n nodes]\n", argv[0]);
+		return 1;
+	}
+	for (int i = 2; i + 1 < argc; i += 2) {
+		uint32_t value = strtoul(argv[i + 1], 0, 0);
+		if (strcmp(argv[i], "-b") == 0)
+			bitrate = value;
+		else if (strcmp(argv[i], "-m") == 0)
+			bench_manager_us = value;
+		else if (strcmp(argv[i], "-r") == 0)
+			bench_repeats = value;
+		else if (strcmp(argv[i], "-n") == 0)
+			bench_count = value;
+	}
+	if (bench_count < 2)
+		bench_count = 2;
+	if (bench_count > BENCH_MAX_NODES)
+		bench_count = BENCH_MAX_NODES;
+	if (bench_manager_us == 0)
+		bench_manager_us = 1000;
+	if (bench_repeats == 0)
+		bench_repeats = 1;
+	for (int i = 0; i < BENCH_MAX_SIZE; i++)
+		bench_payload[i] = i * 7 + (i >> 8);
+
+	CAN_VBusInit(&bench_bus, bitrate, 1);
+	for (int i = 0; i < bench_count; i++) {
+		BenchNode_t* bn = &bench_nodes[i];
+		if (CAN_InstanceLoad(&bn->Lib, argv[1])) {
+			fprintf(stderr, "%s: load failed\n", argv[1]);
+			return 1;
+		}
+		bn->Lib.Port->RxInterrupt = benchRx;
+		bn->Lib.Port->TxInterrupt = benchTx;
+		bn->Lib.Port->Context = bn;
+		CAN_VBusAttach(&bench_bus, bn->Lib.Port);
+		//node 1 is receiver, node 0 sender and requester, others only load discovery
+		LC_NodeInit_t init = { 0 };
+		init.DeviceName = "bench";
+		init.NodeID = -1;
+		init.Serial = 100 + i;
+		if (i == 1) {
+			bn->Objects[0] = (LC_Object_t ) { .Index = BENCH_UDP_INDEX, .Attributes.Writable = 1, .Attributes.Function = 1, .Size = -BENCH_MAX_SIZE, .Address =
+							benchReceived };
+			bn->Objects[1] = (LC_Object_t ) { .Index = BENCH_TCP_INDEX, .Attributes.Writable = 1, .Attributes.Function = 1, .Attributes.TCP = 1, .Size =
+							-BENCH_MAX_SIZE, .Address = benchReceived };
+			bn->Objects[2] = (LC_Object_t ) { .Index = BENCH_REQ_INDEX, .Attributes.Readable = 1, .Size = sizeof(bench_answer), .Address = &bench_answer };
+			init.Objects = bn->Objects;
+			init.ObjectsSize = 3;
+		} else if (i == 0) {
+			bn->Objects[0] = (LC_Object_t ) { .Index = BENCH_REQ_INDEX, .Attributes.Writable = 1, .Attributes.Function = 1, .Size = sizeof(bench_answer),
+							.Address = benchAnswer };
+			init.Objects = bn->Objects;
+			init.ObjectsSize = 1;
+		}
+		bn->Node = bn->Lib.CreateNode(init);
+	}
+	//discovery and address claim
+	while (bench_bus.Time < 1000000000ull)
+		benchStep();
+	LC_NodeShortName_t (*name)(void*);
+	for (int i = 0; i < bench_count; i++) {
+		name = CAN_InstanceSymbol(&bench_nodes[i].Lib, "LC_GetMyNodeName");
+		bench_nodes[i].NodeID = name(bench_nodes[i].Node).NodeID;
+		//only workload is measured
+		bench_nodes[i].RxNs = bench_nodes[i].TxNs = bench_nodes[i].ManagerNs = 0;
+		bench_nodes[i].RxCalls = bench_nodes[i].TxCalls = bench_nodes[i].ManagerCalls = 0;
+		bench_nodes[i].Lib.Port->RxFrames = bench_nodes[i].Lib.Port->TxFrames = 0;
+	}
+	if (bench_nodes[0].Lib.GetNode(bench_nodes[1].NodeID).NodeID != bench_nodes[1].NodeID) {
+		fprintf(stderr, "nodes did not find each other\n");
+		return 1;
+	}
+
+	printf("{\n  \"config\": {\"bitrate\": %u, \"manager_us\": %u, \"repeats\": %u, \"nodes\": %u},\n", bitrate, bench_manager_us, bench_repeats,
+			bench_count);
+	printf("  \"transfers\": [");
+	int first = 1;
+	for (int mode = 0; mode < 2; mode++) {
+		for (int32_t size = 8; size <= BENCH_MAX_SIZE; size *= 2) {
+			BenchTimes_t result;
+			benchTransfer(&result, mode ? BENCH_TCP_INDEX : BENCH_UDP_INDEX, size);
+			uint64_t avg = result.Count ? result.Sum / result.Count : 0;
+			printf("%s\n    {\"mode\": \"%s\", \"size\": %d, \"completed\": %u, \"failed\": %u, \"time_us\": {\"min\": %.1f, \"avg\": %.1f, \"max\": %.1f}, "
+					"\"throughput_Bps\": %.0f, \"frames\": %u}", first ? "" : ",", mode ? "tcp" : "udp", size, result.Count, result.Failed,
+					result.Min / 1000.0, avg / 1000.0, result.Max / 1000.0, avg ? size * 1e9 / avg : 0.0, result.Count ? result.Frames / result.Count : 0);
+			first = 0;
+		}
+	}
+	printf("\n  ],\n");
+	benchLatency();
+	benchCpu();
+	printf("  \"errors\": %u\n}\n", bench_errors);
+	for (int i = 0; i < bench_count; i++)
+		CAN_InstanceUnload(&bench_nodes[i].Lib);
+	return 0;
+}
+
+uint64_t benchNow(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+void benchRx(void* context) {
+	BenchNode_t* bn = context;
+	uint64_t start = benchNow();
+	bn->Lib.ReceiveHandler();
+	bn->RxNs += benchNow() - start;
+	bn->RxCalls++;
+}
+
+void benchTx(void* context) {
+	BenchNode_t* bn = context;
+	uint64_t start = benchNow();
+	bn->Lib.TransmitHandler();
+	bn->TxNs += benchNow() - start;
+	bn->TxCalls++;
+}
+
+/// One manager period for all nodes, then bus runs until next one
+void benchStep(void) {
+	bench_us_rest += bench_manager_us;
+	uint32_t ms = bench_us_rest / 1000;
+	bench_us_rest %= 1000;
+	for (int i = 0; i < bench_count; i++) {
+		uint64_t start = benchNow();
+		bench_nodes[i].Lib.NetworkManager(ms);
+		bench_nodes[i].ManagerNs += benchNow() - start;
+		bench_nodes[i].ManagerCalls++;
+	}
+	CAN_VBusRun(&bench_bus, bench_bus.Time + bench_manager_us * 1000ull);
+}
+
+int benchWait(volatile uint8_t* flag, uint64_t timeout) {
+	uint64_t end = bench_bus.Time + timeout;
+	while (*flag == 0 && bench_bus.Time < end)
+		benchStep();
+	return *flag;
+}
+
+void benchReceived(LC_NodeDescription_t* node, LC_Header_t header, void* data, int32_t size) {
+	if (size != bench_done_size || memcmp(data, bench_payload, size) != 0)
+		bench_errors++;
+	bench_done_time = bench_bus.Time;
+	bench_done = 1;
+}
+
+void benchAnswer(LC_NodeDescription_t* node, LC_Header_t header, void* data, int32_t size) {
+	if (size != sizeof(bench_answer) || memcmp(data, &bench_answer, size) != 0)
+		bench_errors++;
+	bench_done_time = bench_bus.Time;
+	bench_done = 1;
+}
+
+void benchTransfer(BenchTimes_t* result, uint16_t index, int32_t size) {
+	memset(result, 0, sizeof(BenchTimes_t));
+	result->Min = UINT64_MAX;
+	LC_ObjectRecord_t record = { 0 };
+	record.Address = bench_payload;
+	record.Size = size;
+	record.Attributes.TCP = (index == BENCH_TCP_INDEX);
+	record.NodeID = bench_nodes[1].NodeID;
+	for (int r = 0; r < bench_repeats; r++) {
+		bench_done = 0;
+		bench_done_size = size;
+		//previous TCP transfer closes after receiver callback
+		LC_Return_t ret;
+		for (int retry = 0; (ret = bench_nodes[0].Lib.SendMessage(bench_nodes[0].Node, &record, index)) == LC_Collision && retry < 1000; retry++)
+			benchStep();
+		uint64_t start = bench_bus.Time;
+		uint32_t frames = bench_bus.Frames;
+		if (ret != LC_Ok || !benchWait(&bench_done, BENCH_TIMEOUT)) {
+			result->Failed++;
+			continue;
+		}
+		uint64_t time = bench_done_time - start;
+		result->Count++;
+		result->Sum += time;
+		result->Frames += bench_bus.Frames - frames;
+		if (time < result->Min)
+			result->Min = time;
+		if (time > result->Max)
+			result->Max = time;
+	}
+	if (result->Count == 0)
+		result->Min = 0;
+}
+
+void benchLatency(void) {
+	uint64_t times[BENCH_LATENCY_COUNT];
+	uint32_t count = 0, failed = 0;
+	for (int r = 0; r < BENCH_LATENCY_COUNT; r++) {
+		bench_done = 0;
+		uint64_t start = bench_bus.Time;
+		if (bench_nodes[0].Lib.SendRequest(bench_nodes[0].Node, bench_nodes[1].NodeID, BENCH_REQ_INDEX) != LC_Ok || !benchWait(&bench_done, BENCH_TIMEOUT)) {
+			failed++;
+			benchStep();
+			continue;
+		}
+		times[count++] = bench_done_time - start;
+	}
+	qsort(times, count, sizeof(uint64_t), benchCompare);
+	uint64_t sum = 0;
+	for (int i = 0; i < count; i++)
+		sum += times[i];
+	printf("  \"request_latency_us\": {\"count\": %u, \"failed\": %u", count, failed);
+	if (count)
+		printf(", \"min\": %.1f, \"avg\": %.1f, \"p50\": %.1f, \"p99\": %.1f, \"max\": %.1f", times[0] / 1000.0, sum / 1000.0 / count,
+				times[count / 2] / 1000.0, times[count * 99 / 100] / 1000.0, times[count - 1] / 1000.0);
+	printf("},\n");
+}
+
+void benchCpu(void) {
+	printf("  \"cpu_ns\": [");
+	for (int i = 0; i < bench_count; i++) {
+		BenchNode_t* bn = &bench_nodes[i];
+		uint32_t rx = bn->Lib.Port->RxFrames, tx = bn->Lib.Port->TxFrames;
+		uint32_t frames = rx + tx;
+		printf("%s\n    {\"node\": %u, \"rx_frames\": %u, \"tx_frames\": %u, ", i ? "," : "", bn->NodeID, rx, tx);
+		printf("\"receive_handler_per_frame\": %.1f, \"transmit_handler_per_call\": %.1f, \"network_manager_per_call\": %.1f, "
+				"\"network_manager_per_frame\": %.1f}", rx ? (double) bn->RxNs / rx : 0.0, bn->TxCalls ? (double) bn->TxNs / bn->TxCalls : 0.0,
+				bn->ManagerCalls ? (double) bn->ManagerNs / bn->ManagerCalls : 0.0, frames ? (double) bn->ManagerNs / frames : 0.0);
+	}
+	printf("\n  ],\n");
+}
+
+int benchCompare(const void* a, const void* b) {
+	uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+	return (x > y) - (x < y);
+}
@@ -0,0 +1,155 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, mass power-up address claim benchmark
+ * lc_claimsim.c
+ *
+ *  Created on: 18 oct 2026
+ *
+ * All nodes are powered at same moment on virtual bus (hal/Virtual), random serial numbers
+ * (unique in low 12 bits, used in short name).
+ * Measures time until every node is online with unique address. Free range 64..125 has only
+ * 62 addresses, so with 125 nodes first 63 get preferred addresses 0..62.
+ * Node table of host config (32) is smaller than network.
+ * Option -q gives nodes sequential serials from random start, like one production batch.
+ * Compare libraries built with and without LEVCAN_CLAIM_SPREAD:
+ *
+ * gcc -shared -fPIC ... -o liblevcan_vnode.so (see hal/Virtual/can_instance.h)
+ * gcc -shared -fPIC ... -DLEVCAN_CLAIM_SPREAD -o liblevcan_spread.so
+ * gcc -O2 -DCAN_VBUS_MAX_PORTS=128 -Iexamples/host -Isource -Ihal/Virtual tools/lc_claimsim.c
+ *   hal/Virtual/can_vbus.c hal/Virtual/can_instance.c -ldl -o lc_claimsim
+ * Usage: lc_claimsim [-r runs] [-q] liblevcan_vnode.so liblevcan_spread.so
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "can_instance.h"
+
+#define CLAIM_MAX_NODES 125
+#define CLAIM_TIMEOUT 30000 //ms
+#define CLAIM_FREE_IDS (LC_NodeFreeIDmax - LC_NodeFreeIDmin + 1)
+
+typedef struct {
+	uint32_t Converged, Failed;
+	uint32_t TimeMin, TimeMax, TimeSum;
+	uint32_t Frames, Collisions;
+} ClaimResult_t;
+
+//private functions
+int claimRun(const char* library, uint16_t count, uint32_t seed, ClaimResult_t* result);
+int claimDone(uint16_t count);
+uint32_t claimRandom(uint32_t* seed);
+//private variables
+CAN_VirtualBus_t claim_bus;
+CAN_Instance_t claim_nodes[CLAIM_MAX_NODES];
+LC_NodeDescription_t* claim_desc[CLAIM_MAX_NODES];
+const uint16_t claim_counts[] = { 10, 50, 125 };
+uint8_t claim_sequential;
+
+int main(int argc, char** argv) {
+	uint32_t runs = 5;
+	int first = 1, lib = 1;
+	if (argc > 2 && strcmp(argv[1], "-r") == 0) {
+		runs = strtoul(argv[2], 0, 0);
+		lib = 3;
+	}
+	if (lib < argc && strcmp(argv[lib], "-q") == 0) {
+		claim_sequential = 1;
+		lib++;
+	}
+	if (lib >= argc || runs == 0) {
+		fprintf(stderr, "usage: %s [-r runs] [-q] liblevcan.so [liblevcan2.so ...]\n", argv[0]);
+		return 1;
+	}
+	printf("{\n  \"runs\": %u,\n  \"serials\": \"%s\",\n  \"results\": [", runs, claim_sequential ? "sequential" : "random");
+	for (; lib < argc; lib++) {
+		for (int c = 0; c < sizeof(claim_counts) / sizeof(claim_counts[0]); c++) {
+			ClaimResult_t result = { .TimeMin = UINT32_MAX };
+			for (uint32_t r = 0; r < runs; r++)
+				if (claimRun(argv[lib], claim_counts[c], 1234 + r * 7919, &result))
+					return 1;
+			uint32_t done = result.Converged;
+			printf("%s\n    {\"library\": \"%s\", \"nodes\": %u, \"converged\": %u, \"failed\": %u, \"all_online_ms\": {\"min\": %u, \"avg\": %.1f, \"max\": %u}, "
+					"\"frames\": %.1f, \"collisions\": %.1f}", first ? "" : ",", argv[lib], claim_counts[c], done, result.Failed, done ? result.TimeMin : 0,
+					done ? (double) result.TimeSum / done : 0.0, result.TimeMax, (double) result.Frames / runs, (double) result.Collisions / runs);
+			first = 0;
+		}
+	}
+	printf("\n  ]\n}\n");
+	return 0;
+}
+
+int claimRun(const char* library, uint16_t count, uint32_t seed, ClaimResult_t* result) {
+	CAN_VBusInit(&claim_bus, 1000000, seed);
+	for (int i = 0; i < count; i++) {
+		if (CAN_InstanceLoad(&claim_nodes[i], library)) {
+			fprintf(stderr, "%s: load failed\n", library);
+			return 1;
+		}
+		CAN_VBusAttach(&claim_bus, claim_nodes[i].Port);
+	}
+	//power-up at once
+	uint32_t serials[CLAIM_MAX_NODES];
+	uint32_t batch = claim_sequential ? claimRandom(&seed) : 0; //random runs keep serials of older tool
+	for (int i = 0; i < count; i++) {
+		//short name has 12 bit of serial, equal names can not be resolved by claim
+		int unique;
+		if (claim_sequential)
+			serials[i] = batch + i;
+		else
+			do {
+				serials[i] = claimRandom(&seed);
+				unique = 1;
+				for (int k = 0; k < i; k++)
+					if (((serials[i] ^ serials[k]) & 0xFFF) == 0)
+						unique = 0;
+			} while (!unique);
+		LC_NodeInit_t init = { 0 };
+		init.DeviceName = "claim";
+		init.Serial = serials[i];
+		init.NodeID = -1;
+		if (count > CLAIM_FREE_IDS && i < count - CLAIM_FREE_IDS)
+			init.NodeID = i;
+		claim_desc[i] = (LC_NodeDescription_t*) claim_nodes[i].CreateNode(init);
+	}
+	uint32_t ms = 0;
+	for (; ms < CLAIM_TIMEOUT && !claimDone(count); ms++) {
+		for (int i = 0; i < count; i++)
+			claim_nodes[i].NetworkManager(1);
+		CAN_VBusRun(&claim_bus, (ms + 1) * 1000000ull);
+	}
+	if (ms < CLAIM_TIMEOUT) {
+		result->Converged++;
+		result->TimeSum += ms;
+		if (ms < result->TimeMin)
+			result->TimeMin = ms;
+		if (ms > result->TimeMax)
+			result->TimeMax = ms;
+	} else
+		result->Failed++;
+	result->Frames += claim_bus.Frames;
+	for (int i = 0; i < count; i++) {
+		LC_Metrics_t metrics;
+		claim_nodes[i].GetMetrics(&metrics);
+		result->Collisions += metrics.AddressCollisions;
+		CAN_InstanceUnload(&claim_nodes[i]);
+	}
+	return 0;
+}
+
+/// All online and no address used twice
+int claimDone(uint16_t count) {
+	uint8_t used[LC_Broadcast_Address + 1] = { 0 };
+	for (int i = 0; i < count; i++) {
+		uint16_t id = claim_desc[i]->ShortName.NodeID;
+		if (claim_desc[i]->State != LCNodeState_Online || id >= LC_Null_Address || used[id])
+			return 0;
+		used[id] = 1;
+	}
+	return 1;
+}
+
+uint32_t claimRandom(uint32_t* seed) {
+	*seed = *seed * 1664525 + 1013904223;
+	return *seed;
+}
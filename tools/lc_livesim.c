@@ -0,0 +1,200 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, liveness overhead benchmark
+ * lc_livesim.c
+ *
+ *  Created on: 18 oct 2026
+ *
+ * Steady state bus traffic spent only to keep node tables alive (address claims, discovery
+ * requests, heartbeats) on idle virtual bus (hal/Virtual), and time until every node forgets
+ * switched off node. Two nodes are "drive" class with 100 ms heartbeat, others use default.
+ * Host config node table (32) is smaller than 50 and 125 node networks.
+ * Compare libraries built with and without LEVCAN_HEARTBEAT, tool itself needs the flag:
+ *
+ * gcc -shared -fPIC ... -o liblevcan_vnode.so (see hal/Virtual/can_instance.h)
+ * gcc -shared -fPIC ... -DLEVCAN_HEARTBEAT -o liblevcan_hb.so
+ * gcc -O2 -DLEVCAN_HEARTBEAT -DCAN_VBUS_MAX_PORTS=128 -Iexamples/host -Isource -Ihal/Virtual
+ *   tools/lc_livesim.c hal/Virtual/can_vbus.c hal/Virtual/can_instance.c -ldl -o lc_livesim
+ * Usage: lc_livesim [-t seconds] liblevcan_vnode.so liblevcan_hb.so
+ *
+ * Liveness frames/s (bus load):
+ *   nodes  claims and requests  heartbeat
+ *   10     180 (1.9%)           28 (0.4%)
+ *   50     2033 (17.8%)         68 (1.0%)
+ *   125    4394 (35.1%)         143 (2.1%)
+ * Switched off node is removed after 1.0..1.1 s by discovery requests, 2.1..3.1 s by heartbeat.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "can_instance.h"
+
+#define LIVE_MAX_NODES 125
+#define LIVE_ONLINE_TIMEOUT 5000 //ms
+#define LIVE_WARMUP 5000 //ms, tables settle
+#define LIVE_DETECT_TIMEOUT 10000 //ms
+#define LIVE_FREE_IDS (LC_NodeFreeIDmax - LC_NodeFreeIDmin + 1)
+
+typedef struct {
+	uint32_t Claims, Requests, Heartbeats, Other;
+	uint64_t BusyTime; //ns, liveness frames only
+} LiveCount_t;
+
+//private functions
+int liveRun(const char* library, uint16_t count, uint32_t seconds, uint8_t first);
+void liveStep(uint16_t count, uint32_t ms);
+void liveMonitor(void* context, const CAN_VirtualFrame_t* frame, uint64_t start, uint64_t end, uint16_t sender);
+uint32_t liveRandom(uint32_t* seed);
+//private variables
+CAN_VirtualBus_t live_bus;
+CAN_Instance_t live_nodes[LIVE_MAX_NODES];
+LC_NodeDescription_t* live_desc[LIVE_MAX_NODES];
+uint8_t live_off[LIVE_MAX_NODES];
+LiveCount_t live_count;
+uint64_t live_time; //ms
+const uint16_t live_counts[] = { 10, 50, 125 };
+
+int main(int argc, char** argv) {
+	uint32_t seconds = 20;
+	int lib = 1, first = 1;
+	if (argc > 2 && strcmp(argv[1], "-t") == 0) {
+		seconds = strtoul(argv[2], 0, 0);
+		lib = 3;
+	}
+	if (lib >= argc || seconds == 0) {
+		fprintf(stderr, "usage: %s [-t seconds] liblevcan.so [liblevcan2.so ...]\n", argv[0]);
+		return 1;
+	}
+	printf("{\n  \"seconds\": %u,\n  \"results\": [", seconds);
+	for (; lib < argc; lib++)
+		for (int c = 0; c < sizeof(live_counts) / sizeof(live_counts[0]); c++) {
+			if (liveRun(argv[lib], live_counts[c], seconds, first))
+				return 1;
+			first = 0;
+		}
+	printf("\n  ]\n}\n");
+	return 0;
+}
+
+int liveRun(const char* library, uint16_t count, uint32_t seconds, uint8_t first) {
+	uint32_t seed = 4321 + count;
+	CAN_VBusInit(&live_bus, 1000000, seed);
+	live_bus.Monitor = liveMonitor;
+	live_time = 0;
+	memset(live_off, 0, sizeof(live_off));
+	for (int i = 0; i < count; i++) {
+		if (CAN_InstanceLoad(&live_nodes[i], library)) {
+			fprintf(stderr, "%s: load failed\n", library);
+			return 1;
+		}
+		CAN_VBusAttach(&live_bus, live_nodes[i].Port);
+	}
+	uint32_t serials[LIVE_MAX_NODES];
+	for (int i = 0; i < count; i++) {
+		//short name has 12 bit of serial
+		int unique;
+		do {
+			serials[i] = liveRandom(&seed);
+			unique = 1;
+			for (int k = 0; k < i; k++)
+				if (((serials[i] ^ serials[k]) & 0xFFF) == 0)
+					unique = 0;
+		} while (!unique);
+		LC_NodeInit_t init = { 0 };
+		init.DeviceName = "live";
+		init.Serial = serials[i];
+		init.NodeID = -1;
+		if (count > LIVE_FREE_IDS && i < count - LIVE_FREE_IDS)
+			init.NodeID = i;
+		init.HeartbeatPeriod = i < 2 ? 100 : 0;
+		live_desc[i] = (LC_NodeDescription_t*) live_nodes[i].CreateNode(init);
+	}
+	//all online
+	uint32_t online = 0;
+	for (; online < LIVE_ONLINE_TIMEOUT; online++) {
+		int on = 0;
+		for (int i = 0; i < count; i++)
+			on += live_desc[i]->State == LCNodeState_Online;
+		if (on == count)
+			break;
+		liveStep(count, 1);
+	}
+	liveStep(count, LIVE_WARMUP);
+	//steady state
+	memset(&live_count, 0, sizeof(live_count));
+	uint32_t frames = live_bus.Frames;
+	uint64_t busy = live_bus.BusyTime;
+	liveStep(count, seconds * 1000);
+	LiveCount_t steady = live_count;
+	frames = live_bus.Frames - frames;
+	busy = live_bus.BusyTime - busy;
+	//switch off default class node known by most tables, others should forget it
+	uint16_t victim = 2, knowing = 0;
+	for (int v = 2; v < count; v++) {
+		uint16_t known = 0;
+		for (int i = 0; i < count; i++)
+			known += i != v && live_nodes[i].GetNode(live_desc[v]->ShortName.NodeID).NodeID == live_desc[v]->ShortName.NodeID;
+		if (known > knowing) {
+			knowing = known;
+			victim = v;
+		}
+	}
+	uint16_t id = live_desc[victim]->ShortName.NodeID;
+	uint8_t knows[LIVE_MAX_NODES];
+	for (int i = 0; i < count; i++)
+		knows[i] = i != victim && live_nodes[i].GetNode(id).NodeID == id;
+	live_off[victim] = 1;
+	live_nodes[victim].Port->FilterInit = 1;
+	for (int m = 0; m < CAN_VBUS_MAILBOXES; m++)
+		live_nodes[victim].Port->Mailbox[m].Full = 0;
+	uint32_t detect = 0, forgot = 0;
+	for (; detect < LIVE_DETECT_TIMEOUT && forgot < knowing; detect++) {
+		liveStep(count, 1);
+		forgot = 0;
+		for (int i = 0; i < count; i++)
+			if (knows[i] && live_nodes[i].GetNode(id).NodeID != id)
+				forgot++;
+	}
+	double sec = seconds;
+	printf("%s\n    {\"library\": \"%s\", \"nodes\": %u, \"online_ms\": %u, \"frames_per_s\": {\"claims\": %.1f, \"requests\": %.1f, \"heartbeats\": %.1f, "
+			"\"other\": %.1f, \"total\": %.1f}, \"liveness_load_percent\": %.3f, \"bus_load_percent\": %.3f, \"detect\": {\"nodes\": %u, \"ms\": %u}}", first ? "" : ",",
+			library, count, online, steady.Claims / sec, steady.Requests / sec, steady.Heartbeats / sec, steady.Other / sec, frames / sec,
+			steady.BusyTime / (sec * 1e7), busy / (sec * 1e7), knowing, forgot == knowing ? detect : 0);
+	for (int i = 0; i < count; i++)
+		CAN_InstanceUnload(&live_nodes[i]);
+	return 0;
+}
+
+/// Runs managers of powered nodes with 1 ms tick
+void liveStep(uint16_t count, uint32_t ms) {
+	for (uint32_t m = 0; m < ms; m++) {
+		for (int i = 0; i < count; i++)
+			if (live_off[i] == 0)
+				live_nodes[i].NetworkManager(1);
+		live_time++;
+		CAN_VBusRun(&live_bus, live_time * 1000000ull);
+	}
+}
+
+void liveMonitor(void* context, const CAN_VirtualFrame_t* frame, uint64_t start, uint64_t end, uint16_t sender) {
+	//headerPacked_t: Request 1, MsgID 17-26
+	uint16_t msgid = (frame->Index >> 17) & 0x3FF;
+	if (msgid == LC_SYS_AddressClaimed) {
+		if (frame->Index & (1 << 1))
+			live_count.Requests++;
+		else
+			live_count.Claims++;
+	} else if (msgid == LC_SYS_Heartbeat)
+		live_count.Heartbeats++;
+	else {
+		live_count.Other++;
+		return;
+	}
+	live_count.BusyTime += end - start;
+}
+
+uint32_t liveRandom(uint32_t* seed) {
+	*seed = *seed * 1664525 + 1013904223;
+	return *seed;
+}
@@ -0,0 +1,821 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, parameter tree load benchmark
+ * lc_paramsim.c
+ *
+ *  Created on: 18 oct 2026
+ *
+ * Editor node loads whole parameter tree of device node on virtual bus (hal/Virtual):
+ * full information (name, formatting, limits) of every parameter, then values only.
+ * Requests are queued with LC_ParameterUpdateAsync as soon as queue has free place,
+ * libraries with LC_ParameterDirectoryAsync also load tree by whole directories.
+ * Libraries with LC_ParameterTagsAsync also measure reconnect: directory tags are compared
+ * with previous sync, nothing changed and one value changed.
+ * Libraries with levcan_paramcache.c (-DLEVCAN_PARAM_CACHE) also measure reconnect of editor
+ * that lost parameter tables but kept descriptor cache: tags, cached descriptors, values.
+ * With file client and server too (-DLEVCAN_FILECLIENT -DLEVCAN_FILESERVER, levcan_fileclient.c,
+ * levcan_fileserver.c) editor saves cache to device file server, clears it, loads it back and
+ * reconnects from loaded cache. Device file is kept in memory.
+ * Watch runs: device firmware changes one parameter of directory 0 every 10 ms, editor follows
+ * it by polling directory values every 100 ms or, with -DLEVCAN_PARAM_SUBSCRIBE, by subscription.
+ * Profile runs: 80 values set by LC_ParameterSet one by one, or by one LC_ParameterSetBatch,
+ * and batch with one value out of limits that should change nothing.
+ * Libraries with config parser (-DLEVCAN_PARAMETERS_PARSING) check name lookup: whole names only,
+ * prefix is rejected, directory shortened in place is seen. Parse time of whole tree config is printed,
+ * compare libraries with and without -DLEVCAN_PARAM_NAME_INDEX.
+ * With parser, file client and server editor imports config file from device (LC_ParameterImport):
+ * valid lines are applied, prefix name and line longer than LEVCAN_PARAM_IMPORT_SIZE are rejected.
+ * Round trip: editor exports its config (LC_ParameterExport), every writable value is moved to other
+ * limit, config is imported back and each value should be restored.
+ * Option -x fills directories with typical device parameters (switches, modes, voltages, percents,
+ * temperatures, read only counters) instead of wide int32 values, compact full answers of
+ * LC_PX_CompactRequest depend on it.
+ * Option -s runs device node on other library, for example one built from older sources, to check
+ * new editor against old device: every parameter should be loaded, none missing.
+ * Prints bus time, frames, payload bytes and parameters per second. Compare libraries built with
+ * different LEVCAN_PARAM_WINDOW:
+ *
+ * gcc -shared -fPIC ... -DLEVCAN_PARAM_WINDOW=1 -o liblevcan_w1.so (see hal/Virtual/can_instance.h)
+ * gcc -shared -fPIC ... -DLEVCAN_PARAM_WINDOW=8 -o liblevcan_w8.so
+ * gcc -O2 -rdynamic -Iexamples/host -Isource -Ihal/Virtual tools/lc_paramsim.c hal/Virtual/can_vbus.c
+ *   hal/Virtual/can_instance.c -ldl -o lc_paramsim
+ * -rdynamic gives file server libraries lcf* storage and lcdelay of this tool.
+ * Usage: lc_paramsim [-x] [-d directories] [-s device.so] liblevcan_w1.so liblevcan_w8.so
+ *
+ * 310 parameters, 1 Mbit/s, 1 ms manager, ms (bus load):
+ *   window            full tree     values
+ *   baseline FIFO     4301 (11.4%)  1201 (13.2%)
+ *   1                 621 (51.2%)   601 (15.9%)
+ *   4                 334 (95.2%)   151 (62.8%)
+ *   8                 323 (98.4%)   102 (93.0%)
+ *   directory         246 (88.0%)   41 (60.1%)
+ * Resync by tags: nothing changed 12 frames (4 ms), one value 30 frames (9 ms). Reconnect from cache
+ * 192 frames (44 ms), cache file 12951 bytes. Compact full directories (-x): 12216 payload bytes,
+ * 1548 frames, 236 ms. Watch: polling 351 frames, 50 ms average latency, subscription 250 frames, 11 ms.
+ * 80 values: one by one 239 ms, batch 63 frames, 11 ms. Config parse (host -O2): 50 us, indexed 32 us.
+ * Export and import round trip of 9609 byte config: 3617 ms and 3486 ms.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//declarations of optional parts, symbols are looked up in each library
+#define LEVCAN_PARAMETERS_PARSING
+#define LEVCAN_FILECLIENT
+#include "can_instance.h"
+#include "levcan_param.h"
+#include "levcan_paramcache.h"
+#include "levcan_fileclient.h"
+
+#define PARAM_DIR_SIZE 31 //directory entry and 30 parameters
+#define PARAM_MAX_DIRS 10
+#define PARAM_TIMEOUT 30000 //ms
+#define PARAM_WATCH_TIME 2000 //ms
+#define PARAM_WATCH_CHANGE 10 //ms between firmware changes
+#define PARAM_WATCH_POLL 100 //ms
+#define PARAM_PROFILE_SIZE 80
+#define PARAM_FILE_SIZE 65536
+#define PARAM_CACHE_FILE "params.cache"
+#define PARAM_CONFIG_FILE "params.txt"
+#define PARAM_PARSE_PASSES 1000
+
+typedef struct {
+	uint32_t Ms, Frames;
+	uint64_t BusyTime;
+	uint32_t Count, Missing;
+	uint32_t Bytes; //payload of all frames
+} ParamResult_t;
+
+typedef struct {
+	char Data[PARAM_FILE_SIZE];
+	uint32_t Size;
+	uint32_t Position;
+} ParamFile_t;
+
+//private functions
+int paramRun(const char* library, const char* device, uint16_t dirs, uint8_t first);
+void paramLoad(ParamResult_t* result, uint16_t dirs, uint8_t full, uint8_t bulk);
+void paramPrint(const char* name, const ParamResult_t* result, uint8_t first);
+void paramResync(ParamResult_t* result, uint16_t dirs);
+void paramReconnect(ParamResult_t* result, uint16_t dirs);
+void paramCacheFile(uint16_t dirs);
+void paramWatch(const char* name, uint8_t subscribe);
+void paramProfile(const char* name, uint8_t batch, uint8_t broken);
+void paramNames(uint16_t dirs);
+void paramImport(uint16_t dirs);
+void paramRoundTrip(uint16_t dirs);
+uint32_t paramLine(char* buffer, uint16_t dir, uint16_t index, int32_t value);
+void paramStep(void);
+void paramTyped(LC_ParameterAdress_t* entry, int32_t* value, uint16_t index);
+void paramMonitor(void* context, const CAN_VirtualFrame_t* frame, uint64_t start, uint64_t end, uint16_t sender);
+//private variables
+CAN_VirtualBus_t param_bus;
+CAN_Instance_t param_device, param_editor;
+void* param_device_node;
+void* param_editor_node;
+uint16_t param_device_id;
+LC_Return_t (*param_update)(LC_ParameterValue_t* paramv, uint16_t dir, void* sender_node, uint16_t receiver_node, uint8_t full);
+LC_Return_t (*param_directory)(LC_ParameterValue_t* params, uint16_t size, uint16_t dir, void* sender_node, uint16_t receiver_node, uint8_t full);
+LC_Return_t (*param_tags)(LC_ParameterTag_t* tags, uint16_t size, void* sender_node, uint16_t receiver_node);
+void (*param_manager[2])(uint32_t time);
+uint8_t param_windowed;
+void (*param_stop)(void);
+LC_Return_t (*param_cache_store)(LC_NodeShortName_t node, uint16_t dir, uint32_t descriptor, const LC_ParameterValue_t* params, uint16_t size);
+LC_Return_t (*param_cache_apply)(LC_NodeShortName_t node, uint16_t dir, uint32_t descriptor, LC_ParameterValue_t* params, uint16_t size);
+LC_ParamCacheInfo_t (*param_cache_info)(void);
+LC_FileResult_t (*param_cache_save)(char* name, void* sender_node, uint8_t server_node);
+LC_FileResult_t (*param_cache_load)(char* name, void* sender_node, uint8_t server_node);
+void (*param_cache_clear)(void);
+void (*param_fileserver)(uint32_t tick, void* server);
+ParamFile_t param_file, param_config;
+LC_Return_t (*param_subscribe)(LC_ParameterValue_t* params, uint16_t size, uint16_t dir, uint16_t first, uint16_t count, void* sender_node,
+		uint16_t receiver_node);
+LC_Return_t (*param_set)(LC_ParameterValue_t* paramv, uint16_t dir, void* sender_node, uint16_t receiver_node);
+LC_Return_t (*param_set_batch)(LC_ParameterBatch_t* batch, void* sender_node, uint16_t receiver_node);
+LC_Return_t (*param_unsubscribe)(uint16_t dir, uint16_t first, uint16_t count, void* sender_node, uint16_t receiver_node);
+const char* (*param_parse)(LC_NodeDescription_t* node, const char* input, int16_t* directory, int16_t* index, int32_t* value);
+int16_t (*param_is_directory)(LC_NodeDescription_t* node, const char* s);
+int16_t (*param_is_parameter)(LC_NodeDescription_t* node, const char* s, uint8_t directory);
+void (*param_print)(char* buffer, const LC_ParameterAdress_t* parameter);
+LC_FileResult_t (*param_import)(char* name, void* sender_node, uint8_t server_node, LC_ParameterImport_t* result);
+LC_FileResult_t (*param_export)(char* name, void* sender_node, uint8_t server_node);
+uint64_t param_time; //ms
+uint32_t param_bytes;
+//device side
+int32_t param_values[PARAM_MAX_DIRS][PARAM_DIR_SIZE];
+int32_t param_initial[PARAM_MAX_DIRS][PARAM_DIR_SIZE]; //every library starts with same values
+char param_names[PARAM_MAX_DIRS][PARAM_DIR_SIZE][32];
+LC_ParameterAdress_t param_table[PARAM_MAX_DIRS][PARAM_DIR_SIZE];
+LC_ParameterDirectory_t param_dirs[PARAM_MAX_DIRS];
+//editor side
+LC_ParameterValue_t param_received[PARAM_MAX_DIRS][PARAM_DIR_SIZE];
+LC_ParameterTag_t param_synced[PARAM_MAX_DIRS];
+
+int main(int argc, char** argv) {
+	uint16_t dirs = PARAM_MAX_DIRS;
+	int lib = 1, first = 1, typed = 0;
+	const char* device = 0;
+	if (lib < argc && strcmp(argv[lib], "-x") == 0) {
+		typed = 1;
+		lib++;
+	}
+	if (lib + 1 < argc && strcmp(argv[lib], "-d") == 0) {
+		dirs = strtoul(argv[lib + 1], 0, 0);
+		lib += 2;
+	}
+	if (lib + 1 < argc && strcmp(argv[lib], "-s") == 0) {
+		device = argv[lib + 1];
+		lib += 2;
+	}
+	if (lib >= argc || dirs == 0 || dirs > PARAM_MAX_DIRS) {
+		fprintf(stderr, "usage: %s [-x] [-d directories] [-s device.so] liblevcan.so [liblevcan2.so ...]\n", argv[0]);
+		return 1;
+	}
+	for (int d = 0; d < dirs; d++) {
+		for (int i = 0; i < PARAM_DIR_SIZE; i++) {
+			LC_ParameterAdress_t* entry = &param_table[d][i];
+			if (i == 0) {
+				snprintf(param_names[d][i], sizeof(param_names[d][i]), "Directory %d", d);
+				*entry = (LC_ParameterAdress_t ) { .ParamType = PT_dir, .ValueType = VT_unknown, .Name = param_names[d][i] };
+			} else {
+				snprintf(param_names[d][i], sizeof(param_names[d][i]), "Parameter %d of group %d", i, d);
+				param_values[d][i] = d * 1000 + i;
+				*entry = (LC_ParameterAdress_t ) { .Address = &param_values[d][i], .Min = -100000, .Max = 100000, .Step = 1, .Decimal = 1,
+								.ValueType = VT_int32, .ParamType = PT_value, .Name = param_names[d][i], .Formatting = "%s V" };
+				if (typed) {
+					paramTyped(entry, &param_values[d][i], i);
+					entry->Name = param_names[d][i];
+				}
+			}
+		}
+		param_dirs[d].Address = param_table[d];
+		param_dirs[d].Size = PARAM_DIR_SIZE;
+	}
+	memcpy(param_initial, param_values, sizeof(param_values));
+	printf("{\n  \"parameters\": %u,\n  \"typed\": %d,\n  \"results\": [", dirs * PARAM_DIR_SIZE, typed);
+	for (; lib < argc; lib++) {
+		if (paramRun(argv[lib], device ? device : argv[lib], dirs, first))
+			return 1;
+		first = 0;
+	}
+	printf("\n  ]\n}\n");
+	return 0;
+}
+
+int paramRun(const char* library, const char* device, uint16_t dirs, uint8_t first) {
+	CAN_VBusInit(&param_bus, 1000000, 1);
+	param_bus.Monitor = paramMonitor;
+	param_time = 0;
+	memcpy(param_values, param_initial, sizeof(param_values));
+	if (CAN_InstanceLoad(&param_device, device) || CAN_InstanceLoad(&param_editor, library)) {
+		fprintf(stderr, "%s: load failed\n", library);
+		return 1;
+	}
+	CAN_VBusAttach(&param_bus, param_device.Port);
+	CAN_VBusAttach(&param_bus, param_editor.Port);
+	param_update = CAN_InstanceSymbol(&param_editor, "LC_ParameterUpdateAsync");
+	param_stop = CAN_InstanceSymbol(&param_editor, "LC_ParametersStopUpdating");
+	param_directory = CAN_InstanceSymbol(&param_editor, "LC_ParameterDirectoryAsync");
+	param_tags = CAN_InstanceSymbol(&param_editor, "LC_ParameterTagsAsync");
+	param_cache_store = CAN_InstanceSymbol(&param_editor, "LC_ParamCacheStore");
+	param_cache_apply = CAN_InstanceSymbol(&param_editor, "LC_ParamCacheApply");
+	param_cache_info = CAN_InstanceSymbol(&param_editor, "LC_ParamCacheGetInfo");
+	param_cache_save = CAN_InstanceSymbol(&param_editor, "LC_ParamCacheSave");
+	param_cache_load = CAN_InstanceSymbol(&param_editor, "LC_ParamCacheLoad");
+	param_cache_clear = CAN_InstanceSymbol(&param_editor, "LC_ParamCacheClear");
+	param_fileserver = CAN_InstanceSymbol(&param_device, "LC_FileServer");
+	param_subscribe = CAN_InstanceSymbol(&param_editor, "LC_ParameterSubscribe");
+	param_unsubscribe = CAN_InstanceSymbol(&param_editor, "LC_ParameterUnsubscribe");
+	param_set = CAN_InstanceSymbol(&param_editor, "LC_ParameterSet");
+	param_set_batch = CAN_InstanceSymbol(&param_editor, "LC_ParameterSetBatch");
+	param_parse = CAN_InstanceSymbol(&param_editor, "LC_ParseParameterLine");
+	param_is_directory = CAN_InstanceSymbol(&param_editor, "LC_IsDirectory");
+	param_is_parameter = CAN_InstanceSymbol(&param_editor, "LC_IsParameter");
+	param_print = CAN_InstanceSymbol(&param_editor, "LC_PrintParam");
+	param_import = CAN_InstanceSymbol(&param_editor, "LC_ParameterImport");
+	param_export = CAN_InstanceSymbol(&param_editor, "LC_ParameterExport");
+	//libraries before windowed client have no manager, newer ones run it from LC_NetworkManager
+	param_manager[0] = CAN_InstanceSymbol(&param_device, "LC_ParameterManager");
+	param_manager[1] = CAN_InstanceSymbol(&param_editor, "LC_ParameterManager");
+	param_windowed = param_manager[1] || CAN_InstanceSymbol(&param_editor, "lc_paramManager");
+
+	LC_NodeInit_t init = { 0 };
+	init.DeviceName = "device";
+	init.Serial = 1;
+	init.NodeID = 10;
+	init.Configurable = 1;
+	init.Directories = param_dirs;
+	init.DirectoriesSize = dirs;
+	init.FileServer = param_fileserver != 0;
+	param_device_node = param_device.CreateNode(init);
+	init = (LC_NodeInit_t ) { 0 };
+	init.DeviceName = "editor";
+	init.Serial = 2;
+	init.NodeID = 20;
+	init.Configurable = 1; //parameter answers are received by same system object
+	//same table as device, own config is parsed, exported and imported
+	init.Directories = param_dirs;
+	init.DirectoriesSize = dirs;
+	param_editor_node = param_editor.CreateNode(init);
+	for (uint32_t ms = 0; ms < 1000; ms++)
+		paramStep();
+	param_device_id = ((LC_NodeDescription_t*) param_device_node)->ShortName.NodeID;
+
+	ParamResult_t result;
+	printf("%s\n    {\"library\": \"%s\", \"device\": \"%s\", ", first ? "" : ",", library, device);
+	paramLoad(&result, dirs, 1, 0);
+	paramPrint("full", &result, 1);
+	paramLoad(&result, dirs, 0, 0);
+	paramPrint("value", &result, 0);
+	if (param_directory) {
+		paramLoad(&result, dirs, 1, 1);
+		paramPrint("bulk_full", &result, 0);
+		paramLoad(&result, dirs, 0, 1);
+		paramPrint("bulk_value", &result, 0);
+	}
+	if (param_tags) {
+		//tags of loaded tree
+		memset(param_synced, 0, sizeof(param_synced));
+		paramResync(&result, dirs);
+		paramResync(&result, dirs);
+		paramPrint("resync_same", &result, 0);
+		param_values[dirs / 2][PARAM_DIR_SIZE / 2]++;
+		paramResync(&result, dirs);
+		paramPrint("resync_one_value", &result, 0);
+	}
+	if (param_tags && param_directory && param_cache_store) {
+		//cache filled from full load
+		paramLoad(&result, dirs, 1, 1);
+		LC_NodeShortName_t device = param_editor.GetNode(param_device_id);
+		for (int d = 0; d < dirs; d++)
+			param_cache_store(device, d, param_synced[d].Descriptor, param_received[d], PARAM_DIR_SIZE);
+		paramReconnect(&result, dirs);
+		paramPrint("reconnect_cached", &result, 0);
+		LC_ParamCacheInfo_t info = param_cache_info();
+		printf(", \"cache\": {\"parameters\": %d, \"strings\": %d, \"string_bytes\": %d, \"references\": %d}", info.Parameters, info.Strings,
+				info.StringBytes, info.Referenced);
+		if (param_cache_save && param_fileserver)
+			paramCacheFile(dirs);
+	}
+	//before watch and profile runs, watch writes values past limits
+	if (param_parse && param_print)
+		paramNames(dirs);
+	if (param_import && param_fileserver) {
+		paramImport(dirs);
+		if (param_export)
+			paramRoundTrip(dirs);
+	}
+	if (param_directory && param_windowed) {
+		paramWatch("watch_poll", 0);
+		if (param_subscribe)
+			paramWatch("watch_subscribe", 1);
+	}
+	if (dirs * (PARAM_DIR_SIZE - 1) >= PARAM_PROFILE_SIZE) {
+		paramProfile("profile_single", 0, 0);
+		if (param_set_batch) {
+			paramProfile("profile_batch", 1, 0);
+			paramProfile("profile_batch_rejected", 1, 1);
+		}
+	}
+	printf("}");
+	CAN_InstanceUnload(&param_device);
+	CAN_InstanceUnload(&param_editor);
+	return 0;
+}
+
+void paramPrint(const char* name, const ParamResult_t* result, uint8_t first) {
+	printf("%s\"%s\": {\"ms\": %u, \"params_per_s\": %.1f, \"frames\": %u, \"bytes\": %u, \"bus_load_percent\": %.1f, \"missing\": %u}",
+			first ? "" : ", ", name, result->Ms, result->Ms ? result->Count * 1000.0 / result->Ms : 0.0, result->Frames, result->Bytes,
+			result->Ms ? result->BusyTime / (result->Ms * 1e4) : 0.0, result->Missing);
+}
+
+/// Queues every parameter of the tree (or every directory) and runs bus until all answers are in.
+/// Directory entries have no value, so value pass skips them
+void paramLoad(ParamResult_t* result, uint16_t dirs, uint8_t full, uint8_t bulk) {
+	LC_ParameterValue_t* list[PARAM_MAX_DIRS * PARAM_DIR_SIZE];
+	uint16_t list_dir[PARAM_MAX_DIRS * PARAM_DIR_SIZE];
+	uint32_t count = 0, queued = 0, done = 0;
+	uint8_t waiting = full ? PT_noinit : PT_reqval;
+	if (full)
+		memset(param_received, 0, sizeof(param_received));
+	for (int d = 0; d < dirs; d++)
+		for (int i = full ? 0 : 1; i < PARAM_DIR_SIZE; i++) {
+			param_received[d][i].Index = i;
+			list[count] = &param_received[d][i];
+			list_dir[count++] = d;
+		}
+	uint32_t frames = param_bus.Frames;
+	uint64_t busy = param_bus.BusyTime;
+	uint32_t bytes = param_bytes;
+	uint32_t ms = 0;
+	uint16_t dirs_queued = 0;
+	for (; ms < PARAM_TIMEOUT && done < count; ms++) {
+		if (bulk) {
+			for (; dirs_queued < dirs; dirs_queued++)
+				if (param_directory(param_received[dirs_queued], PARAM_DIR_SIZE, dirs_queued, param_editor_node, param_device_id, full))
+					break;
+			//all parameters are marked when last directory is queued
+			if (dirs_queued == dirs)
+				queued = count;
+		} else
+			for (; queued < count; queued++)
+				if (param_update(list[queued], list_dir[queued], param_editor_node, param_device_id, full))
+					break;
+		paramStep();
+		done = 0;
+		for (uint32_t p = 0; p < queued; p++)
+			if ((list[p]->ParamType & waiting) == 0)
+				done++;
+	}
+	result->Ms = ms;
+	result->Frames = param_bus.Frames - frames;
+	result->BusyTime = param_bus.BusyTime - busy;
+	result->Bytes = param_bytes - bytes;
+	result->Missing = count - done;
+	//given up requests
+	for (uint32_t p = 0; p < queued; p++)
+		if (list[p]->Result != LC_Ok)
+			result->Missing++;
+	result->Count = count;
+	param_stop();
+}
+
+/// Gets directory tags, loads values of directories changed since last sync
+void paramResync(ParamResult_t* result, uint16_t dirs) {
+	LC_ParameterTag_t tags[PARAM_MAX_DIRS] = { { 0 } }; //Result stays 0 with libraries before it
+	uint8_t changed[PARAM_MAX_DIRS] = { 0 };
+	uint32_t frames = param_bus.Frames;
+	uint64_t busy = param_bus.BusyTime;
+	uint32_t bytes = param_bytes;
+	uint32_t ms = 0, pending = 1;
+	param_tags(tags, dirs, param_editor_node, param_device_id);
+	for (; ms < PARAM_TIMEOUT && pending; ms++) {
+		paramStep();
+		pending = 0;
+		for (int d = 0; d < dirs; d++)
+			pending += tags[d].Pending;
+	}
+	result->Count = 0;
+	for (int d = 0; d < dirs; d++) {
+		//node without tags, editor would load it without them
+		if (tags[d].Result != LC_Ok)
+			pending++;
+		else if (tags[d].Values != param_synced[d].Values) {
+			changed[d] = 1;
+			result->Count += PARAM_DIR_SIZE - 1;
+		}
+		param_synced[d] = tags[d];
+	}
+	for (int d = 0; d < dirs; d++) {
+		if (changed[d] == 0)
+			continue;
+		param_directory(param_received[d], PARAM_DIR_SIZE, d, param_editor_node, param_device_id, 0);
+		for (; ms < PARAM_TIMEOUT && changed[d]; ms++) {
+			paramStep();
+			changed[d] = 0;
+			for (int i = 1; i < PARAM_DIR_SIZE; i++)
+				if (param_received[d][i].ParamType & PT_reqval)
+					changed[d] = 1;
+		}
+	}
+	result->Ms = ms;
+	result->Frames = param_bus.Frames - frames;
+	result->BusyTime = param_bus.BusyTime - busy;
+	result->Bytes = param_bytes - bytes;
+	result->Missing = pending;
+	param_stop();
+}
+
+/// Editor restarted: parameter tables are empty, descriptors come from cache when tags match, then values are loaded
+void paramReconnect(ParamResult_t* result, uint16_t dirs) {
+	LC_ParameterTag_t tags[PARAM_MAX_DIRS] = { { 0 } }; //Result stays 0 with libraries before it
+	memset(param_received, 0, sizeof(param_received));
+	uint32_t frames = param_bus.Frames;
+	uint64_t busy = param_bus.BusyTime;
+	uint32_t bytes = param_bytes;
+	uint32_t ms = 0, pending = 1;
+	param_tags(tags, dirs, param_editor_node, param_device_id);
+	for (; ms < PARAM_TIMEOUT && pending; ms++) {
+		paramStep();
+		pending = 0;
+		for (int d = 0; d < dirs; d++)
+			pending += tags[d].Pending;
+	}
+	LC_NodeShortName_t device = param_editor.GetNode(param_device_id);
+	uint8_t full[PARAM_MAX_DIRS];
+	for (int d = 0; d < dirs; d++) {
+		full[d] = param_cache_apply(device, d, tags[d].Descriptor, param_received[d], PARAM_DIR_SIZE) != LC_Ok;
+		param_synced[d] = tags[d];
+	}
+	uint16_t queued = 0;
+	result->Missing = 0;
+	for (; ms < PARAM_TIMEOUT; ms++) {
+		for (; queued < dirs; queued++)
+			if (param_directory(param_received[queued], PARAM_DIR_SIZE, queued, param_editor_node, param_device_id, full[queued]))
+				break;
+		paramStep();
+		result->Missing = dirs - queued;
+		for (int d = 0; d < queued; d++)
+			for (int i = 0; i < PARAM_DIR_SIZE; i++)
+				if ((param_received[d][i].ParamType & (PT_reqval | PT_noinit)) || param_received[d][i].Result != LC_Ok)
+					result->Missing++;
+		if (result->Missing == 0)
+			break;
+	}
+	result->Ms = ms;
+	result->Count = dirs * PARAM_DIR_SIZE;
+	result->Frames = param_bus.Frames - frames;
+	result->BusyTime = param_bus.BusyTime - busy;
+	result->Bytes = param_bytes - bytes;
+	param_stop();
+}
+
+/// Editor saves descriptor cache to device, clears it, loads it back and reconnects from loaded cache
+void paramCacheFile(uint16_t dirs) {
+	LC_ParamCacheInfo_t before = param_cache_info();
+	uint32_t frames = param_bus.Frames;
+	uint64_t start = param_time;
+	LC_FileResult_t save = param_cache_save(PARAM_CACHE_FILE, param_editor_node, param_device_id);
+	uint32_t save_ms = param_time - start;
+	uint32_t save_frames = param_bus.Frames - frames;
+	param_cache_clear();
+	frames = param_bus.Frames;
+	start = param_time;
+	LC_FileResult_t load = param_cache_load(PARAM_CACHE_FILE, param_editor_node, param_device_id);
+	uint32_t load_ms = param_time - start;
+	uint32_t load_frames = param_bus.Frames - frames;
+	LC_ParamCacheInfo_t after = param_cache_info();
+	printf(", \"cache_file\": {\"save\": %d, \"load\": %d, \"file_bytes\": %u, \"save_ms\": %u, \"save_frames\": %u, \"load_ms\": %u, "
+			"\"load_frames\": %u, \"same\": %d}", save, load, param_file.Size, save_ms, save_frames, load_ms, load_frames,
+			memcmp(&before, &after, sizeof(before)) == 0);
+	ParamResult_t result;
+	paramReconnect(&result, dirs);
+	paramPrint("reconnect_loaded", &result, 0);
+}
+
+/// Firmware changes values of directory 0 directly, editor follows them. Latency is time from change until editor has same value
+void paramWatch(const char* name, uint8_t subscribe) {
+	uint32_t changed[PARAM_DIR_SIZE] = { 0 }; //ms of unseen change, 0 - seen
+	uint32_t seen = 0, lost = 0, latency_max = 0;
+	uint64_t latency_sum = 0;
+	if (subscribe) {
+		param_subscribe(param_received[0], PARAM_DIR_SIZE, 0, 1, PARAM_DIR_SIZE - 1, param_editor_node, param_device_id);
+		//initial values
+		for (int ms = 0; ms < 100; ms++)
+			paramStep();
+	}
+	uint32_t frames = param_bus.Frames;
+	uint64_t busy = param_bus.BusyTime;
+	for (uint32_t ms = 1; ms <= PARAM_WATCH_TIME; ms++) {
+		if (ms % PARAM_WATCH_CHANGE == 0) {
+			int i = 1 + (ms / PARAM_WATCH_CHANGE) % (PARAM_DIR_SIZE - 1);
+			param_values[0][i] += 7;
+			if (changed[i])
+				lost++; //changed again before editor saw it
+			changed[i] = ms;
+		}
+		if (subscribe == 0 && ms % PARAM_WATCH_POLL == 0)
+			param_directory(param_received[0], PARAM_DIR_SIZE, 0, param_editor_node, param_device_id, 0);
+		paramStep();
+		for (int i = 1; i < PARAM_DIR_SIZE; i++)
+			if (changed[i] && param_received[0][i].Value == param_values[0][i]) {
+				uint32_t latency = ms - changed[i] + 1;
+				latency_sum += latency;
+				if (latency > latency_max)
+					latency_max = latency;
+				seen++;
+				changed[i] = 0;
+			}
+	}
+	frames = param_bus.Frames - frames;
+	busy = param_bus.BusyTime - busy;
+	if (subscribe)
+		param_unsubscribe(0, 1, PARAM_DIR_SIZE - 1, param_editor_node, param_device_id);
+	param_stop();
+	printf(", \"%s\": {\"changes\": %u, \"seen\": %u, \"overwritten\": %u, \"latency_ms_avg\": %.1f, \"latency_ms_max\": %u, \"frames\": %u, \"bus_load_percent\": %.1f}",
+			name, PARAM_WATCH_TIME / PARAM_WATCH_CHANGE, seen, lost, seen ? (double) latency_sum / seen : 0.0, latency_max, frames, busy / (PARAM_WATCH_TIME * 1e4));
+}
+
+/// Sets PARAM_PROFILE_SIZE parameters, runs until device has all of them or batch answer is received
+void paramProfile(const char* name, uint8_t batch, uint8_t broken) {
+	LC_ParameterSetItem_t items[PARAM_PROFILE_SIZE];
+	int32_t before[PARAM_PROFILE_SIZE];
+	static int32_t shift = 0;
+	shift += 3;
+	for (int p = 0; p < PARAM_PROFILE_SIZE; p++) {
+		items[p].Directory = p / (PARAM_DIR_SIZE - 1);
+		items[p].Index = 1 + p % (PARAM_DIR_SIZE - 1);
+		items[p].Value = p * 10 + shift;
+		before[p] = param_values[items[p].Directory][items[p].Index];
+	}
+	if (broken)
+		items[PARAM_PROFILE_SIZE / 2].Value = 1000000; //out of limits
+	LC_ParameterBatch_t profile = { .Items = items, .Count = PARAM_PROFILE_SIZE };
+	uint32_t frames = param_bus.Frames;
+	uint64_t busy = param_bus.BusyTime;
+	uint32_t ms = 0, sent = 0, done = 0;
+	if (batch)
+		param_set_batch(&profile, param_editor_node, param_device_id);
+	for (; ms < PARAM_TIMEOUT; ms++) {
+		//one TCP transfer at time, next one collides until previous is finished
+		for (; batch == 0 && sent < PARAM_PROFILE_SIZE; sent++) {
+			LC_ParameterValue_t value = { .Value = items[sent].Value, .Index = items[sent].Index };
+			if (param_set(&value, items[sent].Directory, param_editor_node, param_device_id))
+				break;
+		}
+		paramStep();
+		done = 0;
+		for (int p = 0; p < PARAM_PROFILE_SIZE; p++)
+			done += param_values[items[p].Directory][items[p].Index] == items[p].Value;
+		if (batch ? profile.Pending == 0 : done == PARAM_PROFILE_SIZE)
+			break;
+	}
+	uint32_t unchanged = 0, rejected = 0;
+	for (int p = 0; p < PARAM_PROFILE_SIZE; p++) {
+		unchanged += param_values[items[p].Directory][items[p].Index] == before[p];
+		rejected += (profile.Rejected[p / 8] >> (p % 8)) & 1;
+	}
+	printf(", \"%s\": {\"ms\": %u, \"frames\": %u, \"set\": %u, \"unchanged\": %u", name, ms + 1, param_bus.Frames - frames, done, unchanged);
+	if (batch)
+		printf(", \"applied\": %u, \"rejected\": %u", profile.Applied, rejected);
+	printf(", \"bus_load_percent\": %.1f}", (param_bus.BusyTime - busy) / ((ms + 1) * 1e4));
+	param_stop();
+}
+
+/// Finds names of editor own table: whole name, prefix, parameter past directory shortened in place.
+/// Then parses config of whole tree PARAM_PARSE_PASSES times
+void paramNames(uint16_t dirs) {
+	LC_NodeDescription_t* node = param_editor_node;
+	uint16_t last = dirs - 1;
+	int exact = param_is_parameter(node, param_names[last][3], last) == 3 && param_is_directory(node, param_names[last][0]) == last;
+	//"Parameter 1" is start of "Parameter 1 of group 0" and "Parameter 10 of group 0"
+	int prefix = param_is_parameter(node, "Parameter 1", last) == -1 && param_is_directory(node, "Directory") == -1;
+	param_dirs[last].Size = 3;
+	int resized = param_is_parameter(node, param_names[last][10], last) == -1;
+	param_dirs[last].Size = PARAM_DIR_SIZE;
+	resized = resized && param_is_parameter(node, param_names[last][10], last) == 10;
+	//config of whole tree
+	static char config[PARAM_FILE_SIZE];
+	uint32_t length = 0, lines = 0, mismatch = 0;
+	for (int d = 0; d < dirs; d++)
+		for (int i = 0; i < PARAM_DIR_SIZE; i++) {
+			param_print(&config[length], &param_table[d][i]);
+			length += strlen(&config[length]);
+		}
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int pass = 0; pass < PARAM_PARSE_PASSES; pass++) {
+		int16_t dir = -1, index;
+		int32_t value;
+		lines = 0;
+		for (const char* line = config; line; lines++) {
+			index = -1;
+			line = param_parse(node, line, &dir, &index, &value);
+			if (line && index > 0 && value != param_values[dir][index])
+				mismatch++;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double us = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / 1e3 / PARAM_PARSE_PASSES;
+	printf(", \"names\": {\"exact\": %d, \"prefix_rejected\": %d, \"resized\": %d, \"config_lines\": %u, \"parse_us\": %.1f, \"mismatch\": %u}",
+			exact, prefix, resized, lines, us, mismatch);
+}
+
+/// Editor imports hand made config of last directory: two valid lines, prefix name and line longer than import buffer
+void paramImport(uint16_t dirs) {
+	uint16_t last = dirs - 1;
+	//writable in both tables: value, bool, enum and percent
+	const uint16_t valid[2] = { 1, 2 };
+	const uint16_t longer = 4;
+	int32_t before[PARAM_DIR_SIZE];
+	memcpy(before, param_values[last], sizeof(before));
+	char* data = param_config.Data;
+	uint32_t size = 0, lines = 0;
+	param_print(data, &param_table[last][0]);
+	size = strlen(data);
+	size += paramLine(&data[size], last, valid[0], param_table[last][valid[0]].Min);
+	//"Parameter 1" of "Parameter 10 of group" is not a name
+	size += sprintf(&data[size], "Parameter 1 = 0\n");
+	uint32_t line = size;
+	size += paramLine(&data[size], last, longer, param_table[last][longer].Min);
+	size--; //comment pushes new line past LEVCAN_PARAM_IMPORT_SIZE
+	data[size++] = ' ';
+	data[size++] = '#';
+	while (size - line < 300)
+		data[size++] = '-';
+	data[size++] = '\n';
+	size += paramLine(&data[size], last, valid[1], param_table[last][valid[1]].Max);
+	param_config.Size = size;
+	for (uint32_t i = 0; i < size; i++)
+		lines += data[i] == '\n';
+	LC_ParameterImport_t result = { 0 };
+	LC_FileResult_t state = param_import(PARAM_CONFIG_FILE, param_editor_node, param_device_id, &result);
+	int applied = param_values[last][valid[0]] == param_table[last][valid[0]].Min && param_values[last][valid[1]] == param_table[last][valid[1]].Max;
+	int unchanged = param_values[last][longer] == before[longer];
+	memcpy(param_values[last], before, sizeof(before));
+	printf(", \"import\": {\"result\": %d, \"lines\": %u, \"expected_lines\": %u, \"applied\": %u, \"rejected\": %u, \"values_set\": %d, "
+			"\"long_line_unchanged\": %d}", state, result.Lines, lines, result.Applied, result.Rejected, applied, unchanged);
+}
+
+/// Editor exports config, values are scrambled and config is imported back
+void paramRoundTrip(uint16_t dirs) {
+	int32_t before[PARAM_MAX_DIRS][PARAM_DIR_SIZE];
+	memcpy(before, param_values, sizeof(before));
+	uint32_t frames = param_bus.Frames;
+	uint64_t start = param_time;
+	LC_FileResult_t saved = param_export(PARAM_CONFIG_FILE, param_editor_node, param_device_id);
+	uint32_t export_ms = param_time - start;
+	uint32_t export_frames = param_bus.Frames - frames;
+	uint32_t total = 0, restored = 0;
+	for (int d = 0; d < dirs; d++)
+		for (int i = 1; i < PARAM_DIR_SIZE; i++)
+			if ((param_table[d][i].ParamType & PT_readonly) == 0) {
+				LC_ParameterAdress_t* entry = &param_table[d][i];
+				param_values[d][i] = param_values[d][i] == entry->Min ? entry->Max : entry->Min;
+				total++;
+			}
+	LC_ParameterImport_t result = { 0 };
+	frames = param_bus.Frames;
+	start = param_time;
+	LC_FileResult_t loaded = param_import(PARAM_CONFIG_FILE, param_editor_node, param_device_id, &result);
+	uint32_t import_ms = param_time - start;
+	uint32_t import_frames = param_bus.Frames - frames;
+	for (int d = 0; d < dirs; d++)
+		for (int i = 1; i < PARAM_DIR_SIZE; i++)
+			if ((param_table[d][i].ParamType & PT_readonly) == 0 && param_values[d][i] == before[d][i])
+				restored++;
+	memcpy(param_values, before, sizeof(before));
+	printf(", \"round_trip\": {\"export\": %d, \"import\": %d, \"file_bytes\": %u, \"export_ms\": %u, \"export_frames\": %u, "
+			"\"import_ms\": %u, \"import_frames\": %u, \"applied\": %u, \"rejected\": %u, \"restored\": %u, \"total\": %u}", saved, loaded,
+			param_config.Size, export_ms, export_frames, import_ms, import_frames, result.Applied, result.Rejected, restored, total);
+}
+
+/// Prints config line of parameter with other value, parameter keeps its value. Returns line length
+uint32_t paramLine(char* buffer, uint16_t dir, uint16_t index, int32_t value) {
+	int32_t saved = param_values[dir][index];
+	param_values[dir][index] = value;
+	param_print(buffer, &param_table[dir][index]);
+	param_values[dir][index] = saved;
+	return strlen(buffer);
+}
+
+/// Runs managers with 1 ms tick
+void paramStep(void) {
+	param_device.NetworkManager(1);
+	param_editor.NetworkManager(1);
+	for (int i = 0; i < 2; i++)
+		if (param_manager[i])
+			param_manager[i](1);
+	if (param_fileserver)
+		param_fileserver(1, param_device_node);
+	param_time++;
+	CAN_VBusRun(&param_bus, param_time * 1000000ull);
+}
+
+/// Typical parameter of index kind, limits and values like in real device tables
+void paramTyped(LC_ParameterAdress_t* entry, int32_t* value, uint16_t index) {
+	switch (index % 6) {
+	case 1:
+		*entry = (LC_ParameterAdress_t ) { .Min = 0, .Max = 1, .Step = 1, .ParamType = PT_bool };
+		*value = index & 1;
+		break;
+	case 2:
+		*entry = (LC_ParameterAdress_t ) { .Min = 0, .Max = 3, .Step = 1, .ParamType = PT_enum, .Formatting = "Off\nEco\nSport\nBoost" };
+		*value = 2;
+		break;
+	case 3:
+		*entry = (LC_ParameterAdress_t ) { .Min = 0, .Max = 60000, .Step = 100, .Decimal = 3, .ParamType = PT_value, .Formatting = "%s V" };
+		*value = 48000;
+		break;
+	case 4:
+		*entry = (LC_ParameterAdress_t ) { .Min = 0, .Max = 100, .Step = 1, .ParamType = PT_value, .Formatting = "%s %%" };
+		*value = 80;
+		break;
+	case 5:
+		*entry = (LC_ParameterAdress_t ) { .Min = -40, .Max = 120, .Step = 1, .ParamType = PT_value, .Formatting = "%s C" };
+		*value = 25;
+		break;
+	default:
+		*entry = (LC_ParameterAdress_t ) { .Min = 0, .Max = 0x7FFFFFFF, .Step = 1, .Decimal = 1, .ParamType = PT_value | PT_readonly, .Formatting = "%s km" };
+		*value = 123456;
+		break;
+	}
+	entry->Address = value;
+	entry->ValueType = VT_int32;
+}
+
+void paramMonitor(void* context, const CAN_VirtualFrame_t* frame, uint64_t start, uint64_t end, uint16_t sender) {
+	param_bytes += frame->Length;
+}
+
+//file client waits for answers here
+void* lcdelay(uint32_t time) {
+	for (uint32_t ms = 0; ms < time; ms++)
+		paramStep();
+	return 0;
+}
+
+//device file server storage, cache and config files in memory
+LC_FileResult_t lcfopen(void** fileObject, char* name, LC_FileAccess_t mode) {
+	ParamFile_t* file;
+	if (strcmp(name, PARAM_CACHE_FILE) == 0)
+		file = &param_file;
+	else if (strcmp(name, PARAM_CONFIG_FILE) == 0)
+		file = &param_config;
+	else
+		return LC_FR_NoFile;
+	if (mode & (LC_FA_CreateAlways | LC_FA_CreateNew))
+		file->Size = 0;
+	file->Position = (mode & LC_FA_OpenAppend) == LC_FA_OpenAppend ? file->Size : 0;
+	*fileObject = file;
+	return LC_FR_Ok;
+}
+
+uint32_t lcftell(void* fileObject) {
+	return ((ParamFile_t*) fileObject)->Position;
+}
+
+LC_FileResult_t lcflseek(void* fileObject, uint32_t pointer) {
+	ParamFile_t* file = fileObject;
+	file->Position = pointer < file->Size ? pointer : file->Size;
+	return LC_FR_Ok;
+}
+
+LC_FileResult_t lcfread(void* fileObject, char* buffer, uint32_t bytesToRead, uint32_t* bytesReaded) {
+	ParamFile_t* file = fileObject;
+	uint32_t size = file->Size - file->Position;
+	if (size > bytesToRead)
+		size = bytesToRead;
+	memcpy(buffer, &file->Data[file->Position], size);
+	file->Position += size;
+	*bytesReaded = size;
+	return LC_FR_Ok;
+}
+
+LC_FileResult_t lcfwrite(void* fileObject, const char* buffer, uint32_t bytesToWrite, uint32_t* bytesWritten) {
+	ParamFile_t* file = fileObject;
+	uint32_t size = PARAM_FILE_SIZE - file->Position;
+	if (size > bytesToWrite)
+		size = bytesToWrite;
+	memcpy(&file->Data[file->Position], buffer, size);
+	file->Position += size;
+	if (file->Position > file->Size)
+		file->Size = file->Position;
+	*bytesWritten = size;
+	return LC_FR_Ok;
+}
+
+LC_FileResult_t lcfclose(void* fileObject) {
+	return LC_FR_Ok;
+}
+
+LC_FileResult_t lcftruncate(void* fileObject) {
+	ParamFile_t* file = fileObject;
+	file->Size = file->Position;
+	return LC_FR_Ok;
+}
+
+uint32_t lcfsize(void* fileObject) {
+	return ((ParamFile_t*) fileObject)->Size;
+}
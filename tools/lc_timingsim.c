@@ -0,0 +1,368 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, discrete-event timing simulator
+ * lc_timingsim.c
+ *
+ *  Created on: 18 oct 2026
+ *
+ * Real LEVCAN copies (hal/Virtual) run on bit-exact bus model: stuffing, CRC, arbitration by
+ * 29-bit identifier (headerPacked_t, priority bits on top). Events are LC_NetworkManager ticks,
+ * polled interrupt handlers and message generation, each node and message has own period and
+ * phase. Response time is time from LC_SendMessage to end of last frame (EoM) on bus.
+ *
+ * Same traffic runs in several scenarios to show effect of priority bits, mailbox order
+ * and manager tick rate. Output is JSON.
+ *
+ * Build library as described in hal/Virtual/can_instance.h, then:
+ * gcc -O2 -Iexamples/host -Isource -Ihal/Virtual tools/lc_timingsim.c hal/Virtual/can_vbus.c
+ *   hal/Virtual/can_instance.c -ldl -o lc_timingsim
+ * Usage: lc_timingsim liblevcan_vnode.so [traffic.txt] [-t seconds] [-b bitrate]
+ *
+ * Traffic file, one item per line, # starts comment:
+ * node <manager_us> [phase_us] [isr_us]         isr_us 0 - interrupts, else handlers are polled
+ * msg <node> <index> <size> <period_us> <low|mid|control|high> [offset_us] [tcp <target node>]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "can_instance.h"
+
+#define SIM_MAX_NODES 16
+#define SIM_MAX_MESSAGES 64
+#define SIM_WARMUP 1000000000ull //discovery and claim before traffic, ns
+#define SIM_NO_TARGET 0xFF
+
+typedef struct {
+	uint32_t ManagerUs, PhaseUs, IsrUs;
+	uint32_t TickUs; //manager period in current scenario
+	CAN_Instance_t Lib;
+	void* Node;
+	uint16_t NodeID;
+	uint64_t NextTick, NextIsr;
+	uint32_t UsRest;
+} SimNode_t;
+
+typedef struct {
+	uint8_t Node, Target, Priority, TCP;
+	uint16_t Index;
+	int32_t Size;
+	uint32_t PeriodUs, OffsetUs;
+	//run state
+	uint64_t Next, Generated;
+	uint8_t Pending;
+	uint32_t Sent, Skipped, Misses;
+	uint64_t* Times;
+	uint32_t TimesCount, TimesSize;
+} SimMessage_t;
+
+typedef struct {
+	const char* Name;
+	uint8_t FlatPriority; //all messages same priority
+	uint8_t IdOrder; //mailboxes by identifier
+	uint32_t ManagerUs; //0 - from traffic
+} SimScenario_t;
+
+//private functions
+int simLoadTraffic(const char* path);
+void simDefaultTraffic(void);
+int simRun(const char* library, const SimScenario_t* scenario, uint64_t duration, uint32_t bitrate, int first);
+void simMonitor(void* context, const CAN_VirtualFrame_t* frame, uint64_t start, uint64_t end, uint16_t sender);
+void simGenerate(SimMessage_t* msg, const SimScenario_t* scenario);
+void simTick(SimNode_t* node);
+void simReport(SimMessage_t* msg);
+int simCompare(const void* a, const void* b);
+//private variables
+CAN_VirtualBus_t sim_bus;
+SimNode_t sim_nodes[SIM_MAX_NODES];
+SimMessage_t sim_msgs[SIM_MAX_MESSAGES];
+uint16_t sim_nodes_count, sim_msgs_count;
+uint8_t sim_payload[4096];
+const char* sim_priority_names[] = { "low", "mid", "control", "high" };
+
+const SimScenario_t sim_scenarios[] = {
+		{ .Name = "baseline" },
+		{ .Name = "flat_priority", .FlatPriority = 1 },
+		{ .Name = "mailbox_id_order", .IdOrder = 1 },
+		{ .Name = "manager_100us", .ManagerUs = 100 },
+		{ .Name = "manager_1ms", .ManagerUs = 1000 },
+		{ .Name = "manager_10ms", .ManagerUs = 10000 },
+};
+
+int main(int argc, char** argv) {
+	const char* traffic = 0;
+	uint64_t duration = 10000000000ull;
+	uint32_t bitrate = 1000000;
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s liblevcan_vnode.so [traffic.txt] [-t seconds] [-b bitrate]\n", argv[0]);
+		return 1;
+	}
+	for (int i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			duration = strtoull(argv[++i], 0, 0) * 1000000000ull;
+		else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+			bitrate = strtoul(argv[++i], 0, 0);
+		else
+			traffic = argv[i];
+	}
+	if (traffic) {
+		if (simLoadTraffic(traffic))
+			return 1;
+	} else
+		simDefaultTraffic();
+	for (int i = 0; i < sizeof(sim_payload); i++)
+		sim_payload[i] = i;
+
+	printf("{\n  \"bitrate\": %u, \"duration_s\": %.1f, \"nodes\": %u, \"messages\": %u,\n  \"scenarios\": [", bitrate, duration / 1e9, sim_nodes_count,
+			sim_msgs_count);
+	for (int s = 0; s < sizeof(sim_scenarios) / sizeof(sim_scenarios[0]); s++)
+		if (simRun(argv[1], &sim_scenarios[s], duration, bitrate, s == 0))
+			return 1;
+	printf("\n  ]\n}\n");
+	return 0;
+}
+
+int simLoadTraffic(const char* path) {
+	FILE* file = fopen(path, "r");
+	if (file == 0) {
+		perror(path);
+		return 1;
+	}
+	char line[256];
+	int number = 0;
+	while (fgets(line, sizeof(line), file)) {
+		number++;
+		char* comment = strchr(line, '#');
+		if (comment)
+			*comment = 0;
+		char kind[16] = { 0 }, priority[16] = { 0 }, tcp[16] = { 0 };
+		if (sscanf(line, "%15s", kind) != 1)
+			continue;
+		if (strcmp(kind, "node") == 0 && sim_nodes_count < SIM_MAX_NODES) {
+			SimNode_t* node = &sim_nodes[sim_nodes_count];
+			memset(node, 0, sizeof(SimNode_t));
+			if (sscanf(line, "%*s %u %u %u", &node->ManagerUs, &node->PhaseUs, &node->IsrUs) < 1 || node->ManagerUs == 0)
+				goto error;
+			sim_nodes_count++;
+		} else if (strcmp(kind, "msg") == 0 && sim_msgs_count < SIM_MAX_MESSAGES) {
+			SimMessage_t* msg = &sim_msgs[sim_msgs_count];
+			unsigned node = 0, index = 0, target = SIM_NO_TARGET;
+			memset(msg, 0, sizeof(SimMessage_t));
+			if (sscanf(line, "%*s %u %i %i %u %15s %u %15s %u", &node, &index, &msg->Size, &msg->PeriodUs, priority, &msg->OffsetUs, tcp, &target) < 5)
+				goto error;
+			msg->Node = node;
+			msg->Index = index;
+			msg->Target = target;
+			msg->TCP = strcmp(tcp, "tcp") == 0;
+			msg->Priority = 4;
+			for (int p = 0; p < 4; p++)
+				if (strcmp(priority, sim_priority_names[p]) == 0)
+					msg->Priority = p;
+			if (node >= sim_nodes_count || index >= LC_SYS_AddressClaimed || msg->Size <= 0 || msg->Size > sizeof(sim_payload) || msg->PeriodUs == 0
+					|| msg->Priority > 3 || (msg->TCP && target >= sim_nodes_count))
+				goto error;
+			sim_msgs_count++;
+		} else
+			goto error;
+	}
+	fclose(file);
+	return 0;
+	error: fprintf(stderr, "%s:%d: bad line\n", path, number);
+	fclose(file);
+	return 1;
+}
+
+/// Typical vehicle: motor controller, battery, display, throttle handle
+void simDefaultTraffic(void) {
+	const SimNode_t nodes[] = {
+			{ .ManagerUs = 1000 }, //controller
+			{ .ManagerUs = 1000, .PhaseUs = 300 }, //battery
+			{ .ManagerUs = 10000, .PhaseUs = 700 }, //display
+			{ .ManagerUs = 1000, .PhaseUs = 500 }, //throttle
+	};
+	const SimMessage_t msgs[] = {
+			{ .Node = 3, .Index = 0x010, .Size = 2, .PeriodUs = 10000, .Priority = LC_Priority_Control }, //throttle
+			{ .Node = 3, .Index = 0x011, .Size = 1, .PeriodUs = 20000, .Priority = LC_Priority_Control, .OffsetUs = 100 }, //brake
+			{ .Node = 0, .Index = 0x020, .Size = 8, .PeriodUs = 20000, .Priority = LC_Priority_Mid }, //speed, current
+			{ .Node = 0, .Index = 0x021, .Size = 8, .PeriodUs = 100000, .Priority = LC_Priority_Low, .OffsetUs = 2000 }, //temperatures
+			{ .Node = 0, .Index = 0x022, .Size = 4, .PeriodUs = 50000, .Priority = LC_Priority_High, .OffsetUs = 7000 }, //fault flags
+			{ .Node = 1, .Index = 0x030, .Size = 8, .PeriodUs = 50000, .Priority = LC_Priority_Mid }, //pack voltage, current
+			{ .Node = 1, .Index = 0x031, .Size = 48, .PeriodUs = 500000, .Priority = LC_Priority_Low, .OffsetUs = 3000 }, //cell voltages
+			{ .Node = 2, .Index = 0x040, .Size = 256, .PeriodUs = 200000, .Priority = LC_Priority_Low, .TCP = 1, .Target = 0 }, //parameter page
+	};
+	sim_nodes_count = sizeof(nodes) / sizeof(nodes[0]);
+	memcpy(sim_nodes, nodes, sizeof(nodes));
+	sim_msgs_count = sizeof(msgs) / sizeof(msgs[0]);
+	memcpy(sim_msgs, msgs, sizeof(msgs));
+	for (int i = 0; i < sim_msgs_count; i++)
+		if (sim_msgs[i].TCP == 0)
+			sim_msgs[i].Target = SIM_NO_TARGET;
+}
+
+int simRun(const char* library, const SimScenario_t* scenario, uint64_t duration, uint32_t bitrate, int first) {
+	CAN_VBusInit(&sim_bus, bitrate, 1);
+	sim_bus.Monitor = simMonitor;
+	for (int i = 0; i < sim_nodes_count; i++) {
+		SimNode_t* node = &sim_nodes[i];
+		if (CAN_InstanceLoad(&node->Lib, library)) {
+			fprintf(stderr, "%s: load failed\n", library);
+			return 1;
+		}
+		node->TickUs = scenario->ManagerUs ? scenario->ManagerUs : node->ManagerUs;
+		node->Lib.Port->IdOrder = scenario->IdOrder;
+		if (node->IsrUs) {
+			//handlers polled by simulator
+			node->Lib.Port->RxInterrupt = 0;
+			node->Lib.Port->TxInterrupt = 0;
+		}
+		CAN_VBusAttach(&sim_bus, node->Lib.Port);
+		LC_NodeInit_t init = { 0 };
+		init.DeviceName = "sim";
+		init.NodeID = -1;
+		init.Serial = 200 + i;
+		node->Node = node->Lib.CreateNode(init);
+		node->NextTick = node->PhaseUs * 1000ull;
+		node->NextIsr = node->PhaseUs * 1000ull;
+		node->UsRest = 0;
+	}
+	for (int i = 0; i < sim_msgs_count; i++) {
+		SimMessage_t* msg = &sim_msgs[i];
+		free(msg->Times);
+		msg->TimesSize = duration / (msg->PeriodUs * 1000ull) + 2;
+		msg->Times = malloc(msg->TimesSize * sizeof(uint64_t));
+		msg->TimesCount = msg->Sent = msg->Skipped = msg->Misses = 0;
+		msg->Pending = 0;
+		msg->Next = SIM_WARMUP + msg->OffsetUs * 1000ull;
+	}
+
+	uint64_t end = SIM_WARMUP + duration, busy = 0;
+	uint32_t frames = 0, errors = 0;
+	uint8_t started = 0;
+	while (1) {
+		uint64_t next = end;
+		for (int i = 0; i < sim_nodes_count; i++) {
+			if (sim_nodes[i].NextTick < next)
+				next = sim_nodes[i].NextTick;
+			if (sim_nodes[i].IsrUs && sim_nodes[i].NextIsr < next)
+				next = sim_nodes[i].NextIsr;
+		}
+		for (int i = 0; i < sim_msgs_count; i++)
+			if (sim_msgs[i].Next < next)
+				next = sim_msgs[i].Next;
+		if (next >= SIM_WARMUP && started == 0) {
+			//traffic starts, node table is ready
+			CAN_VBusRun(&sim_bus, SIM_WARMUP);
+			started = 1;
+			busy = sim_bus.BusyTime;
+			frames = sim_bus.Frames;
+			errors = sim_bus.ErrorFrames;
+			for (int i = 0; i < sim_nodes_count; i++) {
+				LC_NodeShortName_t (*name)(void*) = CAN_InstanceSymbol(&sim_nodes[i].Lib, "LC_GetMyNodeName");
+				sim_nodes[i].NodeID = name(sim_nodes[i].Node).NodeID;
+			}
+		}
+		//frame which started before event ends after it, bus was not free anyway
+		CAN_VBusRun(&sim_bus, next);
+		if (next >= end)
+			break;
+		for (int i = 0; i < sim_nodes_count; i++) {
+			SimNode_t* node = &sim_nodes[i];
+			if (node->IsrUs && node->NextIsr <= next) {
+				node->Lib.ReceiveHandler();
+				node->Lib.TransmitHandler();
+				node->NextIsr += node->IsrUs * 1000ull;
+			}
+		}
+		for (int i = 0; i < sim_msgs_count; i++)
+			if (sim_msgs[i].Next <= next)
+				simGenerate(&sim_msgs[i], scenario);
+		for (int i = 0; i < sim_nodes_count; i++)
+			if (sim_nodes[i].NextTick <= next)
+				simTick(&sim_nodes[i]);
+	}
+
+	printf("%s\n    {\"name\": \"%s\", \"bus_load\": %.4f, \"frames\": %u, \"error_frames\": %u, \"node_ids\": [", first ? "" : ",", scenario->Name,
+			(double) (sim_bus.BusyTime - busy) / duration, sim_bus.Frames - frames, sim_bus.ErrorFrames - errors);
+	for (int i = 0; i < sim_nodes_count; i++)
+		printf("%s%u", i ? ", " : "", sim_nodes[i].NodeID);
+	printf("],\n      \"messages\": [");
+	for (int i = 0; i < sim_msgs_count; i++) {
+		printf("%s\n        ", i ? "," : "");
+		simReport(&sim_msgs[i]);
+	}
+	printf("\n      ]}");
+	for (int i = 0; i < sim_nodes_count; i++)
+		CAN_InstanceUnload(&sim_nodes[i].Lib);
+	return 0;
+}
+
+void simMonitor(void* context, const CAN_VirtualFrame_t* frame, uint64_t start, uint64_t end, uint16_t sender) {
+	uint32_t index = frame->Index;
+	//headerPacked_t: Request 1, Source 3-9, MsgID 17-26, EoM 27
+	if ((index >> 1) & 1 || ((index >> 27) & 1) == 0)
+		return;
+	uint16_t msgid = (index >> 17) & 0x3FF;
+	for (int i = 0; i < sim_msgs_count; i++) {
+		SimMessage_t* msg = &sim_msgs[i];
+		if (msg->Pending == 0 || msg->Node != sender || msg->Index != msgid)
+			continue;
+		uint64_t time = end - msg->Generated;
+		if (msg->TimesCount < msg->TimesSize)
+			msg->Times[msg->TimesCount++] = time;
+		if (time > msg->PeriodUs * 1000ull)
+			msg->Misses++;
+		msg->Pending = 0;
+		break;
+	}
+}
+
+void simGenerate(SimMessage_t* msg, const SimScenario_t* scenario) {
+	SimNode_t* node = &sim_nodes[msg->Node];
+	LC_ObjectRecord_t record = { 0 };
+	record.Address = sim_payload;
+	record.Size = msg->Size;
+	record.Attributes.TCP = msg->TCP;
+	record.Attributes.Priority = scenario->FlatPriority ? LC_Priority_Low : msg->Priority;
+	record.NodeID = msg->Target == SIM_NO_TARGET ? LC_Broadcast_Address : sim_nodes[msg->Target].NodeID;
+	uint64_t time = msg->Next;
+	msg->Next += msg->PeriodUs * 1000ull;
+	//previous one still in queue, application would overwrite or wait
+	if (msg->Pending || node->Lib.SendMessage(node->Node, &record, msg->Index) != LC_Ok) {
+		msg->Skipped++;
+		return;
+	}
+	msg->Generated = time;
+	msg->Pending = 1;
+	msg->Sent++;
+}
+
+void simTick(SimNode_t* node) {
+	node->UsRest += node->TickUs;
+	uint32_t ms = node->UsRest / 1000;
+	node->UsRest %= 1000;
+	node->Lib.NetworkManager(ms);
+	node->NextTick += node->TickUs * 1000ull;
+}
+
+void simReport(SimMessage_t* msg) {
+	printf("{\"node\": %u, \"index\": %u, \"size\": %d, \"period_us\": %u, \"priority\": \"%s\", \"tcp\": %u, \"sent\": %u, \"skipped\": %u, "
+			"\"deadline_misses\": %u", msg->Node, msg->Index, msg->Size, msg->PeriodUs, sim_priority_names[msg->Priority], msg->TCP, msg->Sent,
+			msg->Skipped, msg->Misses);
+	uint32_t count = msg->TimesCount;
+	if (count) {
+		qsort(msg->Times, count, sizeof(uint64_t), simCompare);
+		uint64_t sum = 0;
+		for (int i = 0; i < count; i++)
+			sum += msg->Times[i];
+		printf(", \"response_us\": {\"count\": %u, \"min\": %.1f, \"avg\": %.1f, \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"p999\": %.1f, "
+				"\"max\": %.1f}", count, msg->Times[0] / 1000.0, sum / 1000.0 / count, msg->Times[count / 2] / 1000.0,
+				msg->Times[count * 90 / 100] / 1000.0, msg->Times[count * 99 / 100] / 1000.0, msg->Times[count * 999 / 1000] / 1000.0,
+				msg->Times[count - 1] / 1000.0);
+	}
+	printf("}");
+}
+
+int simCompare(const void* a, const void* b) {
+	uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+	return (x > y) - (x < y);
+}
@@ -0,0 +1,48 @@
+/*
+ * LEV-CAN: Light Electric Vehicle CAN protocol, host trace decoder
+ * lc_tracedump.c
+ *
+ *  Created on: 18 oct 2026
+ *
+ * Renders binary dump of lc_trace (LC_TraceRing_t) taken from target, for example
+ * gdb: dump binary memory trace.bin &lc_trace ((char*)&lc_trace)+sizeof(lc_trace)
+ *
+ * Build: gcc -DLEVCAN_TRACE_DECODER -Iexamples -Isource tools/lc_tracedump.c source/levcan_trace.c -o lc_tracedump
+ * Usage: lc_tracedump trace.bin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "levcan_trace.h"
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s dump.bin\n", argv[0]);
+		return 1;
+	}
+	FILE* file = fopen(argv[1], "rb");
+	if (file == 0) {
+		perror(argv[1]);
+		return 1;
+	}
+	//ring header, entries size depends on target configuration
+	uint32_t header[3];
+	if (fread(header, sizeof(header), 1, file) != 1 || header[0] != LC_TRACE_MAGIC || header[1] == 0) {
+		fprintf(stderr, "%s: not a trace dump\n", argv[1]);
+		fclose(file);
+		return 1;
+	}
+	uint32_t size = header[1], head = header[2];
+	LC_TraceEntry_t* entries = calloc(size, sizeof(LC_TraceEntry_t));
+	size_t got = fread(entries, sizeof(LC_TraceEntry_t), size, file);
+	fclose(file);
+	if (got != size)
+		fprintf(stderr, "%s: truncated, %u of %u entries\n", argv[1], (unsigned) got, (unsigned) size);
+
+	uint32_t count = LC_TraceDecode(entries, size, head, printf);
+	printf("# %u events shown, %u written\n", (unsigned) count, (unsigned) head);
+	free(entries);
+	return 0;
+}